@@ -11,25 +11,16 @@ uint8_t stop_sleeping;
 uint32_t led_on_ms;
 uint32_t led_off_ms;
 
-// Converts a string argument to an integer and sets target.
-static void get_ms(char* arg, uint32_t* target) {
-  int ms = atoi(arg);
-  if (ms <= 0) {
-    printf("Expected a positive integer\n");
-  } else {
-    *target = ms;
-    stop_sleeping = 1;
-  }
-}
-
 // changes on duration
-static void on_ms(uint8_t argc, char* argv[]) {
-  get_ms(argv[0], &led_on_ms);
+static void on_ms(uint8_t argc, const union ConsoleValue* argv) {
+  led_on_ms = argv[0].u;
+  stop_sleeping = 1;
 }
 
 // changes off duration
-static void off_ms(uint8_t argc, char* argv[]) {
-  get_ms(argv[0], &led_off_ms);
+static void off_ms(uint8_t argc, const union ConsoleValue* argv) {
+  led_off_ms = argv[0].u;
+  stop_sleeping = 1;
 }
 
 // dumps current state
@@ -37,13 +28,23 @@ static void state(uint8_t argc, char* argv[]) {
   printf("on=%dms of=%dms\n", led_on_ms, led_off_ms);
 }
 
+// The console checks and converts the argument of on_ms and off_ms
+static const struct ConsoleArg ms_args[] = {
+    {"ms", CONSOLE_ARG_UNSIGNED, 1, 3600000},
+};
+
 // Configuration to register with uart_console_init()
 struct ConsoleCallback callbacks[] = {
-    {"on_ms", "On time in ms", 1, on_ms},
-    {"off_ms", "Off time in ms", 1, off_ms},
+    {"on_ms", "On time in ms", 1, NULL, NULL, ms_args, on_ms},
+    {"off_ms", "Off time in ms", 1, NULL, NULL, ms_args, off_ms},
     {"state", "Dump current state", 0, state},
 };
 
+// Runs at boot as if it was typed, without the echo or waiting for a host
+static const char startup_script[] =
+    "on_ms 500\n"
+    "off_ms 500\n";
+
 #define SLEEP_STEP_MS 50
 // A sleep function that also calls uart_console_poll() to keep the
 // interface responsive.
@@ -67,15 +68,16 @@ int main() {
   gpio_init(LED_PIN);
   gpio_set_dir(LED_PIN, GPIO_OUT);
 
-  led_on_ms = 500;
-  led_off_ms = 500;
-
   struct ConsoleConfig cc;
   uart_console_init(
       &cc,
       callbacks,
       sizeof(callbacks) / sizeof(callbacks[0]),
       CONSOLE_VT102);
+  // kept if the script stops before setting them
+  led_on_ms = 500;
+  led_off_ms = 500;
+  uart_console_run_script(&cc, startup_script);
 
   while (1) {
     gpio_put(LED_PIN, 1);
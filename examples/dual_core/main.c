@@ -0,0 +1,73 @@
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "uart_console/console.h"
+
+// Core1 owns the console (echo, editing, parsing) and core0 runs a timing
+// sensitive loop.  Commands are passed to core0 through cc.commands and
+// core0 runs them between loop iterations.  Replies go back to core1
+// through cc.reply so core0 never waits on stdio.
+
+struct ConsoleConfig cc;
+uint32_t loop_count;
+uint32_t loop_period_us = 1000;
+
+static void hello(uint8_t argc, char* argv[]) {
+  uart_console_reply_printf(&cc, "Hello World!\n");
+}
+
+static void period(uint8_t argc, char* argv[]) {
+  const int us = atoi(argv[0]);
+  if (us <= 0) {
+    uart_console_reply_printf(&cc, "Expected a positive integer\n");
+    return;
+  }
+  loop_period_us = us;
+}
+
+static void state(uint8_t argc, char* argv[]) {
+  uart_console_reply_printf(
+      &cc, "loops=%lu period=%luus\n", loop_count, loop_period_us);
+}
+
+// Configuration to register with uart_console_init()
+struct ConsoleCallback callbacks[] = {
+    {"hello", "Welcome message", 0, hello},
+    {"period", "Control loop period in us", 1, period},
+    {"state", "Dump control loop state", 0, state},
+};
+
+// Wakes core0 if it is waiting with __wfe()
+static void command_queued(void) {
+  __sev();
+}
+
+static void core1_main(void) {
+  while (1) {
+    uart_console_poll(&cc, "> ");
+    sleep_ms(5);
+  }
+}
+
+// program entry point
+int main() {
+  uart_console_init(
+      &cc,
+      callbacks,
+      sizeof(callbacks) / sizeof(callbacks[0]),
+      CONSOLE_VT102);
+  uart_console_set_remote_dispatch(&cc, command_queued);
+  multicore_launch_core1(core1_main);
+
+  absolute_time_t next = get_absolute_time();
+  while (1) {
+    // control loop work goes here
+    ++loop_count;
+    // commands run at a point of core0's choosing
+    uart_console_run_commands(&cc);
+    next = delayed_by_us(next, loop_period_us);
+    sleep_until(next);
+  }
+  return 0;
+}
@@ -0,0 +1,26 @@
+// LED commands, registered without touching main.c
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include "uart_console/console.h"
+
+static uint8_t led_initialized;
+
+static void led_cmd(uint8_t argc, const union ConsoleValue* argv) {
+  if (!led_initialized) {
+    gpio_init(PICO_DEFAULT_LED_PIN);
+    gpio_set_dir(PICO_DEFAULT_LED_PIN, GPIO_OUT);
+    led_initialized = 1;
+  }
+  gpio_put(PICO_DEFAULT_LED_PIN, argv[0].u);
+}
+
+static void led_state_cmd(uint8_t argc, char* argv[]) {
+  printf("led=%d\n", led_initialized ? gpio_get(PICO_DEFAULT_LED_PIN) : 0);
+}
+
+static const struct ConsoleArg led_args[] = {
+    {"state", CONSOLE_ARG_UNSIGNED, 0, 1},
+};
+
+CONSOLE_COMMAND(led, "Sets the LED", 1, NULL, NULL, led_args, led_cmd);
+CONSOLE_COMMAND(led_state, "Shows the LED", 0, led_state_cmd);
@@ -0,0 +1,23 @@
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include "uart_console/console.h"
+
+// Commands are registered with CONSOLE_COMMAND next to their code, so this
+// file does not need to know about the ones in led.c.
+static void hello_cmd(uint8_t argc, char* argv[]) {
+  printf("Hello World!\n");
+}
+CONSOLE_COMMAND(hello, "Prints message", 0, hello_cmd);
+
+// program entry point
+int main() {
+  struct ConsoleConfig cc;
+  // NULL means use every command registered with CONSOLE_COMMAND
+  uart_console_init(&cc, NULL, 0, CONSOLE_VT102);
+
+  while (1) {
+    uart_console_poll(&cc, "> ");
+    sleep_ms(20);
+  }
+  return 0;
+}
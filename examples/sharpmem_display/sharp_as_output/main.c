@@ -49,6 +49,18 @@ static int sharp_putchar(int c) {
   return 0;
 }
 
+// Block output.  Redrawing the display is the expensive part so it is
+// deferred to sharp_flush(), which the console calls once per batch.
+static void sharp_write(const char* data, size_t length) {
+  for (size_t i=0; i<length; ++i) {
+    sharpconsole_char(&console, data[i]);
+  }
+}
+
+static void sharp_flush(void) {
+  sharpconsole_flush(&console);
+}
+
 // program entry point
 int main() {
   sleep_ms(500); // let sharp display power up
@@ -60,6 +72,7 @@ int main() {
       sizeof(callbacks) / sizeof(callbacks[0]),
       CONSOLE_ECHO,
       sharp_putchar);
+  uart_console_set_writer(&cc, sharp_write, sharp_flush);
 
 
   while (1) {
@@ -107,7 +107,7 @@ static void sharp_debug_dump() {
   }
 
   sharpconsole_printf(&console, "state=%s line=%d cursor=%d\n", state, cc.line_length, cc.cursor_index);
-  sharpconsole_printf(&console, "tab_len=%d tab_cb_idx=%d\n", cc.tab_length, cc.tab_callback_index);
+  sharpconsole_printf(&console, "tab_count=%d\n", cc.tab_count);
   sharpconsole_printf(&console, "line: |");
   for (uint16_t i=0; i<cc.line_length; ++i) {
     sharpconsole_char(&console, cc.line[i]);
@@ -119,15 +119,12 @@ static void sharp_debug_dump() {
   }
   sharpconsole_printf(&console, "^\n\n");
 
-  const uint16_t marker_idx = (cc.history_tail_index + CONSOLE_HISTORY_LINES - cc.history_marker_index) % CONSOLE_HISTORY_LINES;
-  for (uint16_t i=0; i<CONSOLE_HISTORY_LINES; ++i) {
-    const char is_tail = (i == cc.history_tail_index) ? 'T' : ' ';
-    const char is_marker = (i == marker_idx) ? 'M' : ' ';
-    const char* line = cc.history + (i * (CONSOLE_MAX_LINE_CHARS + 1));
-    sharpconsole_printf(
-      &console,
-      "  %c%c | %s\n", is_marker, is_tail, line);
+  char line[CONSOLE_MAX_LINE_CHARS + 1];
+  for (uint16_t i=0; uart_console_history(&cc, i, line) >= 0; ++i) {
+    const char is_marker = (i == cc.history_marker_index) ? 'M' : ' ';
+    sharpconsole_printf(&console, "  %c | %s\n", is_marker, line);
   }
+  sharpconsole_printf(&console, "history: %d bytes\n", cc.history_used);
 
   sharpconsole_flush(&console);
 }
@@ -0,0 +1,58 @@
+// Demonstrates a resumable command.  "count 10 500" prints a number every
+// 500 ms without holding up the console.  Other commands keep working while
+// it runs and ctrl-c stops it.
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "uart_console/console.h"
+
+// Kept in ConsoleTask.state between calls
+struct CountState {
+  uint32_t next;
+  uint32_t limit;
+  uint32_t period_ms;
+  uint32_t next_ms;
+};
+
+static uint8_t count_task(struct ConsoleTask* task) {
+  struct CountState* state = (struct CountState*)task->state;
+  const uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+  if (task->cancelled) {
+    printf("count stopped at %lu\n", state->next);
+    return CONSOLE_TASK_DONE;
+  }
+  if (task->calls == 0) {
+    state->next = 1;
+    state->limit = atoi(task->argv[0]);
+    state->period_ms = atoi(task->argv[1]);
+    state->next_ms = now_ms;
+  }
+  if ((int32_t)(now_ms - state->next_ms) < 0) {
+    return CONSOLE_TASK_PENDING;
+  }
+  printf("%lu\n", state->next);
+  state->next_ms += state->period_ms;
+  return (state->next++ < state->limit) ?
+    CONSOLE_TASK_PENDING : CONSOLE_TASK_DONE;
+}
+
+static void hello_cmd(uint8_t argc, char* argv[]) {
+  printf("Hello World!\n");
+}
+
+struct ConsoleCallback callbacks[] = {
+    {"count", "Counts to n, one number every ms (count n ms)", 2, NULL, count_task},
+    {"hello", "Prints message", 0, hello_cmd},
+};
+
+// program entry point
+int main() {
+  struct ConsoleConfig cc;
+  uart_console_init(&cc, callbacks, 2, CONSOLE_VT102);
+
+  while (1) {
+    uart_console_poll(&cc, "> ");
+    sleep_ms(20);
+  }
+  return 0;
+}
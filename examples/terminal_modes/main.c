@@ -6,40 +6,40 @@
 
 struct ConsoleConfig cc;
 
-struct TerminalPair {
-  const char* name;
-  uint8_t code;
+// Names and codes in the same order.  The names are also the choices of
+// the set_terminal argument, which tab completes.  CONSOLE_BINARY is left
+// out since someone typing could not switch back from it.
+static const char* const terminal_names[] = {
+  "debug",
+  "debug_vt102",
+  "echo",
+  "minimal",
+  "vt102",
+  NULL,
 };
-
-struct TerminalPair terminal_pairs[] = {
-  {"debug", CONSOLE_DEBUG_ECHO},
-  {"debug_vt102", CONSOLE_DEBUG_VT102},
-  {"echo", CONSOLE_ECHO},
-  {"minimal", CONSOLE_MINIMAL},
-  {"vt102", CONSOLE_VT102},
+static const uint8_t terminal_codes[] = {
+  CONSOLE_DEBUG_ECHO,
+  CONSOLE_DEBUG_VT102,
+  CONSOLE_ECHO,
+  CONSOLE_MINIMAL,
+  CONSOLE_VT102,
 };
-#define NUM_TERMINAL_PAIRS (sizeof(terminal_pairs) / sizeof(terminal_pairs[0]))
+#define NUM_TERMINALS (sizeof(terminal_codes) / sizeof(terminal_codes[0]))
 
 static void list_terminals(uint8_t argc, char* argv[]) {
-  for (uint8_t i=0; i < NUM_TERMINAL_PAIRS; ++i) {
-    printf("  %s\n", terminal_pairs[i].name);
+  for (uint8_t i=0; i < NUM_TERMINALS; ++i) {
+    printf("  %s\n", terminal_names[i]);
   }
 }
 
-static void set_terminal(uint8_t argc, char* argv[]) {
-  for (uint8_t i=0; i < NUM_TERMINAL_PAIRS; ++i) {
-    if (!strcmp(argv[0], terminal_pairs[i].name)) {
-      cc.terminal = terminal_pairs[i].code;
-      return;
-    }
-  }
-  printf("Unknown terminal.  Try list_terminals\n");
+static void set_terminal(uint8_t argc, const union ConsoleValue* argv) {
+  cc.terminal = terminal_codes[argv[0].u];
 }
 
 static void get_terminal(uint8_t argc, char* argv[]) {
-  for (uint8_t i=0; i < NUM_TERMINAL_PAIRS; ++i) {
-    if (terminal_pairs[i].code == cc.terminal) {
-      printf("%s\n", terminal_pairs[i].name);
+  for (uint8_t i=0; i < NUM_TERMINALS; ++i) {
+    if (terminal_codes[i] == cc.terminal) {
+      printf("%s\n", terminal_names[i]);
       return;
     }
   }
@@ -50,12 +50,16 @@ static void hello(uint8_t argc, char* argv[]) {
   printf("Hello World!\n");
 }
 
+static const struct ConsoleArg set_terminal_args[] = {
+    {"terminal", CONSOLE_ARG_ENUM, 0, 0, terminal_names},
+};
+
 // Configuration to register with uart_console_init()
 struct ConsoleCallback callbacks[] = {
     {"hello", "Welcome message", 0, hello},
     {"get_terminal", "Gets terminal", 0, get_terminal},
     {"list_terminals", "List known terminals", 0, list_terminals},
-    {"set_terminal", "Sets terminal", 1, set_terminal},
+    {"set_terminal", "Sets terminal", 1, NULL, NULL, set_terminal_args, set_terminal},
 };
 
 // program entry point
@@ -66,9 +70,11 @@ int main(void) {
       sizeof(callbacks) / sizeof(callbacks[0]),
       CONSOLE_VT102);
 
+  // sleep until characters arrive instead of polling on a timer
+  uart_console_notify_on_stdio(&cc);
   while (1) {
     uart_console_poll(&cc, "> ");
-    sleep_ms(20);
+    uart_console_wait(&cc, 100000);
   }
   return 0;
 }
@@ -0,0 +1,74 @@
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include "hardware/uart.h"
+#include "uart_console/console.h"
+
+// The operator console is on USB and a second console for a test fixture
+// is on UART1.  Both share one callbacks table.
+#define FIXTURE_UART uart1
+#define BAUD_RATE 115200
+#define UART_TX_PIN 4
+#define UART_RX_PIN 5
+
+static int uart_read(struct ConsoleConfig* cc) {
+  uart_inst_t* uart = uart_console_context(cc);
+  return uart_is_readable(uart) ? uart_getc(uart) : -1;
+}
+
+static void uart_write(
+    struct ConsoleConfig* cc, const char* data, size_t length) {
+  uart_write_blocking(uart_console_context(cc), (const uint8_t*)data, length);
+}
+
+static const struct ConsoleTransport uart_transport = {uart_read, uart_write};
+
+// Handlers are given the console that received the command so that they
+// reply on the right one
+static void whoami(struct ConsoleConfig* cc, uint8_t argc, char* argv[]) {
+  const char* name =
+    uart_console_context(cc) ? "fixture (uart1)" : "operator (usb)";
+  uart_console_printf(cc, "%s\r\n", name);
+}
+
+static void led(struct ConsoleConfig* cc, uint8_t argc, char* argv[]) {
+  gpio_put(PICO_DEFAULT_LED_PIN, argv[0][0] == '1');
+  uart_console_printf(cc, "ok\r\n");
+}
+
+struct ConsoleCallback callbacks[] = {
+    {"whoami", "Names this console", 0, NULL, .handler = whoami},
+    {"led", "Sets the LED: led <0|1>", 1, NULL, .handler = led},
+};
+
+// program entry point
+int main() {
+  gpio_init(PICO_DEFAULT_LED_PIN);
+  gpio_set_dir(PICO_DEFAULT_LED_PIN, GPIO_OUT);
+  uart_init(FIXTURE_UART, BAUD_RATE);
+  gpio_set_function(UART_TX_PIN, GPIO_FUNC_UART);
+  gpio_set_function(UART_RX_PIN, GPIO_FUNC_UART);
+
+  static struct ConsoleConfig operator;
+  uart_console_init(
+      &operator,
+      callbacks,
+      sizeof(callbacks) / sizeof(callbacks[0]),
+      CONSOLE_VT102);
+
+  // stdio is already set up, the transport replaces it for this console
+  static struct ConsoleConfig fixture;
+  uart_console_init_lowlevel(
+      &fixture,
+      callbacks,
+      sizeof(callbacks) / sizeof(callbacks[0]),
+      CONSOLE_MINIMAL,
+      putchar);
+  uart_console_set_transport(&fixture, &uart_transport, FIXTURE_UART);
+
+  while (1) {
+    uart_console_poll(&operator, "> ");
+    uart_console_poll(&fixture, "");
+    sleep_ms(10);
+  }
+  return 0;
+}
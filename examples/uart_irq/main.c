@@ -0,0 +1,179 @@
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <string.h>
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "uart_console/console.h"
+
+#define UART_ID uart0
+#define UART_IRQ UART0_IRQ
+#define BAUD_RATE 115200
+#define UART_TX_PIN 0
+#define UART_RX_PIN 1
+// Output is drained by the UART TX interrupt.  Set to 1 to use a DMA
+// channel instead.
+#define TX_DRAIN_DMA 0
+
+struct ConsoleConfig cc;
+
+static void hello(uint8_t argc, char* argv[]) {
+  uart_console_write(&cc, "Hello World!\r\n", 14);
+}
+
+// shows how well the main loop is keeping up
+static void rx_stats(uint8_t argc, char* argv[]) {
+  char buffer[64];
+  snprintf(
+      buffer,
+      sizeof(buffer),
+      "overflows=%lu high_water=%u size=%u\r\n",
+      (unsigned long)cc.rx.overflows,
+      cc.rx.high_water,
+      CONSOLE_RX_BUFFER_SIZE);
+  uart_console_write(&cc, buffer, strlen(buffer));
+}
+
+// shows how well the drain is keeping up with console output
+static void tx_stats(uint8_t argc, char* argv[]) {
+  char buffer[80];
+  snprintf(
+      buffer,
+      sizeof(buffer),
+      "queued=%lu dropped=%lu high_water=%u size=%u\r\n",
+      (unsigned long)cc.tx_queued,
+      (unsigned long)cc.tx.overflows,
+      cc.tx.high_water,
+      CONSOLE_TX_BUFFER_SIZE);
+  uart_console_write(&cc, buffer, strlen(buffer));
+}
+
+// Configuration to register with uart_console_init_lowlevel()
+struct ConsoleCallback callbacks[] = {
+    {"hello", "Welcome message", 0, hello},
+    {"rx_stats", "Receive buffer statistics", 0, rx_stats},
+    {"tx_stats", "Transmit buffer statistics", 0, tx_stats},
+};
+
+static int uart_putchar(int c) {
+  uart_putc_raw(UART_ID, c);
+  return c;
+}
+
+#if TX_DRAIN_DMA
+static int dma_channel;
+static uint16_t dma_length;  // bytes in the transfer that is running
+
+// Releases the finished transfer and starts the next one
+static void dma_send_next(void) {
+  if (dma_channel_is_busy(dma_channel)) {
+    return;
+  }
+  uart_console_tx_consume(&cc, dma_length);
+  const char* data;
+  dma_length = uart_console_tx_peek(&cc, &data);
+  if (dma_length) {
+    dma_channel_transfer_from_buffer_now(dma_channel, data, dma_length);
+  }
+}
+
+static void on_dma_done(void) {
+  dma_channel_acknowledge_irq0(dma_channel);
+  dma_send_next();
+}
+
+static void tx_start(struct ConsoleConfig* unused) {
+  irq_set_enabled(DMA_IRQ_0, false);
+  dma_send_next();
+  irq_set_enabled(DMA_IRQ_0, true);
+}
+
+static void tx_drain_init(void) {
+  dma_channel = dma_claim_unused_channel(true);
+  dma_channel_config config = dma_channel_get_default_config(dma_channel);
+  channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+  channel_config_set_read_increment(&config, true);
+  channel_config_set_write_increment(&config, false);
+  channel_config_set_dreq(&config, uart_get_dreq(UART_ID, true));
+  dma_channel_configure(
+      dma_channel, &config, &uart_get_hw(UART_ID)->dr, NULL, 0, false);
+  dma_channel_set_irq0_enabled(dma_channel, true);
+  irq_set_exclusive_handler(DMA_IRQ_0, on_dma_done);
+  irq_set_enabled(DMA_IRQ_0, true);
+}
+#else
+// Fills the TX FIFO from the console's ring buffer.  The TX interrupt is
+// only left on while there is more to send.
+static void fill_tx_fifo(void) {
+  while (uart_is_writable(UART_ID)) {
+    const int c = uart_console_tx_pop(&cc);
+    if (c < 0) {
+      uart_set_irq_enables(UART_ID, true, false);
+      return;
+    }
+    uart_putc_raw(UART_ID, c);
+  }
+  uart_set_irq_enables(UART_ID, true, true);
+}
+
+static void tx_start(struct ConsoleConfig* unused) {
+  // The TX interrupt only fires when the FIFO drains past its threshold so
+  // the first bytes are written here, with the handler held off.
+  irq_set_enabled(UART_IRQ, false);
+  fill_tx_fifo();
+  irq_set_enabled(UART_IRQ, true);
+}
+
+static void tx_drain_init(void) {
+}
+#endif
+
+// Waits for room in the TX ring, see CONSOLE_TX_BLOCK
+static void tx_wait(struct ConsoleConfig* unused) {
+  tight_loop_contents();
+}
+
+static const struct ConsoleTxDrain tx_drain = {tx_start, tx_wait};
+
+// Only moves characters into the console's ring buffer.  Line editing and
+// callbacks happen later in uart_console_poll().
+static void on_uart_irq(void) {
+  while (uart_is_readable(UART_ID)) {
+    uart_console_rx_push(&cc, uart_getc(UART_ID));
+  }
+#if !TX_DRAIN_DMA
+  fill_tx_fifo();
+#endif
+}
+
+static void uart_irq_init(void) {
+  uart_init(UART_ID, BAUD_RATE);
+  gpio_set_function(UART_TX_PIN, GPIO_FUNC_UART);
+  gpio_set_function(UART_RX_PIN, GPIO_FUNC_UART);
+  irq_set_exclusive_handler(UART_IRQ, on_uart_irq);
+  irq_set_enabled(UART_IRQ, true);
+  uart_set_irq_enables(UART_ID, true, false);
+  tx_drain_init();
+}
+
+// program entry point
+int main() {
+  // The console must be initialized before the interrupt can push to it
+  uart_console_init_lowlevel(
+      &cc,
+      callbacks,
+      sizeof(callbacks) / sizeof(callbacks[0]),
+      CONSOLE_VT102,
+      uart_putchar);
+  uart_irq_init();
+  // a slow terminal should not hold up the main loop, so output that does
+  // not fit is dropped (see tx_stats)
+  uart_console_set_tx_drain(&cc, &tx_drain, CONSOLE_TX_DROP);
+
+  while (1) {
+    uart_console_poll(&cc, "> ");
+    // uart_console_rx_push() in the interrupt wakes this up
+    uart_console_wait(&cc, 100000);
+  }
+  return 0;
+}
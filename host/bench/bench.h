@@ -0,0 +1,76 @@
+#ifndef UART_CONSOLE_BENCH_H
+#define UART_CONSOLE_BENCH_H
+// Shared helpers for the host benchmark suite
+#include "uart_console/console.h"
+#include <inttypes.h>
+
+// Minimum time each measurement runs for.  Set with --quick.
+extern uint64_t bench_min_run_ns;
+
+// Number of bytes written to bench_putchar() so far
+extern uint64_t bench_output_bytes;
+
+// Number of calls made to bench_putchar() and bench_write() so far
+extern uint64_t bench_sink_calls;
+
+// Number of callbacks invoked so far
+extern uint64_t bench_callback_count;
+
+// Monotonic time in nanoseconds
+uint64_t bench_now_ns(void);
+
+// putchar sink that counts and discards bytes
+int bench_putchar(int c);
+
+// write/flush sinks (see uart_console_set_writer) that count and discard
+void bench_write(const char* data, size_t length);
+void bench_flush(void);
+
+// Callback that only counts invocations
+void bench_callback(uint8_t argc, char* argv[]);
+
+// Calls fn(ctx) repeatedly until bench_min_run_ns has passed.  Returns the
+// average nanoseconds per call and sets *calls.
+double bench_run(void (*fn)(void* ctx), void* ctx, uint64_t* calls);
+
+// A recorded keystroke sequence
+struct BenchCorpus {
+  const char* name;
+  const char* data;
+  uint32_t length;
+};
+
+// Built-in corpora plus any added with bench_add_corpus_file()
+uint8_t bench_corpus_count(void);
+const struct BenchCorpus* bench_corpus(uint8_t index);
+// Loads a raw capture (for example from a serial logger).  Returns 0 on error.
+uint8_t bench_add_corpus_file(const char* path);
+
+// Commands that the built-in corpora use
+extern struct ConsoleCallback bench_corpus_callbacks[];
+extern const uint8_t bench_corpus_callback_count;
+
+// Benchmark sections
+void bench_keystrokes(void);
+void bench_dispatch(void);
+void bench_history(void);
+void bench_rx_ring(void);
+void bench_dual_core(void);
+void bench_binary(void);
+void bench_line_queue(void);
+void bench_tasks(void);
+void bench_tokenize(void);
+void bench_args(void);
+void bench_format(void);
+void bench_redraw(void);
+void bench_tx_ring(void);
+void bench_stats(void);
+void bench_subcommands(void);
+void bench_instances(void);
+void bench_wakeup(void);
+void bench_screen(void);
+void bench_exec(void);
+void bench_line_cache(void);
+void bench_stream(void);
+
+#endif
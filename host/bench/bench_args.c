@@ -0,0 +1,211 @@
+// Typed arguments (ConsoleCallback.args): conversions, uniform error
+// messages, usage in help and tab completion of enum values are checked,
+// then dispatch of a typed command is timed against a raw callback that
+// converts and checks its own arguments.
+#include "bench.h"
+#include "parse_line.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CONSOLE_TYPED_ARGS
+static struct ConsoleConfig cc;
+static char output[512];
+static uint16_t output_length;
+static uint8_t last_argc;
+static union ConsoleValue last[CONSOLE_MAX_ARGS];
+
+static int capture_putchar(int c) {
+  if (output_length < sizeof(output) - 1) {
+    output[output_length++] = c;
+  }
+  return c;
+}
+
+static void record(uint8_t argc, const union ConsoleValue* argv) {
+  last_argc = argc;
+  memcpy(last, argv, sizeof(last));
+}
+
+// The same checks as move_args, written out by hand
+static void raw_move(uint8_t argc, char* argv[]) {
+  char* end;
+  const long x = strtol(argv[0], &end, 0);
+  if ((*argv[0] == '\0') || (*end != '\0')) {
+    printf("move: x \"%s\" is not an integer\n", argv[0]);
+    return;
+  }
+  const long y = strtol(argv[1], &end, 0);
+  if ((*argv[1] == '\0') || (*end != '\0')) {
+    printf("move: y \"%s\" is not an integer\n", argv[1]);
+    return;
+  }
+  float speed = 0;
+  if (argc > 2) {
+    speed = strtof(argv[2], &end);
+    if ((*argv[2] == '\0') || (*end != '\0')) {
+      printf("move: speed \"%s\" is not a number\n", argv[2]);
+      return;
+    }
+  }
+  last_argc = argc;
+  last[0].i = x;
+  last[1].i = y;
+  last[2].f = speed;
+}
+
+static const char* const modes[] = {"fast", "slow", "sleep", NULL};
+
+static const struct ConsoleArg on_ms_args[] = {
+  {"ms", CONSOLE_ARG_UNSIGNED, 1, 60000},
+};
+static const struct ConsoleArg move_args[] = {
+  {"x", CONSOLE_ARG_INT},
+  {"y", CONSOLE_ARG_INT},
+  {"speed", CONSOLE_ARG_FLOAT | CONSOLE_ARG_OPTIONAL},
+};
+static const struct ConsoleArg mode_args[] = {
+  {"mode", CONSOLE_ARG_ENUM, 0, 0, modes},
+};
+static const struct ConsoleArg peek_args[] = {
+  {"addr", CONSOLE_ARG_HEX},
+};
+static const struct ConsoleArg sum_args[] = {
+  {"n", CONSOLE_ARG_INT | CONSOLE_ARG_VARIADIC},
+};
+
+static struct ConsoleCallback callbacks[] = {
+  {"on_ms", "On time", 1, NULL, NULL, on_ms_args, record},
+  {"move", "Moves", 3, NULL, NULL, move_args, record},
+  {"mode", "Sets mode", 1, NULL, NULL, mode_args, record},
+  {"peek", "Reads memory", 1, NULL, NULL, peek_args, record},
+  {"sum", "Adds", 1, NULL, NULL, sum_args, record},
+  {"raw_move", "Moves", -1, raw_move},
+};
+
+static void fail(const char* msg, const char* line) {
+  fprintf(stderr, "args: %s: \"%s\"\n", msg, line);
+  fprintf(stderr, "output: \"%s\"\n", output);
+  exit(1);
+}
+
+static void run(const char* line) {
+  output_length = 0;
+  last_argc = 0xFF;
+  memset(last, 0xAA, sizeof(last));
+  for (const char* c = line; *c; ++c) {
+    uart_console_putchar(&cc, *c);
+  }
+  uart_console_putchar(&cc, '\r');
+  output[output_length] = '\0';
+}
+
+static void expect_error(const char* line, const char* message) {
+  run(line);
+  if ((last_argc != 0xFF) || strcmp(output, message)) {
+    fail("unexpected error message", line);
+  }
+}
+
+static void dispatch_line(void* vline) {
+  const char* line = vline;
+  const uint16_t length = strlen(line);
+  memcpy(cc.line, line, length + 1);
+  cc.line_length = length;
+  uart_console_parse_line(&cc);
+}
+
+void bench_args(void) {
+  printf("\n== args: typed arguments ==\n");
+  uart_console_init_lowlevel(
+      &cc,
+      callbacks,
+      sizeof(callbacks) / sizeof(callbacks[0]),
+      CONSOLE_MINIMAL,
+      capture_putchar);
+
+  run("on_ms 250");
+  if ((last_argc != 1) || (last[0].u != 250)) {
+    fail("unsigned", "on_ms 250");
+  }
+  run("move -3 0x10 1.5");
+  if ((last_argc != 3) || (last[0].i != -3) || (last[1].i != 16) ||
+      (last[2].f != 1.5f)) {
+    fail("int/float", "move -3 0x10 1.5");
+  }
+  run("move 1 2");
+  if ((last_argc != 2) || (last[2].f != 0)) {
+    fail("optional", "move 1 2");
+  }
+  run("mode sleep");
+  if ((last_argc != 1) || (last[0].u != 2)) {
+    fail("enum", "mode sleep");
+  }
+  run("peek 2000ABCD");
+  if ((last_argc != 1) || (last[0].u != 0x2000ABCD)) {
+    fail("hex", "peek 2000ABCD");
+  }
+  run("sum 1 2 3 4");
+  if ((last_argc != 4) || (last[3].i != 4)) {
+    fail("variadic", "sum 1 2 3 4");
+  }
+  run("sum");
+  if (last_argc != 0) {
+    fail("empty variadic", "sum");
+  }
+  printf("%-28s %10s\n", "conversions", "ok");
+
+  expect_error("on_ms", "on_ms: Usage: on_ms <ms>\n");
+  expect_error("move 1", "move: Usage: move <x> <y> [speed]\n");
+  expect_error("on_ms abc", "on_ms: ms \"abc\" is not an unsigned integer\n");
+  expect_error("on_ms -1", "on_ms: ms \"-1\" is not an unsigned integer\n");
+  expect_error("on_ms 0", "on_ms: ms must be 1 to 60000\n");
+  expect_error("move 1 2 fast", "move: speed \"fast\" is not a number\n");
+  expect_error("move 1 99999999999", "move: y \"99999999999\" is out of range\n");
+  expect_error("mode medium", "mode: mode must be one of: fast slow sleep\n");
+  expect_error("peek 0xZZ", "peek: addr \"0xZZ\" is not a hex number\n");
+  expect_error("sum 1 x", "sum: n \"x\" is not an integer\n");
+  printf("%-28s %10s\n", "error messages", "ok");
+
+  run("help");
+  if (!strstr(output, "move <x> <y> [speed]: Moves\n") ||
+      !strstr(output, "sum [n...]: Adds\n")) {
+    fail("usage missing from help", "help");
+  }
+  printf("%-28s %10s\n", "help usage", "ok");
+
+  cc.terminal = CONSOLE_VT102;
+  const char* typed = "mode s\t";
+  for (const char* c = typed; *c; ++c) {
+    uart_console_putchar(&cc, *c);
+  }
+  if ((cc.line_length != 7) || strncmp(cc.line, "mode sl", 7)) {
+    fail("enum value not completed", typed);
+  }
+  output_length = 0;
+  uart_console_putchar(&cc, '\t');
+  output[output_length] = '\0';
+  if (!strstr(output, "slow  sleep")) {
+    fail("enum values not listed", typed);
+  }
+  uart_console_putchar(&cc, 'o');
+  uart_console_putchar(&cc, '\t');
+  if ((cc.line_length != 9) || strncmp(cc.line, "mode slow", 9)) {
+    fail("enum value not completed", "mode slo\t");
+  }
+  uart_console_putchar(&cc, 0x03);
+  cc.terminal = CONSOLE_MINIMAL;
+  printf("%-28s %10s\n", "enum tab completion", "ok");
+
+  uint64_t calls;
+  printf("%-28s %10.1f ns\n", "typed move 10 -20 1.5",
+      bench_run(dispatch_line, "move 10 -20 1.5", &calls));
+  printf("%-28s %10.1f ns\n", "raw   move 10 -20 1.5",
+      bench_run(dispatch_line, "raw_move 10 -20 1.5", &calls));
+}
+#else
+void bench_args(void) {
+  printf("\n== args ==\n");
+  printf("typed arguments disabled\n");
+}
+#endif
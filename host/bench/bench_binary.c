@@ -0,0 +1,316 @@
+// Compares CONSOLE_BINARY frames with the equivalent text lines in
+// CONSOLE_MINIMAL mode, and checks that responses are framed as expected.
+#include "bench.h"
+#include "binary_frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CONSOLE_BINARY_MODE
+static void fail(const char* msg) {
+  fprintf(stderr, "binary: %s\n", msg);
+  exit(1);
+}
+
+// Encodes a request frame into out and returns its length
+static uint16_t encode_frame(
+    char* out,
+    uint8_t type,
+    uint8_t seq,
+    const char* const* args,
+    const uint8_t* arg_lengths,
+    uint8_t argc) {
+  uint16_t length = 0;
+  char* payload = out + 5;
+  for (uint8_t i=0; i<argc; ++i) {
+    payload[length++] = arg_lengths[i];
+    memcpy(payload + length, args[i], arg_lengths[i]);
+    length += arg_lengths[i];
+  }
+  out[0] = (char)CONSOLE_BINARY_SYNC;
+  out[1] = type;
+  out[2] = seq;
+  out[3] = length & 0xFF;
+  out[4] = length >> 8;
+  const uint16_t crc = binary_crc16(0xFFFF, out + 1, length + 4);
+  out[5 + length] = crc & 0xFF;
+  out[6 + length] = crc >> 8;
+  return length + 7;
+}
+
+// Captures the response frames
+static char response[256];
+static uint16_t response_length;
+
+static int capture_putchar(int c) {
+  if (response_length < sizeof(response)) {
+    response[response_length++] = c;
+  }
+  return c;
+}
+
+static struct ConsoleConfig* check_cc;
+static uint8_t binary_arg_ok;
+static uint8_t text_arg_ok;
+
+static void check_binary_arg(uint8_t argc, char* argv[]) {
+  static const char expected[] = {0, (char)0xFF, 'a', 0};
+  binary_arg_ok =
+    (argc == 1) &&
+    (uart_console_arg_length(check_cc, argv, 0) == sizeof(expected)) &&
+    !memcmp(argv[0], expected, sizeof(expected));
+  uart_console_binary_reply(check_cc, "pong", 4);
+}
+
+// a subcommand, so argv is not cc->arg + 1
+static void check_text_arg(uint8_t argc, char* argv[]) {
+  text_arg_ok =
+    (argc == 2) &&
+    (uart_console_arg_length(check_cc, argv, 0) == 5) &&
+    (uart_console_arg_length(check_cc, argv, 1) == 2);
+}
+
+#if CONSOLE_MAX_TASKS > 0
+static uint8_t task_arg_ok;
+
+// a resumable command, which gets a copy of its arguments
+static uint8_t check_task_arg(struct ConsoleTask* task) {
+  task_arg_ok =
+    (task->argc == 2) &&
+    !strcmp(task->argv[0], "hello") &&
+    !strcmp(task->argv[1], "xy");
+  return CONSOLE_TASK_DONE;
+}
+#endif
+
+// a frame that arrives while this runs is skipped rather than collected
+// over its argument
+static char nested_frame[16];
+static uint16_t nested_frame_length;
+static uint8_t nested_arg_ok;
+
+static void check_nested(uint8_t argc, char* argv[]) {
+  for (uint16_t i=0; i<nested_frame_length; ++i) {
+    uart_console_putchar(check_cc, nested_frame[i]);
+  }
+  nested_arg_ok = (argc == 1) && !strcmp(argv[0], "abc");
+  uart_console_binary_reply(check_cc, "x", 1);
+}
+
+// replies with its argument
+static void echo_arg(uint8_t argc, char* argv[]) {
+  uart_console_binary_reply(
+      check_cc, argv[0], uart_console_arg_length(check_cc, argv, 0));
+}
+
+static struct ConsoleCallback check_group[] = {
+  {"len", "Checks text argument lengths", 2, check_text_arg},
+};
+
+static struct ConsoleCallback check_callbacks[] = {
+  {"check", "Checks a binary argument", 1, check_binary_arg},
+  {"grp", "A group", 0, NULL, NULL, NULL, NULL, check_group, 1},
+  {"nest", "Receives a frame while running", 1, check_nested},
+  {"echo", "Replies with its argument", 1, echo_arg},
+#if CONSOLE_MAX_TASKS > 0
+  {"task", "Checks task argument lengths", 2, NULL, check_task_arg},
+#endif
+};
+
+static void feed(struct ConsoleConfig* cc, const char* data, uint16_t length) {
+  response_length = 0;
+  for (uint16_t i=0; i<length; ++i) {
+    uart_console_putchar(cc, data[i]);
+  }
+}
+
+static void check_responses(void) {
+  struct ConsoleConfig cc;
+  uart_console_init_lowlevel(
+      &cc,
+      check_callbacks,
+      sizeof(check_callbacks) / sizeof(check_callbacks[0]),
+      CONSOLE_BINARY,
+      capture_putchar);
+  check_cc = &cc;
+  char frame[64];
+
+  static const char arg[] = {0, (char)0xFF, 'a', 0};
+  const char* args[] = {arg};
+  const uint8_t lengths[] = {sizeof(arg)};
+  uint16_t length = encode_frame(frame, 0, 7, args, lengths, 1);
+  feed(&cc, frame, length);
+  // a data frame with "pong" then an empty OK frame
+  if (!binary_arg_ok || (response_length != 11 + 7) ||
+      (response[1] != CONSOLE_BINARY_DATA) || (response[2] != 7) ||
+      memcmp(response + 5, "pong", 4) ||
+      (response[12] != CONSOLE_BINARY_OK) ||
+      (binary_crc16(0xFFFF, response + 1, 8) !=
+       (uint8_t)response[9] + ((uint8_t)response[10] << 8))) {
+    fail("binary argument or reply");
+  }
+
+  length = encode_frame(frame, 9, 1, NULL, NULL, 0);
+  feed(&cc, frame, length);
+  if (response[1] != CONSOLE_BINARY_UNKNOWN) {
+    fail("unknown command");
+  }
+
+  length = encode_frame(frame, 0, 1, NULL, NULL, 0);
+  feed(&cc, frame, length);
+  if (response[1] != CONSOLE_BINARY_BAD_ARGS) {
+    fail("argument count");
+  }
+
+  length = encode_frame(frame, 0, 1, args, lengths, 1);
+  frame[6] ^= 1;
+  feed(&cc, frame, length);
+  if (response[1] != CONSOLE_BINARY_BAD_CRC) {
+    fail("bad crc");
+  }
+
+  // busy, then the data frame and OK of the outer one with its own seq
+  static const char* nested_args[] = {"zzz"};
+  static const uint8_t nested_lengths[] = {3};
+  nested_frame_length =
+    encode_frame(nested_frame, 2, 4, nested_args, nested_lengths, 1);
+  const char* outer_args[] = {"abc"};
+  const uint8_t outer_lengths[] = {3};
+  length = encode_frame(frame, 2, 3, outer_args, outer_lengths, 1);
+  feed(&cc, frame, length);
+  if (!nested_arg_ok || (response_length != 11 + 8 + 7) ||
+      (response[1] != CONSOLE_BINARY_BUSY) || (response[2] != 4) ||
+      (response[12] != CONSOLE_BINARY_DATA) || (response[13] != 3) ||
+      (response[20] != CONSOLE_BINARY_OK) || (response[21] != 3)) {
+    fail("frame received while a callback was running");
+  }
+
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  cc.remote_dispatch = 1;
+  length = encode_frame(frame, 0, 1, args, lengths, 1);
+  feed(&cc, frame, length);
+  cc.remote_dispatch = 0;
+  if (response[1] != CONSOLE_BINARY_UNSUPPORTED) {
+    fail("frame with remote dispatch");
+  }
+#endif
+
+#if CONSOLE_MAX_TASKS > 0
+  // a text line run in CONSOLE_BINARY mode, after the frames above
+  uart_console_exec(&cc, "task hello xy");
+  uart_console_run_tasks(&cc);
+  if (!task_arg_ok) {
+    fail("argument length of a task started by uart_console_exec()");
+  }
+#endif
+
+  cc.terminal = CONSOLE_MINIMAL;
+  feed(&cc, "grp len hello xy\r", 17);
+  if (!text_arg_ok) {
+    fail("argument length of a text subcommand");
+  }
+  printf("%-28s %10s\n", "responses", "ok");
+}
+
+// Like the Pico SDK's putchar() with its default settings
+static int crlf_putchar(int c) {
+  if (c == '\n') {
+    capture_putchar('\r');
+  }
+  return capture_putchar(c);
+}
+
+// Frames with 0x0A in the seq and payload go through a putchar() that
+// translates "\n", as uart_console_init() sets up
+static void check_newlines(void) {
+  struct ConsoleConfig cc;
+  uart_console_init_lowlevel(
+      &cc,
+      check_callbacks,
+      sizeof(check_callbacks) / sizeof(check_callbacks[0]),
+      CONSOLE_BINARY,
+      crlf_putchar);
+  uart_console_set_binary_putchar(&cc, capture_putchar);
+  check_cc = &cc;
+  static const char arg[] = {'a', '\n', '\n', 'b'};
+  const char* args[] = {arg};
+  const uint8_t lengths[] = {sizeof(arg)};
+  char frame[64];
+  // echo is entry 3 in check_callbacks
+  const uint16_t length = encode_frame(frame, 3, '\n', args, lengths, 1);
+  feed(&cc, frame, length);
+  // the data frame holds the argument, then an empty OK frame
+  if ((response_length != 11 + 7) ||
+      (response[1] != CONSOLE_BINARY_DATA) || (response[2] != '\n') ||
+      memcmp(response + 5, arg, sizeof(arg)) ||
+      (response[12] != CONSOLE_BINARY_OK) || (response[13] != '\n')) {
+    fail("a 0x0A byte was translated");
+  }
+  printf("%-28s %10s\n", "0x0A bytes", "ok");
+}
+
+struct StreamContext {
+  struct ConsoleConfig* cc;
+  const char* data;
+  uint16_t length;
+};
+
+static void stream(void* vctx) {
+  const struct StreamContext* ctx = vctx;
+  for (uint16_t i=0; i<ctx->length; ++i) {
+    uart_console_putchar(ctx->cc, ctx->data[i]);
+  }
+}
+
+static double time_stream(
+    uint8_t terminal, const char* data, uint16_t length, double* out_bytes) {
+  struct ConsoleConfig cc;
+  uart_console_init_lowlevel(
+      &cc,
+      bench_corpus_callbacks,
+      bench_corpus_callback_count,
+      terminal,
+      bench_putchar);
+  struct StreamContext ctx = {&cc, data, length};
+  const uint64_t callbacks_start = bench_callback_count;
+  const uint64_t output_start = bench_output_bytes;
+  stream(&ctx);
+  if (bench_callback_count - callbacks_start != 1) {
+    fail("command did not run");
+  }
+  *out_bytes = bench_output_bytes - output_start;
+  uint64_t calls;
+  return bench_run(stream, &ctx, &calls);
+}
+
+void bench_binary(void) {
+  printf("\n== binary: CONSOLE_BINARY vs CONSOLE_MINIMAL ==\n");
+  check_responses();
+  check_newlines();
+
+  static const char text[] = "set_terminal \"vt 102\"\r";
+  char frame[64];
+  const char* args[] = {"vt 102"};
+  const uint8_t lengths[] = {6};
+  // set_terminal is entry 6 in bench_corpus_callbacks
+  const uint16_t frame_length = encode_frame(frame, 6, 0, args, lengths, 1);
+
+  double text_out;
+  double frame_out;
+  const double text_ns =
+    time_stream(CONSOLE_MINIMAL, text, sizeof(text) - 1, &text_out);
+  const double frame_ns =
+    time_stream(CONSOLE_BINARY, frame, frame_length, &frame_out);
+  printf("%-10s %10s %10s %10s %12s\n",
+      "format", "in bytes", "out bytes", "ns/cmd", "cmds/sec");
+  printf("%-10s %10d %10.0f %10.1f %12.0f\n",
+      "text", (int)sizeof(text) - 1, text_out, text_ns, 1e9 / text_ns);
+  printf("%-10s %10d %10.0f %10.1f %12.0f\n",
+      "binary", frame_length, frame_out, frame_ns, 1e9 / frame_ns);
+}
+#else
+void bench_binary(void) {
+  printf("\n== binary ==\n");
+  printf("binary mode disabled\n");
+}
+#endif
@@ -0,0 +1,117 @@
+// Recorded keystroke sequences that are replayed by the benchmarks.  Escape
+// sequences are what a typical terminal emulator (TERM=vt102) sends.
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UP "\x1b[A"
+#define DOWN "\x1b[B"
+#define RIGHT "\x1b[C"
+#define LEFT "\x1b[D"
+#define BS "\x08"
+#define CTRL_A "\x01"
+#define CTRL_C "\x03"
+#define CTRL_E "\x05"
+
+// Plain typing with no corrections
+static const char typing[] =
+  "hello\r"
+  "on_ms 250\r"
+  "off_ms 750\r"
+  "state\r"
+  "set_terminal vt102\r"
+  "get_terminal\r"
+  "list_terminals\r"
+  "set_terminal \"vt 102\"\r"
+  "set_terminal vt\\ 102\r"
+  "helo\r";
+
+// Typos fixed with backspace, arrows and ctrl-a/ctrl-e
+static const char editing[] =
+  "on_ms 25" BS BS "500\r"
+  "of_ms 500" CTRL_A RIGHT RIGHT "f\r"
+  "state" LEFT LEFT RIGHT CTRL_E "\r"
+  "hello wrld" LEFT LEFT LEFT "o" CTRL_E CTRL_C
+  "sate" CTRL_A RIGHT "t\r"
+  "set_terminal ech" BS BS BS "vt102" LEFT LEFT LEFT LEFT LEFT BS BS BS BS
+  "get" CTRL_E BS BS BS BS BS BS BS "terminal\r";
+
+// Command history recall
+static const char history[] =
+  "on_ms 100\r"
+  "off_ms 100\r"
+  UP UP "\r"
+  UP UP DOWN "\r"
+  UP BS BS BS "200\r"
+  UP UP UP UP DOWN DOWN DOWN DOWN "state\r";
+
+// Tab completion
+static const char tab[] =
+  "he\t\r"
+  "on\t 300\r"
+  "s\t\t\t\r"
+  "get\t\r"
+  "li\t\r"
+  "off\t 20\r";
+
+#define CORPUS(n) {#n, n, sizeof(n) - 1}
+#define MAX_CORPORA 16
+
+static struct BenchCorpus corpora[MAX_CORPORA] = {
+  CORPUS(typing),
+  CORPUS(editing),
+  CORPUS(history),
+  CORPUS(tab),
+};
+static uint8_t num_corpora = 4;
+
+struct ConsoleCallback bench_corpus_callbacks[] = {
+  {"hello", "Welcome message", 0, bench_callback},
+  {"on_ms", "On time in ms", 1, bench_callback},
+  {"off_ms", "Off time in ms", 1, bench_callback},
+  {"state", "Dump current state", 0, bench_callback},
+  {"get_terminal", "Gets terminal", 0, bench_callback},
+  {"list_terminals", "List known terminals", 0, bench_callback},
+  {"set_terminal", "Sets terminal", 1, bench_callback},
+};
+const uint8_t bench_corpus_callback_count =
+  sizeof(bench_corpus_callbacks) / sizeof(bench_corpus_callbacks[0]);
+
+uint8_t bench_corpus_count(void) {
+  return num_corpora;
+}
+
+const struct BenchCorpus* bench_corpus(uint8_t index) {
+  return corpora + index;
+}
+
+uint8_t bench_add_corpus_file(const char* path) {
+  if (num_corpora >= MAX_CORPORA) {
+    fprintf(stderr, "Too many corpora (>%d)\n", MAX_CORPORA);
+    return 0;
+  }
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return 0;
+  }
+  fseek(f, 0, SEEK_END);
+  const long length = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char* data = malloc(length > 0 ? length : 1);
+  if (fread(data, 1, length, f) != (size_t)length) {
+    perror(path);
+    fclose(f);
+    free(data);
+    return 0;
+  }
+  fclose(f);
+
+  struct BenchCorpus* corpus = corpora + num_corpora;
+  corpus->name = path;
+  corpus->data = data;
+  corpus->length = length;
+  ++num_corpora;
+  return 1;
+}
@@ -0,0 +1,153 @@
+// Measures uart_console_parse_line() for typical lines and as the number of
+// registered callbacks grows, and checks CONSOLE_COMMAND registration.
+#include "bench.h"
+#include "parse_line.h"
+#include "util.h"
+#include "vt102_tab_complete.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_CALLBACKS 1024
+static char names[MAX_CALLBACKS][12];
+static struct ConsoleCallback scaling_callbacks[MAX_CALLBACKS];
+
+// Registered out of order to exercise the index sort.  These are the only
+// CONSOLE_COMMAND entries in the benchmark.
+CONSOLE_COMMAND(reg_zeta, "Registered test command", 0, bench_callback);
+CONSOLE_COMMAND(reg_alpha, "Registered test command", 1, bench_callback);
+CONSOLE_COMMAND(reg_mid, "Registered test command", -1, bench_callback);
+
+struct DispatchContext {
+  struct ConsoleConfig* cc;
+  const char* line;
+  uint16_t length;
+};
+
+static void dispatch(void* vctx) {
+  const struct DispatchContext* ctx = vctx;
+  memcpy(ctx->cc->line, ctx->line, ctx->length);
+  ctx->cc->line_length = ctx->length;
+  uart_console_parse_line(ctx->cc);
+}
+
+static double time_dispatch(struct ConsoleConfig* cc, const char* line) {
+  struct DispatchContext ctx = {cc, line, strlen(line)};
+  uint64_t calls;
+  return bench_run(dispatch, &ctx, &calls);
+}
+
+// A single tab press on line
+static void tab(void* vctx) {
+  const struct DispatchContext* ctx = vctx;
+  memcpy(ctx->cc->line, ctx->line, ctx->length);
+  ctx->cc->line_length = ctx->length;
+  ctx->cc->cursor_index = ctx->length;
+  ctx->cc->tab_count = 0;
+  vt102_tab_pressed(ctx->cc);
+}
+
+static double time_tab(struct ConsoleConfig* cc, const char* line) {
+  struct DispatchContext ctx = {cc, line, strlen(line)};
+  uint64_t calls;
+  return bench_run(tab, &ctx, &calls);
+}
+
+// Makes sure that line dispatches to a callback (or not)
+static void check_dispatch(
+    struct ConsoleConfig* cc, const char* line, uint8_t expect_callback) {
+  struct DispatchContext ctx = {cc, line, strlen(line)};
+  const uint64_t start = bench_callback_count;
+  dispatch(&ctx);
+  console_reset_line(cc);  // as process_char() does, even after an error
+  if ((bench_callback_count != start) != expect_callback) {
+    fprintf(stderr, "dispatch of \"%s\" was incorrect\n", line);
+    exit(1);
+  }
+}
+
+static void init_scaling_callbacks(void) {
+  for (uint16_t i=0; i<MAX_CALLBACKS; ++i) {
+    snprintf(names[i], sizeof(names[i]), "cmd_%04d", i);
+    scaling_callbacks[i].command = names[i];
+    scaling_callbacks[i].description = "Scaling test command";
+    scaling_callbacks[i].num_args = -1;
+    scaling_callbacks[i].callback = bench_callback;
+  }
+}
+
+// Commands from CONSOLE_COMMAND are found when init is given no table
+static void check_registered(struct ConsoleConfig* cc) {
+  uart_console_init_lowlevel(cc, NULL, 0, CONSOLE_MINIMAL, bench_putchar);
+  if (cc->callback_count != 3) {
+    fprintf(stderr, "found %d registered commands, expected 3\n",
+        cc->callback_count);
+    exit(1);
+  }
+  check_dispatch(cc, "reg_alpha 1", 1);
+  check_dispatch(cc, "reg_alpha", 0);  // wrong number of arguments
+  check_dispatch(cc, "reg_mid a b c", 1);
+  check_dispatch(cc, "reg_zeta", 1);
+  check_dispatch(cc, "reg_beta", 0);
+#if CONSOLE_COMMAND_INDEX_SIZE > 0
+  static const char* sorted[] = {"reg_alpha", "reg_mid", "reg_zeta"};
+  for (uint8_t i=0; i<3; ++i) {
+    if (strcmp(cc->callbacks[cc->command_index[i]].command, sorted[i])) {
+      fprintf(stderr, "registered commands were not sorted\n");
+      exit(1);
+    }
+  }
+#endif
+  printf("%-24s %10.1f\n", "reg_zeta (registered)", time_dispatch(cc, "reg_zeta"));
+}
+
+void bench_dispatch(void) {
+  struct ConsoleConfig cc;
+  uart_console_init_lowlevel(
+      &cc,
+      bench_corpus_callbacks,
+      bench_corpus_callback_count,
+      CONSOLE_MINIMAL,
+      bench_putchar);
+
+  static const char* lines[] = {
+    "hello",
+    "state",
+    "set_terminal vt102",
+    "set_terminal \"vt 102\"",
+    "set_terminal vt\\ 102",
+    "on_ms 1 2 3 4 5 6 7 8",
+    "unknown_command",
+  };
+  printf("\n== dispatch: uart_console_parse_line() ==\n");
+  printf("%-24s %10s\n", "line", "ns/line");
+  for (uint8_t i=0; i < sizeof(lines) / sizeof(lines[0]); ++i) {
+    printf("%-24s %10.1f\n", lines[i], time_dispatch(&cc, lines[i]));
+  }
+  check_registered(&cc);
+
+  init_scaling_callbacks();
+  static const uint16_t counts[] = {1, 2, 4, 8, 16, 32, 64, 128, 255, 1024};
+  printf("\n== dispatch scaling: ns/line vs callback_count ==\n");
+  printf("CONSOLE_COMMAND_INDEX_SIZE=%d\n", CONSOLE_COMMAND_INDEX_SIZE);
+  printf("%9s %10s %10s %10s %10s\n",
+      "callbacks", "first", "last", "unknown", "tab");
+  for (uint8_t i=0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+    const uint16_t count = counts[i];
+    uart_console_init_lowlevel(
+        &cc,
+        scaling_callbacks,
+        count,
+        CONSOLE_MINIMAL,
+        bench_putchar);
+    check_dispatch(&cc, names[0], 1);
+    check_dispatch(&cc, names[count - 1], 1);
+    check_dispatch(&cc, "cmd_zzz", 0);
+    printf("%9d %10.1f %10.1f %10.1f %10.1f\n",
+        count,
+        time_dispatch(&cc, names[0]),
+        time_dispatch(&cc, names[count - 1]),
+        time_dispatch(&cc, "cmd_zzz"),
+        time_tab(&cc, "cmd_00"));
+  }
+}
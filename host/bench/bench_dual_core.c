@@ -0,0 +1,105 @@
+// Runs the console the way a dual core RP2040 would, with two threads.  The
+// main thread plays core1 (uart_console_poll, editing, parsing) and a second
+// thread plays core0 (uart_console_run_commands).  Commands and replies must
+// all arrive and any loss is a fatal error.
+#include "bench.h"
+#include "pico/stdlib.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if (CONSOLE_COMMAND_QUEUE_SLOTS > 0) && (CONSOLE_REPLY_BUFFER_SIZE > 0)
+static struct ConsoleConfig cc;
+static volatile uint8_t done;
+static uint32_t pings;  // only touched by the core0 thread until joined
+
+static void ping(uint8_t argc, char* argv[]) {
+  ++pings;
+  uart_console_reply_write(&cc, "ok\n", 3);
+}
+
+static struct ConsoleCallback callbacks[] = {
+  {"ping", "Replies with ok", -1, ping},
+};
+
+struct Core0Stats {
+  uint64_t run_ns;
+  uint64_t max_ns;
+  uint32_t commands;
+};
+
+static void* core0_main(void* vctx) {
+  struct Core0Stats* stats = vctx;
+  while (1) {
+    const uint8_t finished = __atomic_load_n(&done, __ATOMIC_ACQUIRE);
+    const uint64_t start = bench_now_ns();
+    const uint8_t count = uart_console_run_commands(&cc);
+    if (count) {
+      const uint64_t elapsed = bench_now_ns() - start;
+      stats->run_ns += elapsed;
+      stats->commands += count;
+      if (elapsed / count > stats->max_ns) {
+        stats->max_ns = elapsed / count;
+      }
+    } else if (finished) {
+      break;
+    } else {
+      sched_yield();  // matters when there is only one cpu
+    }
+  }
+  return NULL;
+}
+
+void bench_dual_core(void) {
+  printf("\n== dual_core: CONSOLE_COMMAND_QUEUE_SLOTS=%d ==\n",
+      CONSOLE_COMMAND_QUEUE_SLOTS);
+  uart_console_init_lowlevel(&cc, callbacks, 1, CONSOLE_MINIMAL, bench_putchar);
+  uart_console_set_remote_dispatch(&cc, NULL);
+  done = 0;
+  pings = 0;
+
+  static const char line[] = "ping 1 \"2 3\" 4\\ 5\r";
+  const uint32_t lines = (bench_min_run_ns / 10000000) * 20000;
+  const uint64_t output_start = bench_output_bytes;
+  struct Core0Stats stats = {0, 0, 0};
+  uint64_t poll_ns = 0;
+
+  pthread_t core0;
+  const uint64_t start = bench_now_ns();
+  pthread_create(&core0, NULL, core0_main, &stats);
+  for (uint32_t i=0; i<lines; ++i) {
+    while (uart_console_command_queue_depth(&cc) >= CONSOLE_COMMAND_QUEUE_SLOTS) {
+      uart_console_poll(&cc, "");  // keep replies moving
+      sched_yield();
+    }
+    host_stdio_set_input(line, sizeof(line) - 1);
+    const uint64_t poll_start = bench_now_ns();
+    uart_console_poll(&cc, "");
+    poll_ns += bench_now_ns() - poll_start;
+  }
+  __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+  pthread_join(core0, NULL);
+  uart_console_poll(&cc, "");  // last replies
+  const uint64_t elapsed = bench_now_ns() - start;
+
+  const uint64_t reply_bytes = bench_output_bytes - output_start;
+  if ((pings != lines) || (stats.commands != lines) ||
+      (cc.commands.overflows != 0) ||
+      (reply_bytes + cc.reply.overflows != (uint64_t)lines * 3)) {
+    fprintf(stderr, "dual_core: commands or replies were lost\n");
+    exit(1);
+  }
+  printf("%-28s %10.0f\n", "commands/sec", lines * 1e9 / elapsed);
+  printf("%-28s %10.1f\n", "core1 ns/line (poll)", (double)poll_ns / lines);
+  printf("%-28s %10.1f\n", "core0 ns/command (mean)", (double)stats.run_ns / lines);
+  printf("%-28s %10" PRIu64 "\n", "core0 ns/command (max)", stats.max_ns);
+  printf("%-28s %10d\n", "queue high water", cc.commands.high_water);
+  printf("%-28s %10" PRIu32 "\n", "reply overflows", cc.reply.overflows);
+}
+#else
+void bench_dual_core(void) {
+  printf("\n== dual_core ==\n");
+  printf("command queue or reply buffer disabled\n");
+}
+#endif
@@ -0,0 +1,205 @@
+// uart_console_exec() and uart_console_run_script().  Checks that a line
+// being typed and the arguments of a calling callback survive, that scripts
+// stop at the right line, then compares running a command directly with
+// typing it.
+#include "bench.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct ConsoleConfig cc;
+static char last_args[CONSOLE_MAX_LINE_CHARS + 1];
+
+static void fail(const char* msg) {
+  fprintf(stderr, "exec: %s\n", msg);
+  exit(1);
+}
+
+// remembers its arguments, joined with '|'
+static void record(uint8_t argc, char* argv[]) {
+  last_args[0] = '\0';
+  for (uint8_t i=0; i<argc; ++i) {
+    if (i) {
+      strcat(last_args, "|");
+    }
+    strcat(last_args, argv[i]);
+  }
+}
+
+// runs another command and then checks its own arguments.  With
+// CONSOLE_COMMAND_QUEUE_SLOTS the other command only runs after this returns.
+static void nested(uint8_t argc, char* argv[]) {
+  uart_console_exec(&cc, "record inner \"x y\"");
+  if ((argc != 2) || strcmp(argv[0], "outer") || strcmp(argv[1], "args")) {
+    fail("caller's arguments were overwritten");
+  }
+}
+
+// results of calling uart_console_exec() and uart_console_run_script()
+// from a callback
+static uint8_t remote_exec_result;
+static uint16_t remote_script_result;
+
+static void exec_from_callback(uint8_t argc, char* argv[]) {
+  remote_exec_result = uart_console_exec(&cc, "record remote");
+  remote_script_result = uart_console_run_script(&cc, "record remote");
+}
+
+static const struct ConsoleCallback callbacks[] = {
+  {"record", "Records its arguments", -1, record},
+  {"nested", "Runs record", 2, nested},
+  {"on_ms", "On time in ms", 1, bench_callback},
+  {"off_ms", "Off time in ms", 1, bench_callback},
+  {"state", "Dump current state", 0, bench_callback},
+  {"exec", "Calls uart_console_exec()", 0, exec_from_callback},
+};
+
+static void init(uint8_t mode) {
+  uart_console_init_lowlevel(
+      &cc,
+      callbacks,
+      sizeof(callbacks) / sizeof(callbacks[0]),
+      mode,
+      bench_putchar);
+}
+
+static void check_exec(void) {
+  init(CONSOLE_VT102);
+  host_stdio_set_input(NULL, 0);
+  uart_console_poll(&cc, "> ");
+  // a half typed line with the cursor in the middle
+  const char* typed = "on_ms 12\x1b[D";
+  for (const char* c = typed; *c; ++c) {
+    uart_console_putchar(&cc, *c);
+  }
+  if (uart_console_exec(&cc, "record a \"b c\" d\\ e") != CONSOLE_EXEC_OK) {
+    fail("exec failed");
+  }
+  if (strcmp(last_args, "a|b c|d e")) {
+    fail("wrong arguments");
+  }
+  if ((cc.line_length != 8) || memcmp(cc.line, "on_ms 12", 8) ||
+      (cc.cursor_index != 7) || !cc.prompt_displayed) {
+    fail("typed line was changed");
+  }
+#if CONSOLE_HISTORY_LINES > 0
+  if (uart_console_history(&cc, 0, last_args) >= 0) {
+    fail("exec added to history");
+  }
+#endif
+  uart_console_putchar(&cc, '\r');
+  if (bench_callback_count == 0) {
+    fail("typed line did not run");
+  }
+
+  if (uart_console_exec(&cc, "nested outer args") != CONSOLE_EXEC_OK) {
+    fail("nested exec failed");
+  }
+  if (strcmp(last_args, "inner|x y")) {
+    fail("nested command got the wrong arguments");
+  }
+  if ((uart_console_exec(&cc, "") != CONSOLE_EXEC_OK) ||
+      (uart_console_exec(&cc, "bogus") != CONSOLE_EXEC_UNKNOWN) ||
+      (uart_console_exec(&cc, "on_ms") != CONSOLE_EXEC_BAD_ARGS) ||
+      (uart_console_exec(&cc, "record \"open") != CONSOLE_EXEC_BAD_ARGS)) {
+    fail("wrong result");
+  }
+  char long_line[CONSOLE_MAX_LINE_CHARS + 2];
+  memset(long_line, 'x', sizeof(long_line) - 1);
+  long_line[sizeof(long_line) - 1] = '\0';
+  if (uart_console_exec(&cc, long_line) != CONSOLE_EXEC_TOO_LONG) {
+    fail("long line accepted");
+  }
+
+  static const char script[] =
+    "# comment\n"
+    "\n"
+    "record one\r\n"
+    "  # indented comment\n"
+    "record two\n"
+    "bogus\n"
+    "record three\n";
+  if (uart_console_run_script(&cc, script) != 6) {
+    fail("script did not stop at line 6");
+  }
+  if (strcmp(last_args, "two")) {
+    fail("script ran the wrong lines");
+  }
+  if ((uart_console_run_script(&cc, "record last") != 0) ||
+      strcmp(last_args, "last")) {
+    fail("script without a final newline");
+  }
+
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  // this thread plays both cores: the line is queued, then run as the
+  // other core would
+  init(CONSOLE_MINIMAL);
+  uart_console_set_remote_dispatch(&cc, NULL);
+  const char* remote = "exec\r";
+  for (const char* c = remote; *c; ++c) {
+    uart_console_putchar(&cc, *c);
+  }
+  uart_console_run_commands(&cc);
+  if ((remote_exec_result != CONSOLE_EXEC_REMOTE) ||
+      (remote_script_result != 1) || !strcmp(last_args, "remote") ||
+      (uart_console_command_queue_depth(&cc) != 0)) {
+    fail("exec from a remote dispatch callback was not refused");
+  }
+#endif
+}
+
+struct TypeContext {
+  const char* line;
+  uint16_t length;
+};
+
+static void type_line(void* vctx) {
+  const struct TypeContext* ctx = vctx;
+  for (uint16_t i=0; i<ctx->length; ++i) {
+    uart_console_putchar(&cc, ctx->line[i]);
+  }
+}
+
+static void exec_line(void* vctx) {
+  const struct TypeContext* ctx = vctx;
+  uart_console_exec(&cc, ctx->line);
+}
+
+static const char setup_script[] =
+  "# blink setup\n"
+  "on_ms 100\n"
+  "off_ms 900\n"
+  "state\n"
+  "on_ms 250\n"
+  "off_ms 750\n"
+  "state\n"
+  "on_ms 500\n"
+  "off_ms 500\n";
+#define SETUP_LINES 8
+
+static void run_script(void* unused) {
+  uart_console_run_script(&cc, setup_script);
+}
+
+void bench_exec(void) {
+  printf("\n== exec: running commands without the terminal ==\n");
+  check_exec();
+  printf("%-28s %10s\n", "how", "ns/line");
+
+  static const char line[] = "on_ms 250";
+  struct TypeContext typed = {"on_ms 250\r", sizeof(line)};
+  struct TypeContext direct = {line, sizeof(line) - 1};
+  uint64_t calls;
+  init(CONSOLE_VT102);
+  printf("%-28s %10.1f\n", "typed, vt102",
+      bench_run(type_line, &typed, &calls));
+  init(CONSOLE_MINIMAL);
+  printf("%-28s %10.1f\n", "typed, minimal",
+      bench_run(type_line, &typed, &calls));
+  init(CONSOLE_VT102);
+  printf("%-28s %10.1f\n", "uart_console_exec",
+      bench_run(exec_line, &direct, &calls));
+  printf("%-28s %10.1f\n", "uart_console_run_script",
+      bench_run(run_script, NULL, &calls) / SETUP_LINES);
+}
@@ -0,0 +1,167 @@
+// The console's streaming formatter (src/format.c) is checked against the
+// C library's vsnprintf() for the conversions it supports and then timed
+// against vsnprintf() into a buffer followed by a write, which is what
+// console_printf() used to do.
+#include "bench.h"
+#include "format.h"
+#include "util.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char output[1024];
+static uint16_t output_length;
+static uint32_t pieces;
+
+static void capture(void* ctx, const char* data, uint16_t length) {
+  memcpy(output + output_length, data, length);
+  output_length += length;
+  ++pieces;
+}
+
+static void check(const char* fmt, ...) {
+  char expected[sizeof(output)];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(expected, sizeof(expected), fmt, args);
+  va_end(args);
+
+  output_length = 0;
+  va_start(args, fmt);
+  console_vformat(capture, NULL, fmt, args);
+  va_end(args);
+  output[output_length] = '\0';
+  if (strcmp(output, expected)) {
+    fprintf(stderr, "format: \"%s\" gave \"%s\", expected \"%s\"\n",
+        fmt, output, expected);
+    exit(1);
+  }
+}
+
+// For conversions that vsnprintf() formats but the console does not
+static void check_text(const char* expected, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  output_length = 0;
+  console_vformat(capture, NULL, fmt, args);
+  va_end(args);
+  output[output_length] = '\0';
+  if (strcmp(output, expected)) {
+    fprintf(stderr, "format: \"%s\" gave \"%s\", expected \"%s\"\n",
+        fmt, output, expected);
+    exit(1);
+  }
+}
+
+// Unsupported conversions are copied but their arguments are still skipped
+static void check_unsupported(void) {
+  check_text("%e on_ms", "%e %s", 1.5, "on_ms");
+#if !CONSOLE_FORMAT_FLOAT
+  check_text("%f on_ms", "%f %s", 1.5, "on_ms");
+#endif
+  check_text("%llu on_ms 7", "%llu %s %d", 1ULL << 40, "on_ms", 7);
+  check_text("%lld on_ms", "%lld %s", -1LL, "on_ms");
+  check_text("%p on_ms", "%p %s", (void*)&output, "on_ms");
+  check_text("%zu %jd %td on_ms", "%zu %jd %td %s",
+      sizeof(output), (intmax_t)-1, (ptrdiff_t)2, "on_ms");
+  check_text("%o %Lf on_ms", "%o %Lf %s", 8, (long double)1.5, "on_ms");
+  // an unknown letter stops formatting, as its argument size is unknown
+  check_text("1 %k %s", "%d %k %s", 1, 2, "on_ms");
+}
+
+static void check_all(void) {
+  check("plain text");
+  check("");
+  check("%%");
+  check("%d %i %d %d", 0, 42, -42, -2147483647 - 1);
+  check("%u %u", 0u, 4294967295u);
+  check("%x %X %x", 0xdeadbeefu, 0xdeadbeefu, 0u);
+  check("%ld %lu %lx", -1234567890L, 4000000000UL, 0xabcdefUL);
+  check("[%5d] [%-5d] [%05d] [%+d] [%+d]", 42, 42, -42, 7, -7);
+  check("[%03d %02x ]", 7, 0x0a);
+  check("[%*d] [%-*d]", 6, 1, 6, 1);
+  check("[%s] [%10s] [%-10s] [%.3s] [%-8.2s]", "abc", "abc", "abc", "abcdef", "xyz");
+  check("[%c] [%3c] [%-3c]", 'a', 'b', 'c');
+  check("%hd %hhu", 5, 6);
+  check("%s: Expected %d arguments\n", "on_ms", 2);
+  check("Unknown Command \"%s\".  Try ? or \"help\".\n", "bogus");
+#if CONSOLE_FORMAT_FLOAT
+  check("%f %f %f", 0.0, 1.5, -2.25);
+  check("%.2f %.0f %.3f %8.3f %-8.1f|", 3.14159, 2.7, 0.0004, -1.25, 9.87);
+  check("%+.1f %.9f", 12.34, 0.123456789);
+  check("%.1f %.2f %f", 4294967296.0, 1e15 + 0.25, -98765432109.5);
+  check("%.0f %f", 12345678901234567890.0, 18446744073709549568.0);
+#endif
+}
+
+static struct ConsoleConfig cc;
+
+struct FormatCase {
+  const char* name;
+  const char* fmt;
+};
+
+static const char* long_string;
+
+static void console_case(void* ctx) {
+  const struct FormatCase* fc = ctx;
+  console_printf(&cc, fc->fmt, "on_ms", 250, -3, 0xbeefu, long_string);
+  console_flush(&cc);
+}
+
+// The old console_printf()
+static void vsnprintf_format(struct ConsoleConfig* cc, const char* fmt, ...) {
+  static char printf_buffer[256];
+  va_list args;
+  va_start(args, fmt);
+  int length = vsnprintf(printf_buffer, sizeof(printf_buffer) - 1, fmt, args);
+  va_end(args);
+  if (length >= (int)sizeof(printf_buffer) - 1) {
+    length = sizeof(printf_buffer) - 2;  // truncated
+  }
+  console_write(cc, printf_buffer, length);
+}
+
+static void vsnprintf_case(void* ctx) {
+  const struct FormatCase* fc = ctx;
+  vsnprintf_format(&cc, fc->fmt, "on_ms", 250, -3, 0xbeefu, long_string);
+  console_flush(&cc);
+}
+
+void bench_format(void) {
+  printf("\n== format: console_vformat() vs vsnprintf() ==\n");
+  check_all();
+  check_unsupported();
+  printf("%-28s %10s\n", "matches vsnprintf", "ok");
+
+  // output longer than the old 255 byte buffer is not cut off
+  static char long_buffer[601];
+  memset(long_buffer, 'x', 600);
+  long_string = long_buffer;
+  output_length = 0;
+  pieces = 0;
+  check("%s %s", "long:", long_string);
+  printf("%-28s %10u\n", "600 char %s, bytes out", output_length);
+  printf("%-28s %10u\n", "600 char %s, writes", pieces);
+
+  uart_console_init_lowlevel(&cc, NULL, 0, CONSOLE_MINIMAL, bench_putchar);
+  uart_console_set_writer(&cc, bench_write, bench_flush);
+  static const struct FormatCase cases[] = {
+    {"text", "Command queue full\n"},
+    {"%s: %d", "%s: Expected %d arguments\n"},
+    {"%s %5d %-4d %08x", "%s %5d %-4d %08x\n"},
+    {"... %.200s", "%s %d %d %x %.200s\n"},
+  };
+  printf("%-28s %10s %10s\n", "ns per call", "vformat", "vsnprintf");
+  for (uint8_t i=0; i<sizeof(cases) / sizeof(cases[0]); ++i) {
+    uint64_t calls;
+    const double streaming =
+      bench_run(console_case, (void*)(cases + i), &calls);
+    const double buffered =
+      bench_run(vsnprintf_case, (void*)(cases + i), &calls);
+    printf("%-28s %10.1f %10.1f\n", cases[i].name, streaming, buffered);
+  }
+}
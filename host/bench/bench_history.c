@@ -0,0 +1,153 @@
+// Measures command history cost at the compiled-in CONSOLE_HISTORY_LINES
+#include "bench.h"
+#include "parse_line.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UP "\x1b[A"
+#define DOWN "\x1b[B"
+#define CTRL_A "\x01"
+#define CTRL_C "\x03"
+#define CTRL_R "\x12"
+
+#if CONSOLE_HISTORY_LINES > 0
+static void feed(struct ConsoleConfig* cc, const char* s) {
+  for (; *s; ++s) {
+    uart_console_putchar(cc, *s);
+  }
+}
+
+static uint32_t enter_count;
+
+// Enters alternating lines so that every line is pushed to history
+static void enter_line(void* vctx) {
+  struct ConsoleConfig* cc = vctx;
+  const char* line = (++enter_count & 1) ? "on_ms 100" : "off_ms 100";
+  const uint16_t length = strlen(line);
+  memcpy(cc->line, line, length);
+  cc->line_length = length;
+  uart_console_parse_line(cc);
+}
+
+// Walks from the newest to the oldest history entry
+static void walk_history(void* vctx) {
+  struct ConsoleConfig* cc = vctx;
+  for (uint16_t i=0; i<cc->history_count; ++i) {
+    feed(cc, UP);
+  }
+  feed(cc, CTRL_C);
+}
+
+// Checks that the newest entries survive eviction and that up arrow
+// recalls them in order
+static void check_history(struct ConsoleConfig* cc) {
+  char line[CONSOLE_MAX_LINE_CHARS + 1];
+  char expected[32];
+  const uint16_t count = cc->history_count;
+  for (uint16_t i=0; i<count; ++i) {
+    snprintf(expected, sizeof(expected), "on_ms %d", 1000 - i);
+    if ((uart_console_history(cc, i, line) < 0) || strcmp(line, expected)) {
+      printf("history entry %d is \"%s\", expected \"%s\"\n",
+          i, line, expected);
+      exit(1);
+    }
+    feed(cc, UP);
+    if (strcmp(cc->line, expected)) {
+      printf("up arrow %d shows \"%s\", expected \"%s\"\n",
+          i + 1, cc->line, expected);
+      exit(1);
+    }
+  }
+  feed(cc, CTRL_C);
+  if (uart_console_history(cc, count, line) >= 0) {
+    printf("history holds more than %d entries\n", count);
+    exit(1);
+  }
+}
+
+static void expect_line(
+    const struct ConsoleConfig* cc, const char* what, const char* expected) {
+  if ((cc->line_length != strlen(expected)) ||
+      memcmp(cc->line, expected, cc->line_length)) {
+    printf("%s shows \"%.*s\", expected \"%s\"\n",
+        what, cc->line_length, cc->line, expected);
+    exit(1);
+  }
+}
+
+// Checks ctrl-r search and prefix-filtered arrows
+static void check_search(struct ConsoleConfig* cc) {
+  feed(cc, "state\roff_ms 7\r");
+  feed(cc, CTRL_R "ms 99");
+  expect_line(cc, "ctrl-r", "on_ms 999");
+  feed(cc, CTRL_R);
+  expect_line(cc, "second ctrl-r", "on_ms 998");
+  feed(cc, "\x08" "\x7f" "7");  // backspace and DEL
+  expect_line(cc, "ctrl-r after backspace", "off_ms 7");
+  feed(cc, CTRL_A);
+  expect_line(cc, "ended search", "off_ms 7");
+  if (cc->history_search || (cc->cursor_index != 0)) {
+    printf("ctrl-a did not end the search\n");
+    exit(1);
+  }
+  feed(cc, CTRL_C "of" UP);
+  expect_line(cc, "up arrow after \"of\"", "off_ms 7");
+  feed(cc, UP);
+  expect_line(cc, "second up arrow after \"of\"", "off_ms 7");
+  feed(cc, DOWN);
+  expect_line(cc, "down arrow after \"of\"", "of");
+  feed(cc, CTRL_C "on_ms 99" UP);
+  expect_line(cc, "up arrow after \"on_ms 99\"", "on_ms 999");
+  feed(cc, UP);
+  expect_line(cc, "second up arrow after \"on_ms 99\"", "on_ms 998");
+  feed(cc, CTRL_C);
+}
+
+// A search that has to look at every entry before failing
+static void search_miss(void* vctx) {
+  struct ConsoleConfig* cc = vctx;
+  feed(cc, CTRL_R "z" CTRL_C);
+}
+
+void bench_history(void) {
+  printf("\n== history: CONSOLE_HISTORY_LINES=%d ==\n", CONSOLE_HISTORY_LINES);
+  struct ConsoleConfig cc;
+  uart_console_init_lowlevel(
+      &cc,
+      bench_corpus_callbacks,
+      bench_corpus_callback_count,
+      CONSOLE_VT102,
+      bench_putchar);
+  // overfill so that the oldest entries are evicted
+  char line[32];
+  for (uint16_t i=1; i<=1000; ++i) {
+    snprintf(line, sizeof(line), "on_ms %d\r", i);
+    feed(&cc, line);
+  }
+  check_history(&cc);
+  check_search(&cc);
+  printf("%-28s %10d\n", "entries held", cc.history_count);
+  printf("%-28s %10d\n", "bytes used", cc.history_used);
+
+  uint64_t calls;
+  printf("%-28s %10.1f\n", "ns/enter (history push)",
+      bench_run(enter_line, &cc, &calls));
+
+  const uint64_t output_start = bench_output_bytes;
+  walk_history(&cc);
+  const double bytes_per_up =
+    (double)(bench_output_bytes - output_start) / cc.history_count;
+  const double ns_per_up =
+    bench_run(walk_history, &cc, &calls) / cc.history_count;
+  printf("%-28s %10.1f\n", "ns/up-arrow", ns_per_up);
+  printf("%-28s %10.1f\n", "output bytes/up-arrow", bytes_per_up);
+  printf("%-28s %10.1f\n", "ns/ctrl-r miss",
+      bench_run(search_miss, &cc, &calls));
+}
+#else
+void bench_history(void) {
+  printf("\n== history: CONSOLE_HISTORY_LINES=0 ==\n");
+  printf("history disabled\n");
+}
+#endif
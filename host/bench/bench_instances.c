@@ -0,0 +1,147 @@
+// Several consoles at once.  Two consoles with their own transports share
+// one callbacks table whose handler replies on the console that received
+// the command.  They are first polled from one loop, then each from its own
+// thread the way two cores would, and any reply on the wrong console is a
+// fatal error.
+#include "bench.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_PORTS 2
+#define LINES 2000
+
+// One device, as seen through a transport
+struct Port {
+  const char* name;
+  const char* input;
+  uint32_t input_length;
+  uint32_t read;
+  uint32_t budget;  // characters port_read() may return before the next poll
+  uint32_t replies;  // "from <name>" lines seen in the output
+  uint32_t wrong_replies;  // replies that name another port
+  char pending[32];  // start of an output line, for matching replies
+  uint8_t pending_length;
+};
+
+static void port_write(struct ConsoleConfig* cc, const char* data, size_t length) {
+  struct Port* port = uart_console_context(cc);
+  for (size_t i=0; i<length; ++i) {
+    if (data[i] != '\n') {
+      if (port->pending_length < sizeof(port->pending) - 1) {
+        port->pending[port->pending_length++] = data[i];
+      }
+      continue;
+    }
+    port->pending[port->pending_length] = '\0';
+    port->pending_length = 0;
+    if (strncmp(port->pending, "from ", 5)) {
+      continue;
+    }
+    if (strcmp(port->pending + 5, port->name)) {
+      ++port->wrong_replies;
+    } else {
+      ++port->replies;
+    }
+  }
+}
+
+static int port_read(struct ConsoleConfig* cc) {
+  struct Port* port = uart_console_context(cc);
+  if ((port->read >= port->input_length) || (port->budget == 0)) {
+    return -1;
+  }
+  --port->budget;
+  return (uint8_t)port->input[port->read++];
+}
+
+static const struct ConsoleTransport transport = {port_read, port_write, NULL};
+
+static void whoami(struct ConsoleConfig* cc, uint8_t argc, char* argv[]) {
+  const struct Port* port = uart_console_context(cc);
+  uart_console_printf(cc, "from %s\n", port->name);
+}
+
+// shared by all of the consoles
+static const struct ConsoleCallback callbacks[] = {
+  {"whoami", "Names the console", 0, NULL, .handler = whoami},
+};
+
+static struct ConsoleConfig consoles[NUM_PORTS];
+static struct Port ports[NUM_PORTS];
+static char input[LINES * 8];
+
+static void init_ports(void) {
+  uint32_t length = 0;
+  for (uint32_t i=0; i<LINES; ++i) {
+    memcpy(input + length, "whoami\r", 7);
+    length += 7;
+  }
+  static const char* names[NUM_PORTS] = {"usb", "uart1"};
+  for (uint8_t i=0; i<NUM_PORTS; ++i) {
+    memset(ports + i, 0, sizeof(ports[i]));
+    ports[i].name = names[i];
+    ports[i].input = input;
+    ports[i].input_length = length;
+    uart_console_init_lowlevel(
+        consoles + i, callbacks, 1, CONSOLE_MINIMAL, bench_putchar);
+    uart_console_set_transport(consoles + i, &transport, ports + i);
+  }
+}
+
+static void check_ports(const char* how) {
+  for (uint8_t i=0; i<NUM_PORTS; ++i) {
+    if ((ports[i].replies != LINES) || ports[i].wrong_replies) {
+      fprintf(stderr, "instances (%s): %s got %u replies and %u for others\n",
+          how, ports[i].name, ports[i].replies, ports[i].wrong_replies);
+      exit(1);
+    }
+  }
+}
+
+static void* poll_thread(void* vctx) {
+  struct ConsoleConfig* cc = vctx;
+  struct Port* port = uart_console_context(cc);
+  while (port->read < port->input_length) {
+    // small polls so that the consoles take turns even on one cpu
+    port->budget = 64;
+    uart_console_poll(cc, "> ");
+    sched_yield();
+  }
+  return NULL;
+}
+
+void bench_instances(void) {
+  printf("\n== instances: %d consoles, one callbacks table ==\n", NUM_PORTS);
+  printf("%-28s %10s\n", "how", "ns/line");
+
+  // one loop, with a few characters from each console at a time
+  init_ports();
+  uint64_t start = bench_now_ns();
+  for (uint8_t busy = 1; busy; ) {
+    busy = 0;
+    for (uint8_t i=0; i<NUM_PORTS; ++i) {
+      ports[i].budget = 5;  // lines are split between polls
+      busy |= uart_console_poll(consoles + i, "> ") > 0;
+    }
+  }
+  uint64_t elapsed = bench_now_ns() - start;
+  check_ports("one loop");
+  printf("%-28s %10.1f\n", "one loop", (double)elapsed / (LINES * NUM_PORTS));
+
+  // a thread per console
+  init_ports();
+  pthread_t threads[NUM_PORTS];
+  start = bench_now_ns();
+  for (uint8_t i=0; i<NUM_PORTS; ++i) {
+    pthread_create(threads + i, NULL, poll_thread, consoles + i);
+  }
+  for (uint8_t i=0; i<NUM_PORTS; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  elapsed = bench_now_ns() - start;
+  check_ports("threads");
+  printf("%-28s %10.1f\n", "thread each", (double)elapsed / (LINES * NUM_PORTS));
+}
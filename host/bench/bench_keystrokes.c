@@ -0,0 +1,76 @@
+// Replays keystroke corpora through uart_console_putchar() in each mode
+#include "bench.h"
+#include <stdio.h>
+
+struct ReplayContext {
+  struct ConsoleConfig* cc;
+  const struct BenchCorpus* corpus;
+};
+
+static void replay(void* vctx) {
+  const struct ReplayContext* ctx = vctx;
+  const char* data = ctx->corpus->data;
+  const uint32_t length = ctx->corpus->length;
+  for (uint32_t i=0; i<length; ++i) {
+    uart_console_putchar(ctx->cc, data[i]);
+  }
+}
+
+struct ModeName {
+  const char* name;
+  uint8_t mode;
+  uint8_t use_writer;
+};
+
+static const struct ModeName modes[] = {
+  {"minimal", CONSOLE_MINIMAL, 0},
+  {"echo", CONSOLE_ECHO, 0},
+  {"vt102", CONSOLE_VT102, 0},
+  {"echo+w", CONSOLE_ECHO, 1},
+  {"vt102+w", CONSOLE_VT102, 1},
+};
+#define NUM_MODES (sizeof(modes) / sizeof(modes[0]))
+
+void bench_keystrokes(void) {
+  printf("\n== keystrokes: uart_console_putchar() replay ==\n");
+  printf("(+w: output through uart_console_set_writer)\n");
+  printf("%-8s %-16s %12s %10s %12s %12s\n",
+      "mode", "corpus", "chars/sec", "ns/key", "out/in bytes", "sink calls");
+  for (uint8_t m=0; m<NUM_MODES; ++m) {
+    for (uint8_t i=0; i<bench_corpus_count(); ++i) {
+      struct ConsoleConfig cc;
+      uart_console_init_lowlevel(
+          &cc,
+          bench_corpus_callbacks,
+          bench_corpus_callback_count,
+          modes[m].mode,
+          bench_putchar);
+      if (modes[m].use_writer) {
+        uart_console_set_writer(&cc, bench_write, bench_flush);
+      }
+      struct ReplayContext ctx = {&cc, bench_corpus(i)};
+      const uint32_t length = ctx.corpus->length;
+
+      // output is measured on a steady-state replay
+      replay(&ctx);
+      const uint64_t output_start = bench_output_bytes;
+      const uint64_t calls_start = bench_sink_calls;
+      replay(&ctx);
+      const double out_per_in =
+        (double)(bench_output_bytes - output_start) / length;
+      const double calls_per_in =
+        (double)(bench_sink_calls - calls_start) / length;
+
+      uint64_t calls;
+      const double ns_per_replay = bench_run(replay, &ctx, &calls);
+      const double ns_per_key = ns_per_replay / length;
+      printf("%-8s %-16s %12.0f %10.1f %12.2f %12.2f\n",
+          modes[m].name,
+          ctx.corpus->name,
+          1e9 / ns_per_key,
+          ns_per_key,
+          out_per_in,
+          calls_per_in);
+    }
+  }
+}
@@ -0,0 +1,208 @@
+// The parsed-line cache (CONSOLE_LINE_CACHE) and the built-in "repeat"
+// command.  Checks that a line run from the cache gets the same arguments as
+// one split from scratch, and that repeat calls its command the right number
+// of times with unchanged arguments, then times a repeated line, lines that
+// keep missing the cache, and a call made by repeat.
+#include "bench.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct ConsoleConfig cc;
+static char last_args[CONSOLE_MAX_LINE_CHARS + 1];
+static uint32_t record_calls;
+
+static void fail(const char* msg) {
+  fprintf(stderr, "line_cache: %s\n", msg);
+  exit(1);
+}
+
+// remembers its arguments, joined with '|', then scribbles over them
+static void record(uint8_t argc, char* argv[]) {
+  ++record_calls;
+  last_args[0] = '\0';
+  for (uint8_t i=0; i<argc; ++i) {
+    if (i) {
+      strcat(last_args, "|");
+    }
+    strcat(last_args, argv[i]);
+    argv[i][0] = '#';
+  }
+}
+
+static uint8_t background(struct ConsoleTask* task) {
+  return CONSOLE_TASK_DONE;
+}
+
+static const struct ConsoleCallback pin_commands[] = {
+  {"set", "Sets a pin", 2, record},
+  {"get", "Reads a pin", 1, record},
+};
+
+static const struct ConsoleCallback callbacks[] = {
+  {"record", "Records its arguments", -1, record},
+  {"pin", "GPIO pins", 0, NULL, NULL, NULL, NULL, pin_commands, 2},
+  {"background", "A resumable command", 0, NULL, background},
+  {"on_ms", "On time in ms", 1, bench_callback},
+  {"off_ms", "Off time in ms", 1, bench_callback},
+};
+
+static void init(void) {
+  uart_console_init_lowlevel(&cc, callbacks, 5, CONSOLE_VT102, bench_putchar);
+  host_stdio_set_input(NULL, 0);
+  uart_console_poll(&cc, "> ");
+}
+
+struct Case {
+  const char* line;
+  const char* args;  // what record() sees
+};
+
+static void check_cases(void) {
+  static const struct Case cases[] = {
+    {"record a \"b c\" d\\ e", "a|b c|d e"},
+    {"pin set 4 1", "4|1"},
+    {"record  spaced   out ", "spaced|out"},
+    {"pin get 7", "7"},
+  };
+  const uint8_t count = sizeof(cases) / sizeof(cases[0]);
+  init();
+  for (uint8_t round=0; round<3; ++round) {
+    for (uint8_t i=0; i<count; ++i) {
+      if (uart_console_exec(&cc, cases[i].line) != CONSOLE_EXEC_OK) {
+        fail("exec failed");
+      }
+      if (strcmp(last_args, cases[i].args)) {
+        fprintf(stderr, "line_cache: \"%s\" gave \"%s\" in round %u\n",
+            cases[i].line, last_args, round);
+        exit(1);
+      }
+    }
+  }
+  // a bad line stays bad
+  for (uint8_t round=0; round<2; ++round) {
+    if (uart_console_exec(&cc, "pin set 4") != CONSOLE_EXEC_BAD_ARGS) {
+      fail("bad arguments accepted");
+    }
+  }
+  // typed lines use the cache too
+  const char* typed = "pin get 7\r";
+  for (const char* c = typed; *c; ++c) {
+    uart_console_putchar(&cc, *c);
+  }
+  if (strcmp(last_args, "7")) {
+    fail("typed line gave the wrong arguments");
+  }
+#if CONSOLE_LINE_CACHE >= 4
+  // 4 lines and the bad line miss once, typing the same line hits
+  if ((cc.line_cache_misses != 5) || (cc.line_cache_hits != 10)) {
+    fprintf(stderr, "line_cache: %u hits and %u misses\n",
+        cc.line_cache_hits, cc.line_cache_misses);
+    exit(1);
+  }
+
+  // lines that name no command do not push cached ones out
+  init();
+  for (uint8_t i=0; i<count; ++i) {
+    uart_console_exec(&cc, cases[i].line);
+  }
+  uart_console_exec(&cc, "help");
+  uart_console_exec(&cc, "bogus");
+  uart_console_exec(&cc, "");
+  const uint32_t hits = cc.line_cache_hits;
+  for (uint8_t i=0; i<count; ++i) {
+    uart_console_exec(&cc, cases[i].line);
+  }
+  if (cc.line_cache_hits != hits + count) {
+    fail("a line that is not a command replaced a cached one");
+  }
+#endif
+}
+
+static void check_repeat(void) {
+  init();
+  record_calls = 0;
+  if ((uart_console_exec(&cc, "repeat 5 record a \"b c\"") != CONSOLE_EXEC_OK) ||
+      (record_calls != 5) || strcmp(last_args, "a|b c")) {
+    fail("repeat 5 did not run record 5 times with the same arguments");
+  }
+  record_calls = 0;
+  if ((uart_console_exec(&cc, "repeat 0x3 pin set 2 0") != CONSOLE_EXEC_OK) ||
+      (record_calls != 3) || strcmp(last_args, "2|0")) {
+    fail("repeat of a subcommand");
+  }
+  static const char* bad[] = {
+    "repeat",
+    "repeat 3",
+    "repeat 0 record",
+    "repeat -1 record",
+    "repeat 100001 record",
+    "repeat 99999999999999999999 record",
+    "repeat 3x record",
+    "repeat x record",
+    "repeat 3 pin",
+    "repeat 3 pin set 1",
+  };
+  record_calls = 0;
+  for (uint8_t i=0; i<sizeof(bad) / sizeof(bad[0]); ++i) {
+    if (uart_console_exec(&cc, bad[i]) != CONSOLE_EXEC_BAD_ARGS) {
+      fprintf(stderr, "line_cache: \"%s\" was accepted\n", bad[i]);
+      exit(1);
+    }
+  }
+  if ((uart_console_exec(&cc, "repeat 3 bogus") != CONSOLE_EXEC_UNKNOWN) ||
+      (uart_console_exec(&cc, "repeat 3 background") !=
+       CONSOLE_EXEC_UNSUPPORTED)) {
+    fail("repeat of an unknown or resumable command");
+  }
+  if (record_calls) {
+    fail("a rejected repeat ran its command");
+  }
+}
+
+struct ExecContext {
+  const char* const* lines;
+  uint8_t count;
+  uint8_t next;
+};
+
+static void exec_next(void* vctx) {
+  struct ExecContext* ctx = vctx;
+  uart_console_exec(&cc, ctx->lines[ctx->next]);
+  if (++ctx->next >= ctx->count) {
+    ctx->next = 0;
+  }
+}
+
+#define REPEAT_COUNT 1000
+
+void bench_line_cache(void) {
+  printf("\n== line_cache: %d cached lines, repeat ==\n", CONSOLE_LINE_CACHE);
+  check_cases();
+#if CONSOLE_REPEAT
+  check_repeat();
+#endif
+  printf("%-28s %10s\n", "how", "ns/command");
+
+  static const char* same[] = {"pin set 25 1"};
+  // more different lines than any cache in the benchmark builds holds
+  static const char* cycle[] = {
+    "pin set 25 1", "pin set 25 0", "on_ms 100", "off_ms 900",
+    "pin get 3", "on_ms 250", "off_ms 750", "pin set 2 1",
+  };
+  struct ExecContext ctx = {same, 1, 0};
+  uint64_t calls;
+  init();
+  printf("%-28s %10.1f\n", "same line",
+      bench_run(exec_next, &ctx, &calls));
+  ctx = (struct ExecContext){cycle, sizeof(cycle) / sizeof(cycle[0]), 0};
+  printf("%-28s %10.1f\n", "8 different lines",
+      bench_run(exec_next, &ctx, &calls));
+#if CONSOLE_REPEAT
+  static const char* repeat[] = {"repeat 1000 pin set 25 1"};
+  ctx = (struct ExecContext){repeat, 1, 0};
+  printf("%-28s %10.1f\n", "repeat, per call",
+      bench_run(exec_next, &ctx, &calls) / REPEAT_COUNT);
+#endif
+}
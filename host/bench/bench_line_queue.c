@@ -0,0 +1,160 @@
+// Pipelined input: a host sends lines back-to-back while a long running
+// callback keeps the console alive by calling uart_console_poll().  The
+// lines must be queued (not run recursively or lost) and then run in order.
+// With or without the queue, a callback's arguments must survive input
+// that a nested poll receives.
+#include "bench.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct ConsoleConfig cc;
+
+static void fail(const char* msg) {
+  fprintf(stderr, "line_queue: %s\n", msg);
+  exit(1);
+}
+
+static uint8_t hold_arg_ok;
+
+// Polls while the next line is half received, then checks its argument
+static void hold(uint8_t argc, char* argv[]) {
+  if (strcmp(argv[0], "abc")) {
+    return;  // the nested line, if it ever runs
+  }
+  static const char nested[] = "hold zzz";
+  host_stdio_set_input(nested, sizeof(nested) - 1);
+  uart_console_poll(&cc, "");
+  hold_arg_ok = !strcmp(argv[0], "abc");
+}
+
+static struct ConsoleCallback hold_callbacks[] = {
+  {"hold", "Polls while running", 1, hold},
+};
+
+static void check_nested_args(void) {
+  uart_console_init_lowlevel(
+      &cc, hold_callbacks, 1, CONSOLE_MINIMAL, bench_putchar);
+  hold_arg_ok = 0;
+  static const char line[] = "hold abc\r";
+  host_stdio_set_input(line, sizeof(line) - 1);
+  uart_console_poll(&cc, "");
+  if (!hold_arg_ok) {
+    fail("a nested poll overwrote the callback's arguments");
+  }
+  if ((cc.line_length != 8) || memcmp(cc.line, "hold zzz", 8)) {
+    fail("the line started during a nested poll was not kept");
+  }
+  printf("%-28s %10s\n", "arguments kept", "ok");
+}
+
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+static uint8_t depth;
+static uint8_t max_depth;
+static uint32_t marks_seen;
+static uint8_t marks_in_order;
+
+// Stands in for a long operation that polls to stay responsive
+static void slow(uint8_t argc, char* argv[]) {
+  ++depth;
+  if (depth > max_depth) {
+    max_depth = depth;
+  }
+  uart_console_poll(&cc, "");
+  --depth;
+}
+
+static void mark(uint8_t argc, char* argv[]) {
+  ++depth;
+  if (depth > max_depth) {
+    max_depth = depth;
+  }
+  ++marks_seen;
+  if ((uint32_t)atoi(argv[0]) != marks_seen) {
+    marks_in_order = 0;
+  }
+  --depth;
+}
+
+static struct ConsoleCallback callbacks[] = {
+  {"slow", "Polls while running", 0, slow},
+  {"mark", "Records its argument", 1, mark},
+};
+
+// Sends "slow" followed by marks lines, all at once
+static void pipeline(uint32_t marks) {
+  static char input[4096];
+  uint32_t length = snprintf(input, sizeof(input), "slow\r");
+  for (uint32_t i=1; i<=marks; ++i) {
+    length += snprintf(input + length, sizeof(input) - length, "mark %u\r", i);
+  }
+  uart_console_init_lowlevel(&cc, callbacks, 2, CONSOLE_MINIMAL, bench_putchar);
+  depth = 0;
+  max_depth = 0;
+  marks_seen = 0;
+  marks_in_order = 1;
+  host_stdio_set_input(input, length);
+  uart_console_poll(&cc, "");
+}
+
+void bench_line_queue(void) {
+  printf("\n== line_queue: CONSOLE_COMMAND_QUEUE_SLOTS=%d ==\n",
+      CONSOLE_COMMAND_QUEUE_SLOTS);
+  check_nested_args();
+
+  // "slow" holds one slot while it runs
+  const uint32_t fits = CONSOLE_COMMAND_QUEUE_SLOTS - 1;
+  pipeline(fits);
+  if ((max_depth != 1) || (marks_seen != fits) || !marks_in_order ||
+      (cc.commands.overflows != 0)) {
+    fail("pipelined lines were not queued in order");
+  }
+  printf("%-28s %10s\n", "pipelined lines", "ok");
+  printf("%-28s %10d\n", "queue high water", cc.commands.high_water);
+
+  const uint32_t extra = 3;
+  pipeline(fits + extra);
+  if ((max_depth != 1) || (marks_seen != fits) || !marks_in_order ||
+      (cc.commands.overflows != extra)) {
+    fail("overflow was not reported");
+  }
+  printf("%-28s %10s\n", "overflow accounting", "ok");
+
+  // the nested poll stops in the middle of a line, which must be kept
+  static const char partial[] = "slow\rmark 1\rmar";
+  uart_console_init_lowlevel(&cc, callbacks, 2, CONSOLE_MINIMAL, bench_putchar);
+  marks_seen = 0;
+  marks_in_order = 1;
+  host_stdio_set_input(partial, sizeof(partial) - 1);
+  uart_console_poll(&cc, "");
+  host_stdio_set_input("k 2\r", 4);
+  uart_console_poll(&cc, "");
+  if ((marks_seen != 2) || !marks_in_order) {
+    fail("a line started during a nested poll was lost");
+  }
+  printf("%-28s %10s\n", "nested partial line", "ok");
+
+#if CONSOLE_REPEAT
+  // lines received while "repeat" runs its command are queued too
+  static const char repeated[] = "repeat 2 slow\rmark 1\rmark 2\r";
+  uart_console_init_lowlevel(&cc, callbacks, 2, CONSOLE_MINIMAL, bench_putchar);
+  depth = 0;
+  max_depth = 0;
+  marks_seen = 0;
+  marks_in_order = 1;
+  host_stdio_set_input(repeated, sizeof(repeated) - 1);
+  uart_console_poll(&cc, "");
+  if ((max_depth != 1) || (marks_seen != 2) || !marks_in_order) {
+    fail("lines received during repeat were not queued");
+  }
+  printf("%-28s %10s\n", "polled from repeat", "ok");
+#endif
+}
+#else
+void bench_line_queue(void) {
+  printf("\n== line_queue ==\n");
+  printf("command queue disabled\n");
+  check_nested_args();
+}
+#endif
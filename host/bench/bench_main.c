@@ -0,0 +1,84 @@
+// Host benchmark suite for the console core.
+//
+// usage: uart_console_bench [--quick] [--corpus file]... [section]...
+//
+// sections: keystrokes dispatch history rx_ring dual_core binary
+// line_queue tasks tokenize args format redraw tx_ring stats subcommands
+// instances wakeup screen exec line_cache stream
+// (default: all)
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+
+struct BenchSection {
+  const char* name;
+  void (*run)(void);
+};
+
+static const struct BenchSection sections[] = {
+  {"keystrokes", bench_keystrokes},
+  {"dispatch", bench_dispatch},
+  {"history", bench_history},
+  {"rx_ring", bench_rx_ring},
+  {"dual_core", bench_dual_core},
+  {"binary", bench_binary},
+  {"line_queue", bench_line_queue},
+  {"tasks", bench_tasks},
+  {"tokenize", bench_tokenize},
+  {"args", bench_args},
+  {"format", bench_format},
+  {"redraw", bench_redraw},
+  {"tx_ring", bench_tx_ring},
+  {"stats", bench_stats},
+  {"subcommands", bench_subcommands},
+  {"instances", bench_instances},
+  {"wakeup", bench_wakeup},
+  {"screen", bench_screen},
+  {"exec", bench_exec},
+  {"line_cache", bench_line_cache},
+  {"stream", bench_stream},
+};
+#define NUM_SECTIONS (sizeof(sections) / sizeof(sections[0]))
+
+static int usage(const char* argv0) {
+  fprintf(stderr, "usage: %s [--quick] [--corpus file]... [section]...\n", argv0);
+  fprintf(stderr, "sections:");
+  for (uint8_t i=0; i<NUM_SECTIONS; ++i) {
+    fprintf(stderr, " %s", sections[i].name);
+  }
+  fprintf(stderr, "\n");
+  return 1;
+}
+
+int main(int argc, char* argv[]) {
+  uint8_t selected[NUM_SECTIONS] = {0};
+  uint8_t any_selected = 0;
+  for (int i=1; i<argc; ++i) {
+    if (!strcmp(argv[i], "--quick")) {
+      bench_min_run_ns = 10000000;
+    } else if (!strcmp(argv[i], "--corpus") && (i + 1 < argc)) {
+      if (!bench_add_corpus_file(argv[++i])) {
+        return 1;
+      }
+    } else {
+      uint8_t found = 0;
+      for (uint8_t s=0; s<NUM_SECTIONS; ++s) {
+        if (!strcmp(argv[i], sections[s].name)) {
+          selected[s] = 1;
+          any_selected = 1;
+          found = 1;
+        }
+      }
+      if (!found) {
+        return usage(argv[0]);
+      }
+    }
+  }
+
+  for (uint8_t s=0; s<NUM_SECTIONS; ++s) {
+    if (!any_selected || selected[s]) {
+      sections[s].run();
+    }
+  }
+  return 0;
+}
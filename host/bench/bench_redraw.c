@@ -0,0 +1,167 @@
+// Bytes sent to redraw the line when it is replaced (history recall).  Each
+// redraw is replayed on a model of an insert mode VT102 terminal to check
+// that it leaves the new line and cursor on screen, then its size is
+// compared with erasing and retyping the whole line as the console used to.
+#include "bench.h"
+#include "util.h"
+#include "vt102_screen.h"
+#include "vt102_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct ConsoleConfig cc;
+static char output[CONSOLE_MAX_LINE_CHARS * 2 + 64];
+static uint16_t output_length;
+
+static int capture_putchar(int c) {
+  if (output_length < sizeof(output)) {
+    output[output_length++] = c;
+  }
+  return c;
+}
+
+static void fail(const char* msg, const char* from, const char* to) {
+  fprintf(stderr, "redraw: %s: \"%s\" -> \"%s\"\n", msg, from, to);
+  exit(1);
+}
+
+// bytes in ESC [ <n> <command>
+static uint32_t escape_bytes(uint16_t n) {
+  uint32_t bytes = 4;
+  for (; n >= 10; n /= 10) {
+    ++bytes;
+  }
+  return bytes;
+}
+
+// What erasing and retyping the whole line sends
+static uint32_t reference_bytes(
+    uint16_t cursor, uint16_t old_length, uint16_t new_length) {
+  return (cursor ? escape_bytes(cursor) : 0) +
+    (old_length ? escape_bytes(old_length) : 0) + new_length;
+}
+
+struct RedrawTotals {
+  uint32_t redraws;
+  uint64_t reference_bytes;
+  uint64_t bytes;
+};
+
+// Replaces from with to (with the cursor at cursor), checks the result and
+// adds up the bytes
+static void redraw(
+    const char* from, uint16_t cursor, const char* to,
+    struct RedrawTotals* totals) {
+  const uint16_t old_length = strlen(from);
+  const uint16_t new_length = strlen(to);
+  console_reset_line(&cc);
+  memcpy(cc.line, from, old_length);
+  cc.line_length = old_length;
+  cc.cursor_index = cursor;
+
+  output_length = 0;
+  vt102_replace_current_line(&cc, to, new_length);
+  console_flush(&cc);
+
+  static struct Vt102Screen screen;
+  vt102_screen_init(&screen);
+  screen.insert = 1;
+  memcpy(screen.cells[0], from, old_length);
+  screen.col = cursor;
+  vt102_screen_feed(&screen, output, output_length);
+  if (screen.errors) {
+    fail(screen.error, from, to);
+  }
+  char shown[VT102_SCREEN_COLS + 1];
+  if ((vt102_screen_row_text(&screen, 0, shown) != new_length) ||
+      memcmp(shown, to, new_length) ||
+      (screen.col != new_length)) {
+    fail("screen does not show the new line", from, to);
+  }
+  if ((cc.line_length != new_length) || strcmp(cc.line, to) ||
+      (cc.cursor_index != new_length)) {
+    fail("line does not hold the new line", from, to);
+  }
+  ++totals->redraws;
+  totals->reference_bytes +=
+    reference_bytes(cursor, old_length, new_length);
+  totals->bytes += output_length;
+}
+
+// Recent commands, newest last, as up arrow would walk them
+static const char* history[] = {
+  "on_ms 100",
+  "off_ms 100",
+  "on_ms 250",
+  "off_ms 250",
+  "state",
+  "set_terminal vt102",
+  "set_terminal echo",
+  "echo hello world",
+  "echo hello there",
+  "led 1 on",
+  "led 2 on",
+  "led 2 off",
+  "write 0 \"a much longer argument that crosses several words\"",
+  "write 1 \"a much longer argument that crosses several words\"",
+  "on_ms 1000",
+  "on_ms 1500",
+};
+#define NUM_HISTORY (sizeof(history) / sizeof(history[0]))
+
+static void random_line(char* line, uint16_t max_length) {
+  static const char alphabet[] = "ab ";
+  const uint16_t length = rand() % (max_length + 1);
+  for (uint16_t i=0; i<length; ++i) {
+    line[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+  }
+  line[length] = '\0';
+}
+
+static void print_totals(const char* name, const struct RedrawTotals* t) {
+  printf("%-28s %10.1f %10.1f %9.1f%%\n",
+      name,
+      (double)t->reference_bytes / t->redraws,
+      (double)t->bytes / t->redraws,
+      100.0 * t->bytes / t->reference_bytes);
+}
+
+void bench_redraw(void) {
+  printf("\n== redraw: bytes per line replacement ==\n");
+  uart_console_init_lowlevel(&cc, NULL, 0, CONSOLE_VT102, capture_putchar);
+  printf("%-28s %10s %10s %10s\n", "corpus", "retype", "diff", "ratio");
+
+  // walking up through history and back down again
+  struct RedrawTotals totals = {0, 0, 0};
+  for (uint8_t i=NUM_HISTORY - 1; i > 0; --i) {
+    redraw(history[i], strlen(history[i]), history[i - 1], &totals);
+  }
+  for (uint8_t i=0; i < NUM_HISTORY - 1; ++i) {
+    redraw(history[i], strlen(history[i]), history[i + 1], &totals);
+  }
+  print_totals("history walk", &totals);
+
+  // lines that mostly share a long prefix, as with prefix-filtered up arrow
+  struct RedrawTotals prefixed = {0, 0, 0};
+  for (uint8_t i=0; i < NUM_HISTORY; ++i) {
+    for (uint8_t j=0; j < NUM_HISTORY; ++j) {
+      if ((i != j) && !strncmp(history[i], history[j], 3)) {
+        redraw(history[i], strlen(history[i]), history[j], &prefixed);
+      }
+    }
+  }
+  print_totals("shared prefix", &prefixed);
+
+  // random lines with the cursor anywhere, mostly for checking
+  struct RedrawTotals random = {0, 0, 0};
+  srand(1);
+  char from[CONSOLE_MAX_LINE_CHARS + 1];
+  char to[CONSOLE_MAX_LINE_CHARS + 1];
+  for (uint32_t i=0; i<20000; ++i) {
+    random_line(from, 24);
+    random_line(to, 24);
+    redraw(from, rand() % (strlen(from) + 1), to, &random);
+  }
+  print_totals("random", &random);
+}
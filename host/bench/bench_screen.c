@@ -0,0 +1,217 @@
+// Replays keystrokes through uart_console_poll() in CONSOLE_VT102 mode with
+// the output fed to a model of the terminal (vt102_screen.c).  After every
+// keystroke the cursor row must show the prompt and cc.line (or the ctrl-r
+// search) with the cursor at cc.cursor_index, and any difference is a fatal
+// error.  The output bytes of each kind of edit are reported so that changes
+// to the editor can be compared.
+#include "bench.h"
+#include "pico/stdlib.h"
+#include "vt102_screen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROMPT "> "
+#define RANDOM_KEYSTROKES 200000
+
+static struct ConsoleConfig cc;
+static struct Vt102Screen screen;
+static uint32_t output_bytes;
+
+// Output goes through stdio on the Pico, which turns "\n" into "\r\n"
+static int screen_putchar(int c) {
+  if (c == '\n') {
+    vt102_screen_feed(&screen, "\r", 1);
+    ++output_bytes;
+  }
+  const char ch = c;
+  vt102_screen_feed(&screen, &ch, 1);
+  ++output_bytes;
+  return c;
+}
+
+// Kinds of keystrokes
+enum {
+  OP_TYPE,
+  OP_BACKSPACE,
+  OP_ARROW,  // left and right
+  OP_HOME_END,  // ctrl-a and ctrl-e
+  OP_HISTORY,  // up and down
+  OP_TAB,
+  OP_ENTER,  // including the command's output and the next prompt
+  OP_CANCEL,  // ctrl-c
+  OP_SEARCH,  // ctrl-r and keys typed while searching
+  NUM_OPS,
+};
+
+static const char* op_names[NUM_OPS] = {
+  "type", "backspace", "left/right", "ctrl-a/ctrl-e", "up/down", "tab",
+  "enter", "ctrl-c", "ctrl-r search",
+};
+
+struct OpTotals {
+  uint32_t count;
+  uint64_t bytes;
+  uint32_t max_bytes;
+};
+
+static struct OpTotals totals[NUM_OPS];
+
+static uint8_t classify(const char* key, uint8_t length) {
+#if CONSOLE_HISTORY_LINES > 0
+  if (cc.history_search || (key[0] == 0x12)) {
+    return OP_SEARCH;
+  }
+#endif
+  if (length == 3) {
+    return ((key[2] == 'A') || (key[2] == 'B')) ? OP_HISTORY : OP_ARROW;
+  }
+  switch (key[0]) {
+    case 0x08:
+      return OP_BACKSPACE;
+    case 0x01:
+    case 0x05:
+      return OP_HOME_END;
+    case '\t':
+      return OP_TAB;
+    case '\r':
+      return OP_ENTER;
+    case 0x03:
+      return OP_CANCEL;
+  }
+  return OP_TYPE;
+}
+
+static void fail(const char* source, uint32_t offset, const char* msg) {
+  char shown[VT102_SCREEN_COLS + 1];
+  vt102_screen_row_text(&screen, screen.row, shown);
+  fprintf(stderr,
+      "screen (%s, keystroke at %u): %s\n"
+      "  screen: \"%s\" cursor %u\n"
+      "  line:   \"%.*s\" cursor %u\n",
+      source, offset, msg, shown, screen.col,
+      cc.line_length, cc.line, cc.cursor_index);
+  exit(1);
+}
+
+// Checks that the terminal shows what the console thinks it does
+static void check(const char* source, uint32_t offset) {
+  if (screen.errors) {
+    fail(source, offset, screen.error);
+  }
+  if (!screen.insert) {
+    fail(source, offset, "terminal is not in insert mode");
+  }
+  char expected[VT102_SCREEN_COLS + 1];
+  uint16_t length = strlen(PROMPT);
+  memcpy(expected, PROMPT, length);
+  uint16_t cursor;
+#if CONSOLE_HISTORY_LINES > 0
+  if (cc.history_search) {
+    length += sprintf(expected + length, "(reverse-i-search)`%.*s': ",
+        cc.history_query_length, cc.history_query);
+    memcpy(expected + length, cc.line, cc.line_length);
+    length += cc.line_length;
+    cursor = length;
+  } else
+#endif
+  {
+    memcpy(expected + length, cc.line, cc.line_length);
+    cursor = length + cc.cursor_index;
+    length += cc.line_length;
+  }
+  expected[length] = '\0';
+  char shown[VT102_SCREEN_COLS + 1];
+  vt102_screen_row_text(&screen, screen.row, shown);
+  if (strcmp(shown, expected)) {
+    fail(source, offset, "screen does not show the line");
+  }
+  if (screen.col != cursor) {
+    fail(source, offset, "cursor is in the wrong place");
+  }
+}
+
+// Bytes in the keystroke that starts at data: one, or three for arrows
+static uint8_t key_length(const char* data, uint32_t remaining) {
+  return ((remaining >= 3) && (data[0] == 0x1b) && (data[1] == '[')) ? 3 : 1;
+}
+
+static void start_console(void) {
+  vt102_screen_init(&screen);
+  uart_console_init_lowlevel(
+      &cc,
+      bench_corpus_callbacks,
+      bench_corpus_callback_count,
+      CONSOLE_VT102,
+      screen_putchar);
+  host_stdio_set_input(NULL, 0);
+  uart_console_poll(&cc, PROMPT);  // shows the first prompt
+}
+
+static void press(const char* source, uint32_t offset, const char* key,
+    uint8_t length) {
+  const uint8_t op = classify(key, length);
+  output_bytes = 0;
+  host_stdio_set_input(key, length);
+  uart_console_poll(&cc, PROMPT);
+  if (!cc.prompt_displayed) {
+    // the next prompt is part of finishing the line
+    uart_console_poll(&cc, PROMPT);
+  }
+  check(source, offset);
+  struct OpTotals* t = totals + op;
+  ++t->count;
+  t->bytes += output_bytes;
+  if (output_bytes > t->max_bytes) {
+    t->max_bytes = output_bytes;
+  }
+}
+
+static void replay(const char* source, const char* data, uint32_t length) {
+  start_console();
+  for (uint32_t i=0; i<length; ) {
+    const uint8_t n = key_length(data + i, length - i);
+    press(source, i, data + i, n);
+    i += n;
+  }
+}
+
+// Random edits, weighted towards typing so that lines get long
+static void random_session(void) {
+  static const char* keys[] = {
+    "a", "b", "o", "n", "_", "s", " ", "a", "b", " ",
+    "\x08", "\x08", "\x1b[D", "\x1b[D", "\x1b[C", "\x01", "\x05",
+    "\x1b[A", "\x1b[B", "\t", "\r", "\x03",
+#if CONSOLE_HISTORY_LINES > 0
+    "\x12",
+#endif
+  };
+  const uint8_t num_keys = sizeof(keys) / sizeof(keys[0]);
+  start_console();
+  srand(1);
+  for (uint32_t i=0; i<RANDOM_KEYSTROKES; ++i) {
+    const char* key = keys[rand() % num_keys];
+    press("random", i, key, strlen(key));
+  }
+}
+
+void bench_screen(void) {
+  printf("\n== screen: VT102 model, output bytes per keystroke ==\n");
+  memset(totals, 0, sizeof(totals));
+  uint32_t keystrokes = 0;
+  for (uint8_t i=0; i<bench_corpus_count(); ++i) {
+    const struct BenchCorpus* corpus = bench_corpus(i);
+    replay(corpus->name, corpus->data, corpus->length);
+  }
+  random_session();
+  printf("%-20s %10s %10s %10s\n", "edit", "count", "bytes", "max");
+  for (uint8_t i=0; i<NUM_OPS; ++i) {
+    const struct OpTotals* t = totals + i;
+    keystrokes += t->count;
+    if (t->count) {
+      printf("%-20s %10u %10.2f %10u\n",
+          op_names[i], t->count, (double)t->bytes / t->count, t->max_bytes);
+    }
+  }
+  printf("%-20s %10u\n", "screen checks", keystrokes);
+}
@@ -0,0 +1,117 @@
+// Command statistics (CONSOLE_STATS).  A fake clock that callbacks advance
+// makes the timings exact so that the "stats" output can be checked, then
+// the cost of timing a command is measured.  Compare the dispatch section
+// of this build with the default one for the overall cost.
+#include "bench.h"
+#include "parse_line.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CONSOLE_STATS > 0
+static struct ConsoleConfig cc;
+static char output[1024];
+static uint16_t output_length;
+
+static int capture_putchar(int c) {
+  if (output_length < sizeof(output) - 1) {
+    output[output_length++] = c;
+  }
+  return c;
+}
+
+static uint64_t fake_now_us;
+
+static uint64_t fake_clock_us(void) {
+  return fake_now_us;
+}
+
+// takes as long as its argument says
+static void work(uint8_t argc, char* argv[]) {
+  fake_now_us += atoi(argv[0]);
+}
+
+static struct ConsoleCallback callbacks[] = {
+  {"work", "Takes the given number of us", 1, work},
+  {"idle", "Never called", 0, work},
+};
+
+static void feed(const char* s) {
+  for (; *s; ++s) {
+    uart_console_putchar(&cc, *s);
+  }
+}
+
+static void expect_output(const char* expected) {
+  output[output_length] = '\0';
+  if (!strstr(output, expected)) {
+    fprintf(stderr, "stats: expected \"%s\" in:\n%s\n", expected, output);
+    exit(1);
+  }
+}
+
+static void check_stats(void) {
+  uart_console_init_lowlevel(
+      &cc, callbacks, 2, CONSOLE_MINIMAL, capture_putchar);
+  uart_console_set_stats_clock(&cc, fake_clock_us);
+  static const char lines[] =
+    "work 0\r"
+    "work 1\r"
+    "work 3\r"
+    "work 100\r"
+    "bogus\r"
+    "work\r"
+    "work \"1\r";
+  feed(lines);
+  output_length = 0;
+  feed("stats\r");
+  char totals[64];
+  snprintf(totals, sizeof(totals),
+      "chars=%d unknown=1 errors=2\n", (int)(sizeof(lines) - 1 + 6));
+  expect_output(totals);
+  expect_output("work: calls=4 min=0us mean=26us max=100us\n  0:1 1:1 2:1 64:1\n");
+  if (strstr(output, "idle")) {
+    fprintf(stderr, "stats: shows a command that was never called\n");
+    exit(1);
+  }
+
+  output_length = 0;
+  feed("stats reset\rstats\r");
+  expect_output("chars=6 unknown=0 errors=0\n");
+  printf("%-28s %10s\n", "stats output", "ok");
+}
+
+struct DispatchContext {
+  const char* line;
+  uint16_t length;
+};
+
+static void dispatch(void* vctx) {
+  const struct DispatchContext* ctx = vctx;
+  memcpy(cc.line, ctx->line, ctx->length);
+  cc.line_length = ctx->length;
+  uart_console_parse_line(&cc);
+}
+
+void bench_stats(void) {
+  printf("\n== stats: CONSOLE_STATS=%d ==\n", CONSOLE_STATS);
+  check_stats();
+  printf("%-28s %10zu\n", "sizeof(ConsoleConfig)", sizeof(struct ConsoleConfig));
+
+  uart_console_init_lowlevel(
+      &cc,
+      bench_corpus_callbacks,
+      bench_corpus_callback_count,
+      CONSOLE_MINIMAL,
+      bench_putchar);
+  struct DispatchContext ctx = {"on_ms 100", 9};
+  uint64_t calls;
+  printf("%-28s %10.1f\n", "ns/dispatch (timed)", bench_run(dispatch, &ctx, &calls));
+}
+#else
+void bench_stats(void) {
+  printf("\n== stats: CONSOLE_STATS=0 ==\n");
+  printf("%-28s %10zu\n", "sizeof(ConsoleConfig)", sizeof(struct ConsoleConfig));
+  printf("stats disabled\n");
+}
+#endif
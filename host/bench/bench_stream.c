@@ -0,0 +1,267 @@
+// Raw payloads (uart_console_stream_start).  Checks that every byte value
+// arrives intact and in order, that the crc is checked, that the editor takes
+// over again after the payload and that cancelling works, then compares
+// uploading data as a stream with sending it as lines of hex.
+#include "bench.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CONSOLE_STREAM_BUFFER_SIZE > 0
+#define PROMPT "> "
+#define UPLOAD_SIZE 16384
+#define HEX_BYTES_PER_LINE 32
+
+static struct ConsoleConfig cc;
+static char received[UPLOAD_SIZE];
+static uint32_t received_length;
+static uint16_t max_chunk;
+static int16_t result;  // -1 until done() is called
+static char last_args[CONSOLE_MAX_LINE_CHARS + 1];
+
+static void fail(const char* msg) {
+  fprintf(stderr, "stream: %s\n", msg);
+  exit(1);
+}
+
+static void chunk(struct ConsoleConfig* cc, const char* data, uint16_t length) {
+  if (received_length + length > sizeof(received)) {
+    fail("more bytes than were claimed");
+  }
+  memcpy(received + received_length, data, length);
+  received_length += length;
+  if (length > max_chunk) {
+    max_chunk = length;
+  }
+}
+
+static void done(struct ConsoleConfig* cc, uint8_t r) {
+  result = r;
+}
+
+static const struct ConsoleStream stream = {chunk, done};
+
+// upload length [crc]
+static void upload(struct ConsoleConfig* cc, uint8_t argc, char* argv[]) {
+  received_length = 0;
+  max_chunk = 0;
+  result = -1;
+  const uint8_t flags =
+    ((argc == 2) && !strcmp(argv[1], "crc")) ? CONSOLE_STREAM_CRC : 0;
+  if (!uart_console_stream_start(cc, &stream, strtoul(argv[0], NULL, 0), flags)) {
+    uart_console_printf(cc, "upload: busy\n");
+  }
+}
+
+static void record(uint8_t argc, char* argv[]) {
+  ++bench_callback_count;
+  last_args[0] = '\0';
+  for (uint8_t i=0; i<argc; ++i) {
+    if (i) {
+      strcat(last_args, "|");
+    }
+    strcat(last_args, argv[i]);
+  }
+}
+
+// data <hex>: the line by line way of sending the same payload
+static void data(uint8_t argc, char* argv[]) {
+  const char* hex = argv[0];
+  for (; hex[0] && hex[1]; hex += 2) {
+    char pair[3] = {hex[0], hex[1], '\0'};
+    received[received_length++] = strtoul(pair, NULL, 16);
+  }
+}
+
+static const struct ConsoleCallback callbacks[] = {
+  {"upload", "Receives a raw payload", -1, NULL,
+   NULL, NULL, NULL, NULL, 0, upload},
+  {"record", "Records its arguments", -1, record},
+  {"data", "Receives hex", 1, data},
+};
+
+static void start_console(void) {
+  uart_console_init_lowlevel(&cc, callbacks, 3, CONSOLE_VT102, bench_putchar);
+  host_stdio_set_input(NULL, 0);
+  uart_console_poll(&cc, PROMPT);
+}
+
+static void send(const char* data, uint32_t length) {
+  host_stdio_set_input(data, length);
+  uart_console_poll(&cc, PROMPT);
+}
+
+static void send_text(const char* text) {
+  send(text, strlen(text));
+}
+
+// Every byte value, including '\r', ctrl-c and escape
+static void fill_payload(char* payload, uint32_t length) {
+  for (uint32_t i=0; i<length; ++i) {
+    payload[i] = (i * 7 + (i >> 8)) & 0xFF;
+  }
+}
+
+// Payload followed by its crc, low byte first
+static uint32_t with_crc(char* out, const char* payload, uint32_t length) {
+  memcpy(out, payload, length);
+  uint16_t crc = 0xFFFF;
+  for (uint32_t i=0; i<length; ++i) {
+    crc ^= (uint8_t)payload[i] << 8;
+    for (uint8_t b=0; b<8; ++b) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  out[length] = crc & 0xFF;
+  out[length + 1] = crc >> 8;
+  return length + 2;
+}
+
+static void check_received(const char* payload, uint32_t length) {
+  if ((received_length != length) || memcmp(received, payload, length)) {
+    fail("payload was not received intact");
+  }
+}
+
+static void check_stream(void) {
+  static char payload[1000];
+  static char framed[sizeof(payload) + 2 + 32];
+  fill_payload(payload, sizeof(payload));
+
+  // payload, crc and the next command in one burst
+  start_console();
+  uint32_t length = with_crc(framed, payload, sizeof(payload));
+  memcpy(framed + length, "record after\r", 13);
+  send_text("upload 1000 crc\r");
+  if (cc.prompt_displayed) {
+    fail("prompt shown before the payload");
+  }
+  send(framed, length + 13);
+  check_received(payload, sizeof(payload));
+  if (result != CONSOLE_STREAM_OK) {
+    fail("good crc was rejected");
+  }
+  if (max_chunk > CONSOLE_STREAM_BUFFER_SIZE) {
+    fail("chunk larger than CONSOLE_STREAM_BUFFER_SIZE");
+  }
+  send(NULL, 0);
+  if (strcmp(last_args, "after") || !cc.prompt_displayed) {
+    fail("editor did not take over after the payload");
+  }
+
+  // a damaged payload
+  send_text("upload 1000 crc\r");
+  framed[500] ^= 0x10;
+  send(framed, length);
+  if (result != CONSOLE_STREAM_BAD_CRC) {
+    fail("bad crc was accepted");
+  }
+
+  // a few bytes per poll, each poll passes on what it got
+  send_text("upload 1000\r");
+  for (uint32_t sent=0; sent<sizeof(payload); sent += 7) {
+    const uint32_t n = (sizeof(payload) - sent < 7) ? sizeof(payload) - sent : 7;
+    send(payload + sent, n);
+    if (received_length != sent + n) {
+      fail("partial batch held past the end of the poll");
+    }
+  }
+  check_received(payload, sizeof(payload));
+  if (result != CONSOLE_STREAM_OK) {
+    fail("payload without a crc");
+  }
+
+  // cancelled part way, and a second claim while one is active
+  send_text("upload 100\r");
+  send(payload, 40);
+  if (uart_console_stream_start(&cc, &stream, 10, 0)) {
+    fail("second stream started");
+  }
+  uart_console_stream_cancel(&cc);
+  if ((result != CONSOLE_STREAM_CANCELLED) || (received_length != 40)) {
+    fail("cancel");
+  }
+  send_text("record again\r");
+  if (strcmp(last_args, "again")) {
+    fail("editor did not take over after cancel");
+  }
+
+  // nothing to receive, and a payload claimed by uart_console_exec()
+  send_text("upload 0\r");
+  if (result != CONSOLE_STREAM_OK) {
+    fail("empty payload");
+  }
+  uart_console_exec(&cc, "upload 10");
+  send(payload, 10);
+  check_received(payload, 10);
+}
+
+static char upload_input[UPLOAD_SIZE + 32];
+static uint32_t upload_input_length;
+static char hex_input[UPLOAD_SIZE / HEX_BYTES_PER_LINE * 80];
+static uint32_t hex_input_length;
+
+static void build_inputs(void) {
+  static char payload[UPLOAD_SIZE];
+  fill_payload(payload, sizeof(payload));
+  upload_input_length =
+    sprintf(upload_input, "upload %d crc\r", UPLOAD_SIZE);
+  upload_input_length +=
+    with_crc(upload_input + upload_input_length, payload, sizeof(payload));
+
+  static const char digits[] = "0123456789abcdef";
+  hex_input_length = 0;
+  for (uint32_t i=0; i<sizeof(payload); i += HEX_BYTES_PER_LINE) {
+    hex_input_length += sprintf(hex_input + hex_input_length, "data ");
+    for (uint32_t j=0; j<HEX_BYTES_PER_LINE; ++j) {
+      const uint8_t b = payload[i + j];
+      hex_input[hex_input_length++] = digits[b >> 4];
+      hex_input[hex_input_length++] = digits[b & 0x0F];
+    }
+    hex_input[hex_input_length++] = '\r';
+  }
+}
+
+static void send_upload(void* unused) {
+  send(upload_input, upload_input_length);
+  if ((result != CONSOLE_STREAM_OK) || (received_length != UPLOAD_SIZE)) {
+    fail("upload failed");
+  }
+}
+
+static void send_hex(void* unused) {
+  received_length = 0;
+  send(hex_input, hex_input_length);
+  if (received_length != UPLOAD_SIZE) {
+    fail("hex lines failed");
+  }
+}
+
+static void report(const char* how, void (*fn)(void*), uint32_t input_length) {
+  start_console();
+  uint64_t calls;
+  const uint64_t output_start = bench_output_bytes;
+  const double ns = bench_run(fn, NULL, &calls) / UPLOAD_SIZE;
+  const double wire = (double)input_length / UPLOAD_SIZE;
+  const double echo = (double)(bench_output_bytes - output_start) /
+    calls / UPLOAD_SIZE;
+  // payload bytes per second that a 115200 baud 8N1 link can carry
+  printf("%-20s %10.2f %10.2f %10.2f %12.0f\n",
+      how, ns, wire, echo, 11520 / wire);
+}
+
+void bench_stream(void) {
+  printf("\n== stream: %d byte upload, raw vs hex lines ==\n", UPLOAD_SIZE);
+  check_stream();
+  build_inputs();
+  printf("%-20s %10s %10s %10s %12s\n",
+      "how", "ns/byte", "wire/byte", "echo/byte", "B/s@115200");
+  report("stream with crc", send_upload, upload_input_length);
+  report("hex lines, vt102", send_hex, hex_input_length);
+}
+#else
+void bench_stream(void) {
+  printf("\n== stream: needs CONSOLE_STREAM_BUFFER_SIZE ==\n");
+}
+#endif
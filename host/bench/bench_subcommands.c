@@ -0,0 +1,223 @@
+// Subcommand trees.  Checks dispatch, "help <group>" and per-level tab
+// completion on a small tree, then compares dispatch through a tree of 8
+// groups with 32 commands each to the same 256 commands in a flat table.
+#include "bench.h"
+#include "parse_line.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct ConsoleConfig cc;
+static char output[1024];
+static uint16_t output_length;
+
+static int capture_putchar(int c) {
+  if (output_length < sizeof(output) - 1) {
+    output[output_length++] = c;
+  }
+  return c;
+}
+
+// arguments of the last call to record()
+static char last_call[64];
+
+static void record(uint8_t argc, char* argv[]) {
+  ++bench_callback_count;
+  int pos = snprintf(last_call, sizeof(last_call), "%d", argc);
+  for (uint8_t i=0; i<argc; ++i) {
+    pos += snprintf(last_call + pos, sizeof(last_call) - pos, " %s", argv[i]);
+  }
+}
+
+static struct ConsoleCallback mode_commands[] = {
+  {"in", "Makes a pin an input", 1, record},
+  {"out", "Makes a pin an output", 1, record},
+};
+
+static struct ConsoleCallback gpio_commands[] = {
+  {"set", "Sets a pin", 2, record},
+  {"get", "Reads a pin", 1, record},
+  {"mode", "Pin direction", 0, NULL, NULL, NULL, NULL, mode_commands, 2},
+};
+
+static struct ConsoleCallback i2c_commands[] = {
+  {"scan", "Lists devices", 0, record},
+};
+
+static struct ConsoleCallback tree[] = {
+  {"gpio", "GPIO pins", 0, NULL, NULL, NULL, NULL, gpio_commands, 3},
+  // a group with a handler of its own for when no subcommand matches
+  {"i2c", "I2C bus", -1, record, NULL, NULL, NULL, i2c_commands, 1},
+  {"gpio_set", "Flat version of gpio set", 2, record},
+};
+
+static void feed(const char* s) {
+  for (; *s; ++s) {
+    uart_console_putchar(&cc, *s);
+  }
+}
+
+static void expect_output(const char* line, const char* expected) {
+  output_length = 0;
+  last_call[0] = '\0';
+  feed(line);
+  output[output_length] = '\0';
+  if (!strstr(output, expected)) {
+    fprintf(stderr, "subcommands: expected \"%s\" after \"%s\" in:\n%s\n",
+        expected, line, output);
+    exit(1);
+  }
+}
+
+static void expect_call(const char* line, const char* expected) {
+  expect_output(line, "");
+  if (strcmp(last_call, expected)) {
+    fprintf(stderr, "subcommands: \"%s\" called with \"%s\", expected \"%s\"\n",
+        line, last_call, expected);
+    exit(1);
+  }
+}
+
+static void check_dispatch(void) {
+  uart_console_init_lowlevel(
+      &cc, tree, 3, CONSOLE_MINIMAL, capture_putchar);
+  expect_call("gpio set 5 1\r", "2 5 1");
+  expect_call("gpio get 7\r", "1 7");
+  expect_call("gpio mode out 3\r", "1 3");
+  expect_call("gpio_set 5 1\r", "2 5 1");
+  expect_call("i2c scan\r", "0");
+  expect_call("i2c 0x40 2\r", "2 0x40 2");  // the group's own handler
+  expect_call("i2c\r", "0");
+  expect_output(
+      "gpio\r", "gpio: Expected a subcommand, try \"help gpio\"\n");
+  expect_output(
+      "gpio mode sideways 3\r",
+      "gpio mode: Unknown subcommand \"sideways\", try \"help gpio mode\"\n");
+  expect_output("gpio set 5\r", "set: Expected 2 arguments\n");
+  if (last_call[0]) {
+    fprintf(stderr, "subcommands: bad line made a call\n");
+    exit(1);
+  }
+
+  expect_output("help\r", "gpio ...: GPIO pins\ni2c ...: I2C bus\n");
+  expect_output(
+      "help gpio\r",
+      "gpio set: Sets a pin\n"
+      "gpio get: Reads a pin\n"
+      "gpio mode ...: Pin direction\n");
+  expect_output("help gpio mode out\r", "gpio mode out: Makes a pin an output\n");
+  expect_output("help gpio bogus\r", "help: Unknown command \"gpio bogus\"\n");
+  printf("%-28s %10s\n", "dispatch and help", "ok");
+}
+
+// types line, presses tab (twice if list is set) and checks the result
+static void expect_tab(
+    const char* line, uint8_t list, const char* expected_line) {
+  feed(line);
+  output_length = 0;
+  feed(list ? "\t\t" : "\t");
+  output[output_length] = '\0';
+  cc.line[cc.line_length] = '\0';
+  if (strcmp(cc.line, expected_line)) {
+    fprintf(stderr, "subcommands: tab on \"%s\" gave \"%s\", expected \"%s\"\n",
+        line, cc.line, expected_line);
+    exit(1);
+  }
+}
+
+static void check_completion(void) {
+  uart_console_init_lowlevel(&cc, tree, 3, CONSOLE_VT102, capture_putchar);
+  uart_console_poll(&cc, "> ");
+  expect_tab("gpio s", 0, "gpio set");
+  feed("\x03");  // ctrl-c clears the line
+  expect_tab("gpio mode o", 0, "gpio mode out");
+  feed("\x03");
+  expect_tab("help gpio m", 0, "help gpio mode");
+  feed("\x03");
+  expect_tab("help i", 0, "help i2c");
+  feed("\x03");
+  expect_tab("gpio mode ", 1, "gpio mode ");
+  if (!strstr(output, "in  out")) {
+    fprintf(stderr, "subcommands: tab listed:\n%s\n", output);
+    exit(1);
+  }
+  feed("\x03");
+  expect_tab("gpio set 5 ", 0, "gpio set 5 ");  // nothing to complete
+  feed("\x03");
+  // "help " is left in cc.line past line_length after the backspaces
+  expect_tab("help gpio xx yy\b\b\b\b\b\b\b\b\b\b\b\b\b", 0, "help");
+  feed("\x03");
+  printf("%-28s %10s\n", "tab completion", "ok");
+}
+
+#define GROUPS 8
+#define GROUP_SIZE 32
+static char names[GROUPS * GROUP_SIZE][12];
+static char group_names[GROUPS][8];
+static struct ConsoleCallback leaves[GROUPS][GROUP_SIZE];
+static struct ConsoleCallback groups[GROUPS];
+static struct ConsoleCallback flat[GROUPS * GROUP_SIZE];
+
+static void init_scaling(void) {
+  for (uint8_t g=0; g<GROUPS; ++g) {
+    snprintf(group_names[g], sizeof(group_names[g]), "grp%d", g);
+    groups[g].command = group_names[g];
+    groups[g].description = "Scaling test group";
+    groups[g].subcommands = leaves[g];
+    groups[g].subcommand_count = GROUP_SIZE;
+    for (uint8_t i=0; i<GROUP_SIZE; ++i) {
+      const uint16_t n = g * GROUP_SIZE + i;
+      snprintf(names[n], sizeof(names[n]), "cmd_%03d", n);
+      leaves[g][i].command = names[n];
+      leaves[g][i].description = "Scaling test command";
+      leaves[g][i].num_args = -1;
+      leaves[g][i].callback = bench_callback;
+      flat[n] = leaves[g][i];
+    }
+  }
+}
+
+struct DispatchContext {
+  const char* line;
+  uint16_t length;
+};
+
+static void dispatch(void* vctx) {
+  const struct DispatchContext* ctx = vctx;
+  memcpy(cc.line, ctx->line, ctx->length);
+  cc.line_length = ctx->length;
+  uart_console_parse_line(&cc);
+  console_reset_line(&cc);
+}
+
+static double time_dispatch(const char* line) {
+  struct DispatchContext ctx = {line, strlen(line)};
+  uint64_t calls;
+  const uint64_t start = bench_callback_count;
+  dispatch(&ctx);
+  if (bench_callback_count == start) {
+    fprintf(stderr, "subcommands: \"%s\" was not dispatched\n", line);
+    exit(1);
+  }
+  return bench_run(dispatch, &ctx, &calls);
+}
+
+void bench_subcommands(void) {
+  printf("\n== subcommands ==\n");
+  check_dispatch();
+  check_completion();
+
+  init_scaling();
+  printf("CONSOLE_COMMAND_INDEX_SIZE=%d\n", CONSOLE_COMMAND_INDEX_SIZE);
+  printf("%-28s %10s\n", "line", "ns/line");
+  uart_console_init_lowlevel(&cc, tree, 3, CONSOLE_MINIMAL, bench_putchar);
+  printf("%-28s %10.1f\n", "gpio_set 5 1 (flat)", time_dispatch("gpio_set 5 1"));
+  printf("%-28s %10.1f\n", "gpio set 5 1", time_dispatch("gpio set 5 1"));
+  printf("%-28s %10.1f\n", "gpio mode out 3", time_dispatch("gpio mode out 3"));
+  uart_console_init_lowlevel(
+      &cc, flat, GROUPS * GROUP_SIZE, CONSOLE_MINIMAL, bench_putchar);
+  printf("%-28s %10.1f\n", "cmd_255 (flat 256)", time_dispatch("cmd_255"));
+  uart_console_init_lowlevel(&cc, groups, GROUPS, CONSOLE_MINIMAL, bench_putchar);
+  printf("%-28s %10.1f\n", "grp7 cmd_255 (8 x 32)", time_dispatch("grp7 cmd_255"));
+}
@@ -0,0 +1,112 @@
+// Resumable commands: a task started from the console line must finish over
+// several polls, ctrl-c must cancel it, and starting more than
+// CONSOLE_MAX_TASKS tasks must be refused.  Also times a poll with 1..N tasks
+// pending.
+#include "bench.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CONSOLE_MAX_TASKS > 0
+static struct ConsoleConfig cc;
+static uint32_t finished;
+static uint32_t cancelled;
+
+static void fail(const char* msg) {
+  fprintf(stderr, "tasks: %s\n", msg);
+  exit(1);
+}
+
+// "count n" finishes after n calls
+static uint8_t count(struct ConsoleTask* task) {
+  uint32_t* remaining = (uint32_t*)task->state;
+  if (task->cancelled) {
+    ++cancelled;
+    return CONSOLE_TASK_DONE;
+  }
+  if (task->calls == 0) {
+    *remaining = atoi(task->argv[0]);
+  }
+  if (*remaining == 0) {
+    ++finished;
+    return CONSOLE_TASK_DONE;
+  }
+  --*remaining;
+  return CONSOLE_TASK_PENDING;
+}
+
+static struct ConsoleCallback callbacks[] = {
+  {"count", "Finishes after n polls", 1, NULL, count},
+};
+
+static void reset(void) {
+  uart_console_init_lowlevel(&cc, callbacks, 1, CONSOLE_MINIMAL, bench_putchar);
+  finished = 0;
+  cancelled = 0;
+}
+
+static void send(const char* input) {
+  host_stdio_set_input(input, strlen(input));
+  uart_console_poll(&cc, "");
+}
+
+static void poll_once(void* ctx) {
+  (void)ctx;
+  uart_console_poll(&cc, "");
+}
+
+void bench_tasks(void) {
+  printf("\n== tasks: CONSOLE_MAX_TASKS=%d ==\n", CONSOLE_MAX_TASKS);
+
+  reset();
+  send("count 5\r");
+  uint8_t polls = 1;
+  while (uart_console_run_tasks(&cc) > 0) {
+    if (++polls > 10) {
+      fail("task did not finish");
+    }
+  }
+  if ((finished != 1) || (polls < 3)) {
+    fail("task was not resumed across polls");
+  }
+  printf("%-28s %10s\n", "resumed across polls", "ok");
+
+  reset();
+  send("count 1000\r");
+  send("\x03");
+  if ((cancelled != 1) || finished || (uart_console_run_tasks(&cc) != 0)) {
+    fail("ctrl-c did not cancel the task");
+  }
+  printf("%-28s %10s\n", "ctrl-c cancel", "ok");
+
+  reset();
+  const uint32_t before = bench_output_bytes;
+  for (uint8_t i=0; i<=CONSOLE_MAX_TASKS; ++i) {
+    send("count 1000\r");
+  }
+  if ((uart_console_run_tasks(&cc) != CONSOLE_MAX_TASKS) ||
+      (bench_output_bytes == before)) {
+    fail("extra task was not refused");
+  }
+  printf("%-28s %10s\n", "too many tasks refused", "ok");
+
+  for (uint8_t n=1; n<=CONSOLE_MAX_TASKS; ++n) {
+    reset();
+    for (uint8_t i=0; i<n; ++i) {
+      send("count 4000000000\r");
+    }
+    uint64_t calls;
+    const double ns = bench_run(poll_once, NULL, &calls);
+    char label[32];
+    snprintf(label, sizeof(label), "poll, %d pending", n);
+    printf("%-28s %10.1f ns\n", label, ns);
+  }
+  send("\x03");
+}
+#else
+void bench_tasks(void) {
+  printf("\n== tasks ==\n");
+  printf("resumable commands disabled\n");
+}
+#endif
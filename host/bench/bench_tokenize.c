@@ -0,0 +1,347 @@
+// Splitting lines into arguments.  The single pass tokenizer is checked
+// against a copy of the three pass split_args() it replaced, on hand written
+// lines plus random ones built from the characters that matter (space,
+// quote, backslash), and then both are timed.  With
+// CONSOLE_INCREMENTAL_TOKENIZER the lines are also fed one character at a
+// time, with edits, and the cost left for enter is timed.
+#include "bench.h"
+#include "tokenize.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct ConsoleConfig cc;
+static char output[256];
+static uint16_t output_length;
+
+static void fail(const char* msg, const char* line) {
+  fprintf(stderr, "tokenize: %s: \"%s\"\n", msg, line);
+  exit(1);
+}
+
+static int capture_putchar(int c) {
+  if (output_length < sizeof(output) - 1) {
+    output[output_length++] = c;
+  }
+  return c;
+}
+
+// The three pass split_args() that tokenize.c replaced.  The 0xFF
+// comparison is made unsigned so that the host matches the target, where
+// char is unsigned.
+static int reference_convert_spaces_to_nulls(
+    char* line, uint16_t line_length, const char** error) {
+  int16_t quote_start = -1;
+  uint8_t backslash = 0;
+  uint8_t last_was_whitespace = 1;
+  for (uint16_t i=0; i<line_length; ++i) {
+    const char c = line[i];
+    if (backslash) {
+      last_was_whitespace = 0;
+      backslash = 0;
+    } else if (c == '\\') {
+      last_was_whitespace = 0;
+      backslash = 1;
+    } else if (quote_start >= 0) {
+      last_was_whitespace = 0;
+      if (c == '"') {
+        if ((i - quote_start) == 1) {
+          line[i] = 0xFF;
+        } else {
+          line[i] = 0;
+        }
+        line[quote_start] = 0;
+        quote_start = -1;
+      }
+    } else if ((c == '"') && last_was_whitespace) {
+      line[i] = 0;
+      quote_start = i;
+      last_was_whitespace = 0;
+    } else if (c == ' ') {
+      last_was_whitespace = 1;
+      line[i] = 0;
+    } else {
+      last_was_whitespace = 0;
+    }
+  }
+  if (quote_start >= 0) {
+    *error = "Unclosed quote\n";
+    return 0;
+  }
+  if (backslash) {
+    *error = "Line ended with backslash\n";
+    return 0;
+  }
+  return 1;
+}
+
+static uint16_t reference_remove_backslashes(char* line, uint16_t line_length) {
+  uint16_t head = 0;
+  uint16_t tail = 0;
+  uint8_t just_removed = 0;
+  for (; head < line_length; ++head) {
+    if (just_removed || (line[head] != '\\')) {
+      line[tail] = line[head];
+      ++tail;
+      just_removed = 0;
+    } else {
+      just_removed = 1;
+    }
+  }
+  line[tail] = '\0';
+  return tail;
+}
+
+static int reference_split_args(
+    char* line, uint16_t line_length, char** arg, const char** error) {
+  static char too_many[32];
+  int num_args = 0;
+  *error = "";
+  if (!reference_convert_spaces_to_nulls(line, line_length, error)) {
+    return 0;
+  }
+  line_length = reference_remove_backslashes(line, line_length);
+  if (line_length == 0) {
+    return 0;
+  }
+  if (line[0] != 0) {
+    arg[0] = line;
+    ++num_args;
+  }
+  for (uint16_t i=1; i<line_length; ++i) {
+    if ((line[i] != 0) && (line[i-1] == 0)) {
+      if (num_args >= CONSOLE_MAX_ARGS) {
+        snprintf(too_many, sizeof(too_many),
+            "Too many arguments (>%d)\n", CONSOLE_MAX_ARGS);
+        *error = too_many;
+        return 0;
+      }
+      arg[num_args] = line + i;
+      if ((uint8_t)arg[num_args][0] == 0xFF) {
+        arg[num_args][0] = '\0';
+      }
+      ++num_args;
+    }
+  }
+  return num_args;
+}
+
+// Compares cc.arg[] and any error message with the reference
+static void check(const char* line, uint8_t argc) {
+  char copy[CONSOLE_MAX_LINE_CHARS + 1];
+  char* arg[CONSOLE_MAX_ARGS];
+  const char* error;
+  const uint16_t length = strlen(line);
+  memcpy(copy, line, length + 1);
+  const int expected = reference_split_args(copy, length, arg, &error);
+
+  console_flush(&cc);
+  output[output_length] = '\0';
+  if (argc != expected) {
+    fail("argument count differs", line);
+  }
+  if (strcmp(output, error)) {
+    fail("error message differs", line);
+  }
+  for (uint8_t i=0; i<argc; ++i) {
+    if (strcmp(cc.arg[i], arg[i])) {
+      fail("argument differs", line);
+    }
+  }
+}
+
+static void reset(uint8_t terminal) {
+  uart_console_init_lowlevel(&cc, NULL, 0, terminal, capture_putchar);
+}
+
+static uint8_t tokenize_at_enter(const char* line) {
+  console_reset_line(&cc);
+  cc.line_length = strlen(line);
+  memcpy(cc.line, line, cc.line_length + 1);
+  return tokenize_finish(&cc);
+}
+
+#if CONSOLE_INCREMENTAL_TOKENIZER
+// Types line through the VT102 editor, first with an extra character at
+// typo that is deleted with backspace, then with the character at typo left
+// out and inserted after moving the cursor back with the left arrow.
+static void type_with_edits(const char* line, uint16_t typo) {
+  const uint16_t length = strlen(line);
+  reset(CONSOLE_VT102);
+  for (uint16_t i=0; i<length; ++i) {
+    if (i == typo) {
+      uart_console_putchar(&cc, 'x');
+      uart_console_putchar(&cc, 0x08);
+    }
+    uart_console_putchar(&cc, line[i]);
+  }
+  output_length = 0;
+  check(line, tokenize_finish(&cc));
+
+  reset(CONSOLE_VT102);
+  for (uint16_t i=0; i<length; ++i) {
+    if (i != typo) {
+      uart_console_putchar(&cc, line[i]);
+    }
+  }
+  if (typo < length) {
+    for (uint16_t i=typo + 1; i<length; ++i) {
+      uart_console_putchar(&cc, 0x1b);
+      uart_console_putchar(&cc, '[');
+      uart_console_putchar(&cc, 'D');
+    }
+    uart_console_putchar(&cc, line[typo]);
+  }
+  output_length = 0;
+  check(line, tokenize_finish(&cc));
+}
+
+static uint8_t tokenize_as_typed(const char* line) {
+  console_reset_line(&cc);
+  for (const char* c = line; *c; ++c) {
+    cc.line[cc.line_length++] = *c;
+    tokenize_feed(&cc);
+  }
+  return tokenize_finish(&cc);
+}
+#endif
+
+static const char* lines[] = {
+  "",
+  "   ",
+  "hello",
+  "  hello  ",
+  "set_terminal vt102",
+  "on_ms 250",
+  "a b c d e f g h i j k l m n o p",
+  "a b c d e f g h i j k l m n o p q",
+  "a b c d e f g h i j k l m n o p \"q",
+  "echo \"hello world\"",
+  "echo \"\" x",
+  "echo \"\"x y",
+  "echo \"a\"b",
+  "echo \"a\"\"b\"",
+  "echo a\"b c\"",
+  "echo \\\"a b\\\"",
+  "echo \"a \\\" b\"",
+  "echo a\\ b c",
+  "echo \\\\",
+  "echo \\",
+  "echo \"unclosed",
+  "echo \"\\\"",
+  "  \"quoted command\" arg",
+  "write 0 \"a much longer argument that crosses several words\"",
+  "write 1 an_unquoted_argument_that_is_quite_long_as_well_1234567890",
+};
+
+static void random_line(char* line, uint16_t max_length) {
+  static const char alphabet[] = "ab  \"\\";
+  const uint16_t length = rand() % (max_length + 1);
+  for (uint16_t i=0; i<length; ++i) {
+    line[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+  }
+  line[length] = '\0';
+}
+
+struct TimingContext {
+  const char* line;
+  uint16_t length;
+};
+
+static void reference_enter(void* vctx) {
+  const struct TimingContext* ctx = vctx;
+  char copy[CONSOLE_MAX_LINE_CHARS + 1];
+  char* arg[CONSOLE_MAX_ARGS];
+  const char* error;
+  memcpy(copy, ctx->line, ctx->length + 1);
+  reference_split_args(copy, ctx->length, arg, &error);
+}
+
+static void single_pass_enter(void* vctx) {
+  const struct TimingContext* ctx = vctx;
+  memcpy(cc.line, ctx->line, ctx->length + 1);
+  cc.line_length = ctx->length;
+  tokenize_reset(&cc);
+  tokenize_finish(&cc);
+}
+
+#if CONSOLE_INCREMENTAL_TOKENIZER
+// Times only the tokenize_finish() left for enter after every character
+// but the last has been fed.  Returns nanoseconds per call, less the cost of
+// reading the clock.
+static double time_fed_enter(const struct TimingContext* ctx) {
+  uint64_t clock_ns = 0;
+  for (uint16_t i=0; i<1000; ++i) {
+    const uint64_t t = bench_now_ns();
+    clock_ns += bench_now_ns() - t;
+  }
+  uint64_t total_ns = 0;
+  uint64_t calls = 0;
+  const uint64_t start = bench_now_ns();
+  while ((bench_now_ns() - start) < bench_min_run_ns) {
+    memcpy(cc.line, ctx->line, ctx->length + 1);
+    tokenize_reset(&cc);
+    cc.line_length = ctx->length - 1;
+    tokenize_feed(&cc);
+    const uint64_t enter = bench_now_ns();
+    cc.line_length = ctx->length;
+    tokenize_finish(&cc);
+    total_ns += bench_now_ns() - enter;
+    ++calls;
+  }
+  return ((double)total_ns / calls) - (clock_ns / 1000.0);
+}
+#endif
+
+static void time_line(const char* name, const char* line) {
+  struct TimingContext ctx = {line, strlen(line)};
+  uint64_t calls;
+  printf("%-28s %10.1f %10.1f", name,
+      bench_run(reference_enter, &ctx, &calls),
+      bench_run(single_pass_enter, &ctx, &calls));
+#if CONSOLE_INCREMENTAL_TOKENIZER
+  printf(" %10.1f", time_fed_enter(&ctx));
+#endif
+  printf("\n");
+}
+
+void bench_tokenize(void) {
+  printf("\n== tokenize: CONSOLE_INCREMENTAL_TOKENIZER=%d ==\n",
+      CONSOLE_INCREMENTAL_TOKENIZER);
+
+  reset(CONSOLE_MINIMAL);
+  uint32_t checked = 0;
+  char line[CONSOLE_MAX_LINE_CHARS + 1];
+  srand(1);
+  const uint32_t num_lines = sizeof(lines) / sizeof(lines[0]);
+  for (uint32_t i=0; i<num_lines + 20000; ++i) {
+    if (i < num_lines) {
+      strcpy(line, lines[i]);
+    } else {
+      random_line(line, (i & 1) ? 12 : CONSOLE_MAX_LINE_CHARS);
+    }
+    output_length = 0;
+    check(line, tokenize_at_enter(line));
+#if CONSOLE_INCREMENTAL_TOKENIZER
+    output_length = 0;
+    check(line, tokenize_as_typed(line));
+    if (i < num_lines + 2000) {
+      type_with_edits(line, rand() % (strlen(line) + 1));
+      reset(CONSOLE_MINIMAL);
+    }
+#endif
+    ++checked;
+  }
+  printf("%-28s %10u\n", "lines matching reference", checked);
+
+  printf("%-28s %10s %10s", "ns per enter", "3 pass", "1 pass");
+#if CONSOLE_INCREMENTAL_TOKENIZER
+  printf(" %10s", "fed");
+#endif
+  printf("\n");
+  time_line("short", "on_ms 250");
+  time_line("quoted", "echo \"hello world\" \"\" a\\ b");
+  time_line("long words", lines[sizeof(lines) / sizeof(lines[0]) - 1]);
+  time_line("many args", "a b c d e f g h i j k l m n o p");
+}
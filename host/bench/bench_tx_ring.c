@@ -0,0 +1,263 @@
+// Console output through the TX ring, drained to a pseudo terminal by a
+// thread that plays the part of a DMA channel (uart_console_tx_peek() and
+// uart_console_tx_consume()).  Everything read back from the other side of
+// the pty is compared with the output of the plain putchar path, then the
+// time the main loop spends producing output larger than the ring is
+// compared with a putchar that blocks for each byte at 115200 baud.
+#define _GNU_SOURCE
+#include "bench.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#if CONSOLE_TX_BUFFER_SIZE > 0
+// time to send one byte (start, 8 data and stop bits) at 115200 baud
+#define BYTE_NS 86806
+
+static void fail(const char* msg) {
+  fprintf(stderr, "tx_ring: %s\n", msg);
+  exit(1);
+}
+
+static struct ConsoleConfig cc;
+
+// Output of the putchar path, for comparison
+static char expected[65536];
+static uint32_t expected_length;
+
+static int capture_putchar(int c) {
+  if (expected_length < sizeof(expected)) {
+    expected[expected_length++] = c;
+  }
+  return c;
+}
+
+// The drain thread, the pty it writes to and what is read back
+static struct {
+  int master;
+  int slave;
+  sem_t kick;
+  uint32_t byte_ns;  // simulated transmit time, 0 for as fast as possible
+  uint8_t busy;  // the drain thread is sending
+  volatile uint8_t stop;
+  char received[65536];
+  volatile uint32_t received_length;  // only grows
+} pty;
+
+static void sleep_ns(uint64_t ns) {
+  struct timespec ts = {ns / 1000000000, ns % 1000000000};
+  nanosleep(&ts, NULL);
+}
+
+// Sends until the ring is empty
+static void send_all(void) {
+  while (1) {
+    const char* data;
+    for (uint16_t n = uart_console_tx_peek(&cc, &data);
+         n > 0;
+         n = uart_console_tx_peek(&cc, &data)) {
+      if (pty.byte_ns) {
+        sleep_ns((uint64_t)n * pty.byte_ns);
+      }
+      for (uint16_t sent = 0; sent < n; ) {
+        const ssize_t written = write(pty.slave, data + sent, n - sent);
+        if (written <= 0) {
+          fail("pty write failed");
+        }
+        sent += written;
+      }
+      uart_console_tx_consume(&cc, n);
+    }
+    // output queued after the last peek but before going idle would be
+    // stranded, so look again
+    __atomic_store_n(&pty.busy, 0, __ATOMIC_SEQ_CST);
+    if (!uart_console_tx_peek(&cc, &data) ||
+        __atomic_exchange_n(&pty.busy, 1, __ATOMIC_SEQ_CST)) {
+      return;
+    }
+  }
+}
+
+static void* drain_thread(void* unused) {
+  while (1) {
+    sem_wait(&pty.kick);
+    if (pty.stop) {
+      return NULL;
+    }
+    send_all();
+  }
+}
+
+static void* reader_thread(void* unused) {
+  while (1) {
+    const uint32_t length = pty.received_length;
+    const ssize_t n = read(
+        pty.master, pty.received + length, sizeof(pty.received) - length);
+    if (n <= 0) {
+      return NULL;  // the slave was closed
+    }
+    __atomic_store_n(&pty.received_length, length + n, __ATOMIC_RELEASE);
+  }
+}
+
+// struct ConsoleTxDrain callbacks
+static void drain_start(struct ConsoleConfig* unused) {
+  if (!__atomic_exchange_n(&pty.busy, 1, __ATOMIC_SEQ_CST)) {
+    sem_post(&pty.kick);
+  }
+}
+
+static void drain_wait(struct ConsoleConfig* unused) {
+  sched_yield();  // matters when there is only one cpu
+}
+
+static const struct ConsoleTxDrain pty_drain = {drain_start, drain_wait};
+
+static void open_pty(void) {
+  pty.master = posix_openpt(O_RDWR | O_NOCTTY);
+  if ((pty.master < 0) || grantpt(pty.master) || unlockpt(pty.master)) {
+    fail("could not open a pty");
+  }
+  pty.slave = open(ptsname(pty.master), O_RDWR | O_NOCTTY);
+  if (pty.slave < 0) {
+    fail("could not open the pty slave");
+  }
+  // no newline translation or echo
+  struct termios tio;
+  tcgetattr(pty.slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(pty.slave, TCSANOW, &tio);
+}
+
+static void feed(const char* s) {
+  for (; *s; ++s) {
+    uart_console_putchar(&cc, *s);
+  }
+}
+
+static void init(int (*putchar)(int)) {
+  uart_console_init_lowlevel(
+      &cc,
+      bench_corpus_callbacks,
+      bench_corpus_callback_count,
+      CONSOLE_ECHO,
+      putchar);
+}
+
+// Bytes received since start
+static uint32_t received_since(uint32_t start) {
+  return __atomic_load_n(&pty.received_length, __ATOMIC_ACQUIRE) - start;
+}
+
+// Waits for the drain to deliver length bytes after start
+static void wait_for_received(uint32_t start, uint32_t length) {
+  const uint64_t deadline = bench_now_ns() + 10000000000ULL;
+  while (received_since(start) < length) {
+    if (bench_now_ns() > deadline) {
+      fprintf(stderr, "tx_ring: %" PRIu32 " of %" PRIu32 " bytes arrived\n",
+          received_since(start), length);
+      fail("output did not arrive");
+    }
+    sched_yield();
+  }
+  // cc is about to be reused, so let the drain thread finish with it
+  while (__atomic_load_n(&pty.busy, __ATOMIC_SEQ_CST)) {
+    sched_yield();
+  }
+}
+
+static const char script[] =
+  "help\r"
+  "on_ms 100\r"
+  "bogus\r"
+  "help\r"
+  "help\r"
+  "help\r";
+
+// Output larger than the ring with CONSOLE_TX_BLOCK arrives intact
+static void check_block(void) {
+  expected_length = 0;
+  init(capture_putchar);
+  feed(script);
+
+  init(NULL);
+  const uint32_t start = received_since(0);
+  pty.byte_ns = 0;
+  uart_console_set_tx_drain(&cc, &pty_drain, CONSOLE_TX_BLOCK);
+  feed(script);
+  wait_for_received(start, expected_length);
+  if ((received_since(start) != expected_length) ||
+      memcmp(pty.received + start, expected, expected_length)) {
+    fail("received output differs");
+  }
+  if ((cc.tx_queued != expected_length) || (cc.tx.overflows != 0)) {
+    fail("block accounting");
+  }
+  printf("%-28s %10" PRIu32 "\n", "script output bytes", expected_length);
+  printf("%-28s %10s\n", "block: output intact", "ok");
+  printf("%-28s %10d\n", "block: peak depth", cc.tx.high_water);
+}
+
+// Times the script through the ring at 115200 baud
+static void time_script(uint8_t overflow) {
+  init(NULL);
+  const uint32_t start = received_since(0);
+  pty.byte_ns = BYTE_NS;
+  uart_console_set_tx_drain(&cc, &pty_drain, overflow);
+  const uint64_t start_ns = bench_now_ns();
+  feed(script);
+  const uint64_t elapsed = bench_now_ns() - start_ns;
+  wait_for_received(start, cc.tx_queued);
+
+  const char* name = (overflow == CONSOLE_TX_BLOCK) ? "block" : "drop";
+  char label[32];
+  snprintf(label, sizeof(label), "%s: main loop us", name);
+  printf("%-28s %10.1f\n", label, elapsed / 1e3);
+  snprintf(label, sizeof(label), "%s: bytes dropped", name);
+  printf("%-28s %10" PRIu32 "\n", label, cc.tx.overflows);
+  if (cc.tx_queued + cc.tx.overflows != expected_length) {
+    fail("drop accounting");
+  }
+  if (received_since(start) != cc.tx_queued) {
+    fail("received a different number of bytes than queued");
+  }
+}
+
+void bench_tx_ring(void) {
+  printf("\n== tx_ring: CONSOLE_TX_BUFFER_SIZE=%d ==\n", CONSOLE_TX_BUFFER_SIZE);
+  open_pty();
+  sem_init(&pty.kick, 0, 0);
+  pthread_t drain;
+  pthread_t reader;
+  pthread_create(&drain, NULL, drain_thread, NULL);
+  pthread_create(&reader, NULL, reader_thread, NULL);
+
+  check_block();
+
+  // what a putchar that waits on the UART would cost
+  printf("%-28s %10.1f\n", "putchar: main loop us",
+      expected_length * BYTE_NS / 1e3);
+  time_script(CONSOLE_TX_BLOCK);
+  time_script(CONSOLE_TX_DROP);
+
+  pty.stop = 1;
+  sem_post(&pty.kick);
+  pthread_join(drain, NULL);
+  close(pty.slave);
+  pthread_join(reader, NULL);
+  close(pty.master);
+  sem_destroy(&pty.kick);
+}
+#else
+void bench_tx_ring(void) {
+  printf("\n== tx_ring: CONSOLE_TX_BUFFER_SIZE=0 ==\n");
+  printf("tx ring disabled\n");
+}
+#endif
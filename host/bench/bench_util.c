@@ -0,0 +1,53 @@
+#include "bench.h"
+#include <time.h>
+
+uint64_t bench_min_run_ns = 200000000;
+uint64_t bench_output_bytes;
+uint64_t bench_sink_calls;
+uint64_t bench_callback_count;
+
+uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int bench_putchar(int c) {
+  ++bench_output_bytes;
+  ++bench_sink_calls;
+  return c;
+}
+
+void bench_write(const char* data, size_t length) {
+  bench_output_bytes += length;
+  ++bench_sink_calls;
+}
+
+void bench_flush(void) {
+}
+
+void bench_callback(uint8_t argc, char* argv[]) {
+  ++bench_callback_count;
+}
+
+double bench_run(void (*fn)(void* ctx), void* ctx, uint64_t* calls) {
+  // warm up caches and branch predictors
+  fn(ctx);
+
+  uint64_t count = 0;
+  uint64_t batch = 1;
+  const uint64_t start = bench_now_ns();
+  uint64_t elapsed = 0;
+  while (elapsed < bench_min_run_ns) {
+    for (uint64_t i=0; i<batch; ++i) {
+      fn(ctx);
+    }
+    count += batch;
+    if (batch < 1024) {
+      batch *= 2;
+    }
+    elapsed = bench_now_ns() - start;
+  }
+  *calls = count;
+  return (double)elapsed / count;
+}
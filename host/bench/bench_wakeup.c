@@ -0,0 +1,122 @@
+// Keystroke-to-echo latency of a console thread that sleeps between polls
+// compared with one that waits for input with uart_console_wait().  A typist
+// thread pushes characters the way a UART RX interrupt would, one at a time
+// with a pause between them, and times how long the console takes to produce
+// output.  Every keystroke must be answered.
+#include "bench.h"
+#include "pico/stdlib.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if CONSOLE_WAKEUP && (CONSOLE_RX_BUFFER_SIZE > 0)
+#define KEYSTROKES 64
+#define LINE_KEYS 16  // then ctrl-c to start a new line
+
+static struct ConsoleConfig cc;
+static volatile uint8_t done;
+static uint64_t typed_ns;  // when the current keystroke was pushed
+static uint64_t echo_ns;  // first output after typed_ns, 0 until then
+
+static int echo_putchar(int c) {
+  if (!__atomic_load_n(&echo_ns, __ATOMIC_ACQUIRE)) {
+    __atomic_store_n(&echo_ns, bench_now_ns(), __ATOMIC_RELEASE);
+  }
+  return c;
+}
+
+// How the console thread waits between polls
+struct WaitMode {
+  const char* name;
+  uint32_t sleep_ms;  // sleep_ms() between polls, 0 for uart_console_wait()
+};
+
+static void* console_main(void* vctx) {
+  const struct WaitMode* mode = vctx;
+  uint32_t* polls = calloc(1, sizeof(uint32_t));
+  while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+    if (mode->sleep_ms) {
+      sleep_ms(mode->sleep_ms);
+    } else {
+      uart_console_wait(&cc, 100000);
+    }
+    uart_console_poll(&cc, "");
+    ++*polls;
+  }
+  return polls;
+}
+
+static int compare_u64(const void* a, const void* b) {
+  const uint64_t x = *(const uint64_t*)a;
+  const uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+static void run_mode(const struct WaitMode* mode) {
+  uart_console_init_lowlevel(
+      &cc,
+      bench_corpus_callbacks,
+      bench_corpus_callback_count,
+      CONSOLE_ECHO,
+      echo_putchar);
+  done = 0;
+  pthread_t thread;
+  pthread_create(&thread, NULL, console_main, (void*)mode);
+
+  uint64_t latency[KEYSTROKES];
+  const uint64_t start = bench_now_ns();
+  for (uint32_t i=0; i<KEYSTROKES; ++i) {
+    // a pause that is not a multiple of the polling interval
+    sleep_ms(1 + (i * 7) % 5);
+    __atomic_store_n(&echo_ns, 0, __ATOMIC_RELEASE);
+    typed_ns = bench_now_ns();
+    uart_console_rx_push(&cc, (i % LINE_KEYS == LINE_KEYS - 1) ? 0x03 : 'k');
+    uint64_t echoed;
+    while (!(echoed = __atomic_load_n(&echo_ns, __ATOMIC_ACQUIRE))) {
+      if (bench_now_ns() - typed_ns > 1000000000ull) {
+        fprintf(stderr, "wakeup (%s): keystroke %u was not echoed\n",
+            mode->name, i);
+        exit(1);
+      }
+      sleep_ms(0);
+    }
+    latency[i] = echoed - typed_ns;
+  }
+  const uint64_t elapsed = bench_now_ns() - start;
+  __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+  uart_console_notify(&cc);
+  uint32_t* polls;
+  pthread_join(thread, (void**)&polls);
+
+  uint64_t total = 0;
+  for (uint32_t i=0; i<KEYSTROKES; ++i) {
+    total += latency[i];
+  }
+  qsort(latency, KEYSTROKES, sizeof(latency[0]), compare_u64);
+  printf("%-20s %10.1f %10.1f %10.1f %10.1f\n",
+      mode->name,
+      (double)total / KEYSTROKES / 1000,
+      (double)latency[KEYSTROKES / 2] / 1000,
+      (double)latency[KEYSTROKES - 1] / 1000,
+      *polls * 1e9 / elapsed);
+  free(polls);
+}
+
+void bench_wakeup(void) {
+  printf("\n== wakeup: keystroke to echo, %d keystrokes ==\n", KEYSTROKES);
+  printf("%-20s %10s %10s %10s %10s\n",
+      "wait", "mean us", "median us", "max us", "polls/s");
+  static const struct WaitMode modes[] = {
+    {"sleep_ms(20)", 20},
+    {"sleep_ms(1)", 1},
+    {"uart_console_wait", 0},
+  };
+  for (uint8_t i=0; i<sizeof(modes) / sizeof(modes[0]); ++i) {
+    run_mode(modes + i);
+  }
+}
+#else
+void bench_wakeup(void) {
+  printf("\n== wakeup: needs CONSOLE_WAKEUP and CONSOLE_RX_BUFFER_SIZE ==\n");
+}
+#endif
@@ -0,0 +1,34 @@
+// Smallest program that formats console style messages, built for the
+// RP2040 by the format_size target to compare the flash used by
+// console_vformat() against newlib's vsnprintf().
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "format.h"
+
+volatile char sink;
+
+static void write_sink(void* ctx, const char* data, uint16_t length) {
+  for (uint16_t i=0; i<length; ++i) {
+    sink = data[i];
+  }
+}
+
+static void format(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+#ifdef USE_VSNPRINTF
+  char buffer[256];
+  const int length = vsnprintf(buffer, sizeof(buffer), fmt, args);
+  write_sink(NULL, buffer, (length < (int)sizeof(buffer)) ? length : 255);
+#else
+  console_vformat(write_sink, NULL, fmt, args);
+#endif
+  va_end(args);
+}
+
+int main(void) {
+  format("%s: Expected %d arguments (%lu dropped) %02x\n",
+      "on_ms", 2, 3UL, 0xAB);
+  return 0;
+}
@@ -0,0 +1,156 @@
+#include "vt102_screen.h"
+#include <string.h>
+
+// values of Vt102Screen.state
+#define SCREEN_NORMAL  0x00
+#define SCREEN_ESCAPE  0x01  // after ESC
+#define SCREEN_CSI     0x02  // after ESC [
+
+static void screen_error(struct Vt102Screen* s, const char* error) {
+  if (!s->errors) {
+    s->error = error;
+  }
+  ++s->errors;
+}
+
+void vt102_screen_init(struct Vt102Screen* s) {
+  memset(s, 0, sizeof(*s));
+}
+
+static void line_feed(struct Vt102Screen* s) {
+  if (s->row + 1 < VT102_SCREEN_ROWS) {
+    ++s->row;
+    return;
+  }
+  memmove(s->cells[0], s->cells[1],
+      sizeof(s->cells[0]) * (VT102_SCREEN_ROWS - 1));
+  memset(s->cells[VT102_SCREEN_ROWS - 1], 0, VT102_SCREEN_COLS);
+}
+
+static void print(struct Vt102Screen* s, char c) {
+  if (s->col >= VT102_SCREEN_COLS) {
+    screen_error(s, "printed past the right edge");
+    return;
+  }
+  char* row = s->cells[s->row];
+  if (s->insert) {
+    // the last column falls off the edge
+    memmove(row + s->col + 1, row + s->col, VT102_SCREEN_COLS - s->col - 1);
+  }
+  row[s->col++] = c;
+}
+
+// Runs ESC [ param command
+static void csi(struct Vt102Screen* s, char command) {
+  const uint16_t n = s->param ? s->param : 1;
+  char* row = s->cells[s->row];
+  switch (command) {
+    case 'D':
+      if (n > s->col) {
+        screen_error(s, "cursor left past column 0");
+        s->col = 0;
+      } else {
+        s->col -= n;
+      }
+      break;
+    case 'C':
+      if (s->col + n > VT102_SCREEN_COLS) {
+        screen_error(s, "cursor right past the edge");
+        s->col = VT102_SCREEN_COLS;
+      } else {
+        s->col += n;
+      }
+      break;
+    case 'P': {
+      const uint16_t deleted =
+        (s->col + n > VT102_SCREEN_COLS) ? VT102_SCREEN_COLS - s->col : n;
+      memmove(row + s->col, row + s->col + deleted,
+          VT102_SCREEN_COLS - s->col - deleted);
+      memset(row + VT102_SCREEN_COLS - deleted, 0, deleted);
+      break;
+    }
+    case 'K':
+      if (s->param) {
+        screen_error(s, "unsupported erase");
+      } else {
+        memset(row + s->col, 0, VT102_SCREEN_COLS - s->col);
+      }
+      break;
+    case 'h':
+    case 'l':
+      if (s->param == 4) {
+        s->insert = command == 'h';
+      } else {
+        screen_error(s, "unsupported mode");
+      }
+      break;
+    default:
+      screen_error(s, "unsupported escape sequence");
+      break;
+  }
+}
+
+void vt102_screen_feed(struct Vt102Screen* s, const char* data, uint32_t length) {
+  for (uint32_t i=0; i<length; ++i) {
+    const char c = data[i];
+    switch (s->state) {
+      case SCREEN_ESCAPE:
+        if (c == '[') {
+          s->state = SCREEN_CSI;
+          s->param = 0;
+        } else {
+          screen_error(s, "unsupported escape sequence");
+          s->state = SCREEN_NORMAL;
+        }
+        continue;
+      case SCREEN_CSI:
+        if ((c >= '0') && (c <= '9')) {
+          s->param = s->param * 10 + (c - '0');
+        } else {
+          csi(s, c);
+          s->state = SCREEN_NORMAL;
+        }
+        continue;
+    }
+    if ((uint8_t)c >= 32) {
+      print(s, c);
+      continue;
+    }
+    switch (c) {
+      case 0x1b:
+        s->state = SCREEN_ESCAPE;
+        break;
+      case '\r':
+        s->col = 0;
+        break;
+      case '\n':
+        line_feed(s);
+        break;
+      case 0x08:
+        if (s->col == 0) {
+          screen_error(s, "backspace at column 0");
+        } else {
+          --s->col;
+        }
+        break;
+      case '\a':
+        break;
+      default:
+        screen_error(s, "unsupported control character");
+        break;
+    }
+  }
+}
+
+uint16_t vt102_screen_row_text(
+    const struct Vt102Screen* s, uint16_t row, char* text) {
+  uint16_t length = VT102_SCREEN_COLS;
+  while ((length > 0) && !s->cells[row][length - 1]) {
+    --length;
+  }
+  for (uint16_t i=0; i<length; ++i) {
+    text[i] = s->cells[row][i] ? s->cells[row][i] : ' ';
+  }
+  text[length] = '\0';
+  return length;
+}
@@ -0,0 +1,39 @@
+#ifndef UART_CONSOLE_VT102_SCREEN_H
+#define UART_CONSOLE_VT102_SCREEN_H
+// Model of the part of a VT102 terminal that the line editor relies on:
+// printable characters (in insert or replace mode), backspace, CR, LF, bell
+// and the ESC [ n D/C/P/K and ESC [ 4 h/l sequences.  Output is fed in as it
+// is produced and anything else is counted as an error.
+#include <inttypes.h>
+
+#define VT102_SCREEN_ROWS 24
+#define VT102_SCREEN_COLS 160
+
+struct Vt102Screen {
+  // zero for blank cells, so that typed spaces at the end of a line can be
+  // told apart from erased ones
+  char cells[VT102_SCREEN_ROWS][VT102_SCREEN_COLS];
+  uint16_t row;
+  uint16_t col;
+  uint8_t insert;  // insert mode (ESC [ 4 h), off at reset like a terminal
+  uint8_t state;  // position within an escape sequence
+  uint16_t param;
+  // unsupported sequences and moves past the edges of the screen, which
+  // the console should never send.  error describes the first one.
+  uint32_t errors;
+  const char* error;
+};
+
+// Clears the screen and homes the cursor
+void vt102_screen_init(struct Vt102Screen* s);
+
+// Applies terminal output.  Escape sequences can be split across calls.
+void vt102_screen_feed(struct Vt102Screen* s, const char* data, uint32_t length);
+
+// Copies a row into text (which needs VT102_SCREEN_COLS + 1 characters)
+// up to its last non-blank cell and returns the length.  Blanks before that
+// are copied as spaces.
+uint16_t vt102_screen_row_text(
+    const struct Vt102Screen* s, uint16_t row, char* text);
+
+#endif
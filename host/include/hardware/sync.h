@@ -0,0 +1,13 @@
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+// Minimal stand-in for the Pico SDK's hardware/sync.h.  The event register
+// shared by the cores is modeled with a condition variable so that threads
+// can play the cores.
+
+// Waits until __sev() has been called since the last __wfe() returned
+void __wfe(void);
+
+// Sets the event register, waking any thread in __wfe()
+void __sev(void);
+
+#endif
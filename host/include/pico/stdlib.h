@@ -0,0 +1,45 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+// Minimal stand-in for the Pico SDK's pico/stdlib.h.  Only the functions used
+// by src/ are provided.
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define PICO_ERROR_TIMEOUT -1
+
+// Does nothing on the host
+void stdio_init_all(void);
+
+// Returns the next character given to host_stdio_set_input() or
+// PICO_ERROR_TIMEOUT if all of the input has been consumed.  timeout_us is
+// ignored.
+int getchar_timeout_us(uint32_t timeout_us);
+
+// putchar() without "\n" to "\r\n" translation.  The host's putchar() does
+// not translate anyway.
+int putchar_raw(int c);
+
+void sleep_ms(uint32_t ms);
+
+// Microseconds since an arbitrary start
+uint64_t time_us_64(void);
+
+// A time_us_64() value
+typedef uint64_t absolute_time_t;
+
+absolute_time_t make_timeout_time_us(uint64_t us);
+
+// Waits like __wfe() (see hardware/sync.h) but no later than
+// timeout_timestamp.  Returns true if the time was reached.
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+// fn(param) is called by host_stdio_set_input() when input is given
+void stdio_set_chars_available_callback(void (*fn)(void*), void* param);
+
+// Host only: sets the characters that getchar_timeout_us() will return.  The
+// data is not copied and must outlive its use.
+void host_stdio_set_input(const char* data, uint32_t length);
+
+#endif
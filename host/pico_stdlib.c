@@ -0,0 +1,103 @@
+// Host implementation of the pico/stdlib.h stand-in
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <pthread.h>
+#include <time.h>
+
+static const char* input_data;
+static uint32_t input_length;
+static uint32_t input_index;
+static void (*chars_available)(void*);
+static void* chars_available_param;
+
+// the event register of hardware/sync.h
+static pthread_mutex_t event_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t event_cond;
+static pthread_once_t event_once = PTHREAD_ONCE_INIT;
+static uint8_t event;
+
+static void event_init(void) {
+  // timed waits use CLOCK_MONOTONIC like time_us_64()
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&event_cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+void stdio_init_all(void) {
+}
+
+int putchar_raw(int c) {
+  return putchar(c);
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+  if (input_index >= input_length) {
+    return PICO_ERROR_TIMEOUT;
+  }
+  return (uint8_t)input_data[input_index++];
+}
+
+void sleep_ms(uint32_t ms) {
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+}
+
+uint64_t time_us_64(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+absolute_time_t make_timeout_time_us(uint64_t us) {
+  return time_us_64() + us;
+}
+
+void __sev(void) {
+  pthread_once(&event_once, event_init);
+  pthread_mutex_lock(&event_mutex);
+  event = 1;
+  pthread_cond_broadcast(&event_cond);
+  pthread_mutex_unlock(&event_mutex);
+}
+
+void __wfe(void) {
+  pthread_once(&event_once, event_init);
+  pthread_mutex_lock(&event_mutex);
+  while (!event) {
+    pthread_cond_wait(&event_cond, &event_mutex);
+  }
+  event = 0;
+  pthread_mutex_unlock(&event_mutex);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) {
+  pthread_once(&event_once, event_init);
+  struct timespec ts;
+  ts.tv_sec = timeout_timestamp / 1000000;
+  ts.tv_nsec = (timeout_timestamp % 1000000) * 1000;
+  pthread_mutex_lock(&event_mutex);
+  while (!event && (time_us_64() < timeout_timestamp)) {
+    pthread_cond_timedwait(&event_cond, &event_mutex, &ts);
+  }
+  event = 0;
+  pthread_mutex_unlock(&event_mutex);
+  return time_us_64() >= timeout_timestamp;
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void*), void* param) {
+  chars_available = fn;
+  chars_available_param = param;
+}
+
+void host_stdio_set_input(const char* data, uint32_t length) {
+  input_data = data;
+  input_length = length;
+  input_index = 0;
+  if (chars_available && length) {
+    chars_available(chars_available_param);
+  }
+}
@@ -2,6 +2,7 @@
 #define PICO_UART_CONSOLE_H
 
 #include <inttypes.h>
+#include <stddef.h>
 
 // Any of these can be overriden with compile time flags
 #ifndef CONSOLE_MAX_LINE_CHARS
@@ -11,94 +12,865 @@
   #define CONSOLE_MAX_ARGS 16
 #endif
 #ifndef CONSOLE_HISTORY_LINES
+  // sizes the default CONSOLE_HISTORY_BYTES
   #define CONSOLE_HISTORY_LINES 10  // set to zero to disable
 #endif
+#ifndef CONSOLE_HISTORY_BYTES
+  // bytes of command history.  Each entry takes its length plus two bytes
+  // (four when CONSOLE_MAX_LINE_CHARS is over 255), so this usually holds
+  // several times CONSOLE_HISTORY_LINES commands.
+  #define CONSOLE_HISTORY_BYTES \
+    ((CONSOLE_MAX_LINE_CHARS + 1) * CONSOLE_HISTORY_LINES)
+#endif
+#ifndef CONSOLE_HISTORY_QUERY_CHARS
+  // maximum length of a ctrl-r history search
+  #define CONSOLE_HISTORY_QUERY_CHARS 32
+#endif
+#ifndef CONSOLE_COMMAND_INDEX_SIZE
+  // maximum callback_count for the sorted command lookup index.  Tables
+  // larger than this fall back to a linear search.
+  #define CONSOLE_COMMAND_INDEX_SIZE 0  // set to zero to disable
+#endif
+#ifndef CONSOLE_STATS
+  // number of commands (the first ones in the callbacks table) that get call
+  // counts and timings, shown by the built-in "stats" command
+  #define CONSOLE_STATS 0  // set to zero to disable
+#endif
+#ifndef CONSOLE_STATS_BUCKETS
+  // entries in each command's latency histogram.  Bucket 0 counts calls
+  // under 1us and bucket i counts calls of 2^(i-1) to 2^i - 1 us, with the
+  // last one also counting everything longer.
+  #define CONSOLE_STATS_BUCKETS 16
+#endif
+#ifndef CONSOLE_LINE_CACHE
+  // number of recently run lines whose split arguments and matched command
+  // are kept, so that running the same line again skips splitting and
+  // lookup.  Each entry takes about 2 * CONSOLE_MAX_LINE_CHARS bytes.
+  #define CONSOLE_LINE_CACHE 0  // set to zero to disable
+#endif
+#ifndef CONSOLE_REPEAT
+  // the built-in "repeat n command..." command
+  #define CONSOLE_REPEAT 0  // set to 1 to enable
+#endif
+#ifndef CONSOLE_REPEAT_MAX
+  // largest count that "repeat" accepts
+  #define CONSOLE_REPEAT_MAX 100000
+#endif
+#ifndef CONSOLE_RX_BUFFER_SIZE
+  // receive ring buffer for uart_console_rx_push().  Must be a power of two.
+  #define CONSOLE_RX_BUFFER_SIZE 0  // set to zero to disable
+#endif
+#ifndef CONSOLE_TX_BUFFER_SIZE
+  // transmit ring buffer drained by an interrupt handler or DMA (see
+  // uart_console_set_tx_drain).  Must be a power of two.
+  #define CONSOLE_TX_BUFFER_SIZE 0  // set to zero to disable
+#endif
+#ifndef CONSOLE_COMMAND_QUEUE_SLOTS
+  // parsed commands that are waiting to run.  This holds lines that arrive
+  // while a callback is running (and calling uart_console_poll() or
+  // uart_console_exec()) as well as commands for
+  // uart_console_run_commands().  Must be a power of two.
+  #define CONSOLE_COMMAND_QUEUE_SLOTS 0  // set to zero to disable
+#endif
+#ifndef CONSOLE_REPLY_BUFFER_SIZE
+  // ring buffer for uart_console_reply_write().  Must be a power of two.
+  #define CONSOLE_REPLY_BUFFER_SIZE 0  // set to zero to disable
+#endif
+#ifndef CONSOLE_MAX_TASKS
+  // number of resumable commands (ConsoleCallback.task) that can be
+  // pending at once
+  #define CONSOLE_MAX_TASKS 0  // set to zero to disable
+#endif
+#ifndef CONSOLE_TASK_STATE_SIZE
+  // bytes of ConsoleTask.state available to each resumable command
+  #define CONSOLE_TASK_STATE_SIZE 16
+#endif
+#ifndef CONSOLE_INCREMENTAL_TOKENIZER
+  // split lines into arguments as characters arrive instead of when enter
+  // is pressed.  Costs a second CONSOLE_MAX_LINE_CHARS buffer.
+  #define CONSOLE_INCREMENTAL_TOKENIZER 0  // set to zero to disable
+#endif
+#ifndef CONSOLE_TYPED_ARGS
+  // support for ConsoleCallback.args
+  #define CONSOLE_TYPED_ARGS 1  // set to zero to disable
+#endif
+#ifndef CONSOLE_FORMAT_FLOAT
+  // %f support in console output (uart_console_reply_printf, messages)
+  #define CONSOLE_FORMAT_FLOAT 0  // set to 1 to enable
+#endif
+#ifndef CONSOLE_WAKEUP
+  // uart_console_wait() and uart_console_notify() for sleeping until input
+  // arrives instead of polling on a timer
+  #define CONSOLE_WAKEUP 0  // set to 1 to enable
+#endif
+#ifndef CONSOLE_BINARY_MODE
+  // support for CONSOLE_BINARY
+  #define CONSOLE_BINARY_MODE 0  // set to 1 to enable
+#endif
+#ifndef CONSOLE_STREAM_BUFFER_SIZE
+  // uart_console_stream_start() for commands that take raw bulk data.
+  // Received bytes are handed over in batches of up to this many (64 is a
+  // good choice).
+  #define CONSOLE_STREAM_BUFFER_SIZE 0  // set to nonzero to enable
+#endif
+#ifndef CONSOLE_OUTPUT_BUFFER_SIZE
+  // staging buffer used when a write() callback is registered
+  #define CONSOLE_OUTPUT_BUFFER_SIZE 64  // set to zero to disable
+#endif
 
 // Console Mode
-// Consumes characters 32-254.  No echo or editing.
+// Consumes characters 32-255.  No echo or editing.
 #define CONSOLE_MINIMAL          0x00
-// Consumes characters 32-254.  Echos consumed characters.  No editing.
+// Consumes characters 32-255.  Echos consumed characters.  No editing.
 #define CONSOLE_ECHO             0x01
-// Consumes characters 32-254.  Echos all characters back as codes.  No editing.
+// Consumes characters 32-255.  Echos all characters back as codes.  No editing.
 #define CONSOLE_DEBUG_ECHO       0x03
 // Tries to emulate VT102 at a basic level.  Supports ctrl-a, ctrl-c, ctrl-e,
 // del, backspace, and arrows
 #define CONSOLE_VT102            0x04
 // VT102 debug mode.  Instead of echoning back codes, it shows internal state
 #define CONSOLE_DEBUG_VT102      0x05
+// Length-prefixed binary frames for programs (see below).  No echo or editing.
+#define CONSOLE_BINARY           0x06
+
+// CONSOLE_BINARY frames.  Requests and responses use the same layout:
+//
+//   sync    0xA5
+//   type    request: index of the command in the callbacks table
+//           response: one of the CONSOLE_BINARY_* codes below
+//   seq     chosen by the client and copied into the responses
+//   length  payload length, 2 bytes little endian (max CONSOLE_MAX_LINE_CHARS)
+//   payload
+//   crc     CRC-16/CCITT-FALSE of type through payload, 2 bytes little endian
+//
+// A request payload holds the arguments, each as a length byte followed by
+// that many bytes.  Arguments can contain any byte, including zero.
+//
+// A request gets zero or more CONSOLE_BINARY_DATA responses (sent by the
+// callback with uart_console_binary_reply()) followed by exactly one final
+// response with a status code.  Error responses carry a text message.
+//
+// Frames run their callback directly, on the core that reads the input.
+// They are not queued like text lines, so a frame that arrives while a
+// callback is running (through a nested uart_console_poll()) is skipped
+// and gets CONSOLE_BINARY_BUSY, and with remote dispatch every frame gets
+// CONSOLE_BINARY_UNSUPPORTED.
+#define CONSOLE_BINARY_SYNC           0xA5
+#define CONSOLE_BINARY_OK             0x00
+#define CONSOLE_BINARY_DATA           0x01
+#define CONSOLE_BINARY_UNKNOWN        0x02  // no command with that index
+#define CONSOLE_BINARY_BAD_ARGS       0x03  // malformed payload or arg count
+#define CONSOLE_BINARY_BAD_CRC        0x04
+#define CONSOLE_BINARY_TOO_LONG       0x05  // length > CONSOLE_MAX_LINE_CHARS
+#define CONSOLE_BINARY_BUSY           0x06  // sent while a callback was running
+#define CONSOLE_BINARY_UNSUPPORTED    0x07  // remote dispatch is enabled
+
+// uart_console_exec() results
+#define CONSOLE_EXEC_OK          0x00  // ran (or was queued), or an empty line
+#define CONSOLE_EXEC_UNKNOWN     0x01  // no such command
+#define CONSOLE_EXEC_BAD_ARGS    0x02  // bad quoting, argument count or values
+#define CONSOLE_EXEC_TOO_LONG    0x03  // more than CONSOLE_MAX_LINE_CHARS
+#define CONSOLE_EXEC_QUEUE_FULL  0x04  // see CONSOLE_COMMAND_QUEUE_SLOTS
+#define CONSOLE_EXEC_REMOTE      0x05  // called from a remote dispatch callback
+#define CONSOLE_EXEC_UNSUPPORTED 0x06  // e.g. "repeat" of a resumable command
 
 // Internal vt100 states (terminal_state)
 #define VT102_NORMAL  0x00
 #define VT102_ESCAPE  0x01
 #define VT102_ESCAPE2 0x02
 
+// Single-producer/single-consumer ring buffer.  One side (for example an
+// interrupt handler) only pushes and the other only pops so no locking is
+// needed.  head and tail are free running counters, the number of bytes
+// waiting is head - tail.
+struct ConsoleRing {
+  char* data;
+  uint16_t mask;  // size - 1
+  volatile uint16_t head;  // only written by the producer
+  volatile uint16_t tail;  // only written by the consumer
+  uint32_t overflows;  // pushes that failed because the buffer was full
+  uint16_t high_water;  // largest number of bytes that were ever waiting
+};
+
+struct ConsoleConfig;
+
+// The input and output device of one console instance (see
+// uart_console_set_transport).  Every function is given the console so that
+// one set of functions can serve several instances, telling them apart with
+// uart_console_context().
+struct ConsoleTransport {
+  // Returns the next received character (0-255) or -1 if there is none.
+  // Must not block.  NULL reads with getchar_timeout_us().
+  int (*read)(struct ConsoleConfig* cc);
+  // Sends output, staged like uart_console_set_writer() output.  NULL
+  // keeps the writer or putchar() given at initialization.
+  void (*write)(struct ConsoleConfig* cc, const char* data, size_t length);
+  // Called when write() output should go out now.  May be NULL.
+  void (*flush)(struct ConsoleConfig* cc);
+};
+
+#if CONSOLE_STREAM_BUFFER_SIZE > 0
+// Results passed to ConsoleStream.done
+#define CONSOLE_STREAM_OK        0x00
+#define CONSOLE_STREAM_BAD_CRC   0x01
+#define CONSOLE_STREAM_CANCELLED 0x02  // see uart_console_stream_cancel()
+
+// uart_console_stream_start() flags
+// The payload is followed by its CRC-16/CCITT-FALSE (as used by
+// CONSOLE_BINARY), low byte first
+#define CONSOLE_STREAM_CRC 0x01
+
+// Receives the raw bytes claimed by uart_console_stream_start()
+struct ConsoleStream {
+  // Called with the payload in order, up to CONSOLE_STREAM_BUFFER_SIZE
+  // bytes at a time.  A partial batch is passed on at the end of every
+  // uart_console_poll().
+  void (*chunk)(struct ConsoleConfig* cc, const char* data, uint16_t length);
+  // Called once after the last chunk with a CONSOLE_STREAM_* result.  May
+  // be NULL.
+  void (*done)(struct ConsoleConfig* cc, uint8_t result);
+};
+#endif
+
+#if CONSOLE_TX_BUFFER_SIZE > 0
+
+// What uart_console_set_tx_drain() does when the TX ring is full
+#define CONSOLE_TX_BLOCK 0  // wait for the drain to make room
+#define CONSOLE_TX_DROP 1  // discard the output (counted in tx.overflows)
+
+// Sends the contents of ConsoleConfig.tx to the device.  The drain takes
+// bytes with uart_console_tx_pop() (a UART TX interrupt handler) or
+// uart_console_tx_peek() and uart_console_tx_consume() (a DMA channel).
+struct ConsoleTxDrain {
+  // Starts sending if the drain is idle.  Called once per
+  // uart_console_putchar() or uart_console_poll() that produced output and
+  // while waiting for room.  Must not block.
+  void (*start)(struct ConsoleConfig* cc);
+  // Called repeatedly while CONSOLE_TX_BLOCK waits for room.  May be NULL.
+  void (*wait)(struct ConsoleConfig* cc);
+};
+#endif
+
+#if CONSOLE_STATS > 0
+// Timings for one command
+struct ConsoleCommandStats {
+  uint32_t calls;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t total_us;
+  uint16_t histogram[CONSOLE_STATS_BUCKETS];  // stops counting at 65535
+};
+
+// Instrumentation shown by the built-in "stats" command
+struct ConsoleStats {
+  // microsecond clock, time_us_64() unless uart_console_set_stats_clock()
+  // was called
+  uint64_t (*clock_us)(void);
+  uint32_t chars;  // characters processed
+  uint32_t unknown_commands;
+  uint32_t parse_errors;  // bad quoting or arguments
+  struct ConsoleCommandStats commands[CONSOLE_STATS];
+};
+#endif
+
+// Progress of splitting ConsoleConfig.line into arguments.  The split can
+// stop at any character and resume when more arrive.
+struct ConsoleTokenizer {
+  uint16_t read;  // characters of line consumed
+  uint16_t write;  // characters of output produced, including nulls
+  uint8_t argc;
+  uint8_t state;  // TOKEN_* in tokenize.c
+  uint8_t escape;  // the last character consumed was a backslash
+  uint8_t too_many;  // more than CONSOLE_MAX_ARGS arguments were found
+};
+
+// Return values for ConsoleCallback.task
+#define CONSOLE_TASK_DONE    0x00
+#define CONSOLE_TASK_PENDING 0x01
+
+struct ConsoleTask;
+
+// Types for ConsoleArg.type
+#define CONSOLE_ARG_INT      0x01  // int32_t, decimal, 0x hex or 0 octal
+#define CONSOLE_ARG_UNSIGNED 0x02  // uint32_t, decimal, 0x hex or 0 octal
+#define CONSOLE_ARG_HEX      0x03  // uint32_t, hex with or without 0x
+#define CONSOLE_ARG_FLOAT    0x04  // float
+#define CONSOLE_ARG_ENUM     0x05  // index of the matching ConsoleArg.choices
+#define CONSOLE_ARG_STRING   0x06  // unconverted
+#define CONSOLE_ARG_TYPE_MASK 0x0F
+// Flags that can be added to the type
+#define CONSOLE_ARG_OPTIONAL 0x40  // this and later arguments can be left off
+#define CONSOLE_ARG_VARIADIC 0x80  // last argument only, repeats 0 or more times
+
+// Describes one argument of a command (see ConsoleCallback.args)
+struct ConsoleArg {
+  const char* name;  // for help and error messages
+  uint8_t type;  // CONSOLE_ARG_* type, plus any flags
+  // Allowed range of numeric arguments, not checked if min == max.  For
+  // CONSOLE_ARG_UNSIGNED and CONSOLE_ARG_HEX the values are compared as
+  // uint32_t.
+  int32_t min;
+  int32_t max;
+  const char* const* choices;  // CONSOLE_ARG_ENUM values, NULL terminated
+};
+
+// A converted argument
+union ConsoleValue {
+  int32_t i;  // CONSOLE_ARG_INT
+  uint32_t u;  // CONSOLE_ARG_UNSIGNED, CONSOLE_ARG_HEX, CONSOLE_ARG_ENUM
+  float f;  // CONSOLE_ARG_FLOAT
+  const char* s;  // CONSOLE_ARG_STRING
+};
+
 struct ConsoleCallback {
   const char* command;
   const char* description;
   int16_t num_args;  // Set to -1 to allow any number
   void (*callback)(uint8_t argc, char* argv[]);
+  // Optional resumable form, used when callback is NULL (and
+  // CONSOLE_MAX_TASKS > 0).  It is called when the command is entered and
+  // then once per uart_console_poll() for as long as it returns
+  // CONSOLE_TASK_PENDING.  It should do a small amount of work per call
+  // and keep its progress in task->state.
+  uint8_t (*task)(struct ConsoleTask* task);
+  // Optional argument descriptions (with CONSOLE_TYPED_ARGS).  When set,
+  // args has num_args entries and the console checks the arguments against
+  // them, printing a uniform error message if any are wrong.  If callback
+  // and task are NULL, the converted values are passed to typed().  argc is
+  // the number of arguments given and optional ones that were left off
+  // have zero values.
+  const struct ConsoleArg* args;
+  void (*typed)(uint8_t argc, const union ConsoleValue* argv);
+  // Optional subcommands, which make this command a group.  The argument
+  // after a group's name selects one of them, so "gpio set 5 1" runs "set"
+  // from gpio's table with the arguments "5 1".  Groups can nest.  If no
+  // subcommand matches, the group's own callback, task or typed function
+  // gets the remaining arguments, or an error is shown if it has none.
+  const struct ConsoleCallback* subcommands;
+  uint16_t subcommand_count;
+  // Optional form of callback that is also given the console that received
+  // the command, for tables shared by several instances.  Used when
+  // callback is NULL.  With remote dispatch it runs on the other core and
+  // should reply with uart_console_reply_printf().
+  void (*handler)(struct ConsoleConfig* cc, uint8_t argc, char* argv[]);
 };
 
+// Registers a command from any source file, as an alternative to listing it
+// in a central callbacks table.  The fields after the name are given in
+// struct ConsoleCallback order, for example:
+//
+//   CONSOLE_COMMAND(led, "Set the LED: led <0|1>", 1, led_cmd);
+//
+// The entries are collected by the linker into the console_commands section
+// and used when uart_console_init() is given a NULL callbacks table.
+// Registration order is link order, so set CONSOLE_COMMAND_INDEX_SIZE to at
+// least the number of commands to get sorted (binary search) lookup.
+#define CONSOLE_COMMAND(name, ...) \
+  static const struct ConsoleCallback console_command_##name \
+  __attribute__((used, section("console_commands"), \
+                 aligned(__alignof__(struct ConsoleCallback)))) = \
+  {#name, __VA_ARGS__}
+
+#if CONSOLE_MAX_TASKS > 0
+// A resumable command that is in progress
+struct ConsoleTask {
+  const struct ConsoleCallback* callback;  // NULL if this slot is free
+  struct ConsoleConfig* console;  // the console that started the command
+  uint8_t argc;
+  char* argv[CONSOLE_MAX_ARGS];  // points into line
+  char line[CONSOLE_MAX_LINE_CHARS + 1];
+  uint32_t calls;  // number of earlier calls, zero on the first
+  // Set on a final call when the user presses ctrl-c.  The return value of
+  // that call is ignored.
+  uint8_t cancelled;
+  // zeroed before the first call
+  uint8_t state[CONSOLE_TASK_STATE_SIZE];
+};
+#endif
+
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+// A command line that has already been split into arguments and matched
+// to a callback.
+struct ConsoleCommand {
+  const struct ConsoleCallback* callback;
+  uint8_t argc;  // not including the command itself
+  uint16_t arg_offset[CONSOLE_MAX_ARGS];  // argv[i] is line + arg_offset[i]
+  char line[CONSOLE_MAX_LINE_CHARS + 1];
+};
+
+// Single-producer/single-consumer queue of commands.  The side that parses
+// lines pushes and the side that runs callbacks pops, possibly on another
+// core.  head and tail are free running counters.
+struct ConsoleCommandQueue {
+  struct ConsoleCommand slots[CONSOLE_COMMAND_QUEUE_SLOTS];
+  volatile uint8_t head;  // only written by the parsing side
+  volatile uint8_t tail;  // only written by the running side
+  uint32_t overflows;  // commands dropped because the queue was full
+  uint8_t high_water;  // largest number of commands that were ever waiting
+};
+#endif
+
+#if CONSOLE_LINE_CACHE > 0
+// A line that was run before, already split and matched to a command
+struct ConsoleLineCacheEntry {
+  const struct ConsoleCallback* callback;  // NULL if this entry is unused
+  uint16_t line_length;
+  uint16_t tokens_length;  // bytes of tokens, including nulls
+  uint8_t num_args;  // including the command and any group names
+  uint8_t first;  // index of the callback's first argument
+  uint16_t arg_offset[CONSOLE_MAX_ARGS];  // arg[i] is tokens + arg_offset[i]
+  char line[CONSOLE_MAX_LINE_CHARS];  // as typed, the key
+  char tokens[CONSOLE_MAX_LINE_CHARS + 1];  // the split arguments
+};
+#endif
+
 struct ConsoleConfig {
   // Configuration
-  struct ConsoleCallback* callbacks;
-  uint8_t callback_count;
+  const struct ConsoleCallback* callbacks;
+  uint16_t callback_count;
+
+#if CONSOLE_COMMAND_INDEX_SIZE > 0
+  // callbacks indexes sorted by command name, built at init time
+  uint16_t command_index[CONSOLE_COMMAND_INDEX_SIZE];
+  // number of valid entries in command_index (zero if not built)
+  uint16_t command_index_count;
+#endif
+
+#if CONSOLE_STATS > 0
+  struct ConsoleStats stats;
+#endif
 
   // putchar callback which allow for devices other than stdio
   // to be used
   int (*putchar)(int c);
+#if CONSOLE_BINARY_MODE
+  // used instead of putchar in CONSOLE_BINARY mode if set (see
+  // uart_console_set_binary_putchar)
+  int (*binary_putchar)(int c);
+#endif
+
+  // optional block output callbacks (see uart_console_set_writer).  When
+  // write is set, it is used instead of putchar.
+  void (*write)(const char* data, size_t length);
+  void (*flush)(void);
+  // optional per-instance device (see uart_console_set_transport)
+  const struct ConsoleTransport* transport;
+  void* context;  // for the application, see uart_console_context()
+#if CONSOLE_OUTPUT_BUFFER_SIZE > 0
+  char output_buffer[CONSOLE_OUTPUT_BUFFER_SIZE];
+  uint16_t output_length;
+#endif
+  uint8_t output_pending;  // data was written since the last flush
+
+#if CONSOLE_WAKEUP
+  // set by uart_console_notify() and cleared by uart_console_poll()
+  volatile uint8_t input_pending;
+#endif
+
+#if CONSOLE_RX_BUFFER_SIZE > 0
+  // characters from uart_console_rx_push() that are waiting to be processed
+  struct ConsoleRing rx;
+  char rx_data[CONSOLE_RX_BUFFER_SIZE];
+#endif
+
+#if CONSOLE_TX_BUFFER_SIZE > 0
+  // output waiting to be sent by tx_drain (see uart_console_set_tx_drain).
+  // tx.overflows counts bytes dropped and tx.high_water the peak depth.
+  struct ConsoleRing tx;
+  char tx_data[CONSOLE_TX_BUFFER_SIZE];
+  const struct ConsoleTxDrain* tx_drain;
+  uint8_t tx_overflow;  // CONSOLE_TX_BLOCK or CONSOLE_TX_DROP
+  uint32_t tx_queued;  // bytes placed in tx
+#endif
+
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  // commands waiting to be run (see uart_console_set_remote_dispatch)
+  struct ConsoleCommandQueue commands;
+  // when set, parsed commands are queued instead of being run
+  uint8_t remote_dispatch;
+  // called after a command is queued, may be NULL
+  void (*command_queued)(void);
+  // set while uart_console_run_commands() (or "repeat") is running a callback
+  uint8_t running_commands;
+#endif
+
+#if CONSOLE_MAX_TASKS > 0
+  // resumable commands that are in progress
+  struct ConsoleTask tasks[CONSOLE_MAX_TASKS];
+  // set by ctrl-c, tasks are cancelled on the next uart_console_run_tasks()
+  volatile uint8_t cancel_tasks;
+#endif
+
+#if CONSOLE_REPLY_BUFFER_SIZE > 0
+  // output from uart_console_reply_write() waiting to be sent by
+  // uart_console_poll()
+  struct ConsoleRing reply;
+  char reply_data[CONSOLE_REPLY_BUFFER_SIZE];
+#endif
+
+#if CONSOLE_LINE_CACHE > 0
+  struct ConsoleLineCacheEntry line_cache[CONSOLE_LINE_CACHE];
+  uint8_t line_cache_next;  // the entry that is replaced next
+  // the line being parsed, kept until it is known to name a command
+  char line_cache_key[CONSOLE_MAX_LINE_CHARS];
+  uint16_t line_cache_key_length;
+  uint32_t line_cache_hits;
+  uint32_t line_cache_misses;
+#endif
 
   // Basic state that applies to all modes of operation
   char line[CONSOLE_MAX_LINE_CHARS + 1];
   uint16_t line_length;
   char* arg[CONSOLE_MAX_ARGS];
+  struct ConsoleTokenizer tokenizer;
+#if CONSOLE_INCREMENTAL_TOKENIZER
+  // arguments split from line, each null terminated.  Without
+  // CONSOLE_INCREMENTAL_TOKENIZER this is done in place in line.
+  char tokens[CONSOLE_MAX_LINE_CHARS + 1];
+#endif
   uint8_t terminal;  // terminal type (CONSOLE_VT102, CONSOLE_MINIMAL, etc)
   uint8_t prompt_displayed;
 
+#if CONSOLE_STREAM_BUFFER_SIZE > 0
+  // a raw payload claimed by a command (see uart_console_stream_start)
+  const struct ConsoleStream* stream;  // NULL unless a payload is expected
+  uint32_t stream_remaining;  // payload bytes still to come
+  uint16_t stream_fill;  // bytes in stream_data
+  uint16_t stream_crc;  // running crc of the payload
+  uint16_t stream_received_crc;
+  uint8_t stream_flags;
+  uint8_t stream_crc_bytes;  // crc bytes still to come
+  char stream_data[CONSOLE_STREAM_BUFFER_SIZE];
+#endif
+
+#if CONSOLE_BINARY_MODE
+  // state needed for CONSOLE_BINARY.  The payload is collected in line.
+  uint8_t binary_state;  // position within the frame
+  uint8_t binary_type;
+  uint8_t binary_seq;
+  uint16_t binary_length;  // payload length
+  uint16_t binary_crc;  // running crc
+  uint8_t arg_length[CONSOLE_MAX_ARGS];  // lengths of binary arguments
+  uint8_t binary_args;  // nonzero while arg holds the arguments of a frame
+  uint8_t binary_running;  // nonzero while a frame's callback runs
+  uint8_t binary_skip_seq;  // seq of a frame skipped while one was running
+#endif
+
   // extra state needed for vt102 modes
   uint8_t terminal_state;  // vt102 state tracking
   uint16_t cursor_index;  // used with vt102
 
   // tab complete (vt102 mode only)
-  // the length into line that tab complete is active for
-  uint16_t tab_length;
-  // index of the last command that tab complete displayed
-  uint8_t tab_callback_index;
+  // number of consecutive tab presses
+  uint8_t tab_count;
+  // prompt given to uart_console_poll(), used to redraw the line
+  const char* prompt;
 
 #if CONSOLE_HISTORY_LINES > 0
-  // state needed for history support
-  char history[(CONSOLE_MAX_LINE_CHARS + 1) * CONSOLE_HISTORY_LINES];
-  // contains the tail index (index of last entry written)
-  uint16_t history_tail_index;
-  // constains the number of entries to look backwards in the queue (usually zero)
+  // state needed for history support.  history is a circular arena of
+  // entries, oldest first, each stored as length, characters, length so
+  // that it can be walked in either direction.
+  char history[CONSOLE_HISTORY_BYTES];
+  uint16_t history_head;  // start of the oldest entry
+  uint16_t history_tail;  // end of the newest entry
+  uint16_t history_used;  // bytes in use
+  uint16_t history_count;  // number of entries
+  uint16_t history_marker;  // start of the entry being shown
+  // contains the number of entries to look backwards in the queue (-1 when
+  // not looking at history)
   int16_t history_marker_index;
+  // up/down arrow only recall entries that start with this many characters
+  // of line (the ones before the cursor when the first arrow was pressed)
+  uint16_t history_prefix_length;
+  // ctrl-r search state
+  uint8_t history_search;  // 1 while searching
+  uint8_t history_query_length;
+  char history_query[CONSOLE_HISTORY_QUERY_CHARS];
+  uint16_t history_search_shown;  // characters shown after the prompt
 #endif
 };
 
-// Initializes console with output to stdout
+// Initializes console with output to stdout.  Passing NULL callbacks uses
+// the commands registered with CONSOLE_COMMAND (callback_count is ignored).
 void uart_console_init(
   struct ConsoleConfig* cc,
-  struct ConsoleCallback* callbacks,
-  uint8_t callback_count,
+  const struct ConsoleCallback* callbacks,
+  uint16_t callback_count,
   uint8_t flags);
 
 // Initalized console with custom output callback.  This allows non-stdio
 // devices (like an LCD screen or low-level hardware driver) to be used.
+//
+// If CONSOLE_COMMAND_INDEX_SIZE > 0, the command lookup index is built here so
+// changes to the callbacks table after initialization require the console to
+// be initialized again.
 void uart_console_init_lowlevel(
   struct ConsoleConfig* cc,
-  struct ConsoleCallback* callbacks,
-  uint8_t callback_count,
+  const struct ConsoleCallback* callbacks,
+  uint16_t callback_count,
   uint8_t mode,
   int (*putchar)(int c));
 
-// Polls for some characters using getchar_timeout_us().  This function may call
+// Registers block output callbacks.  Console output is coalesced into a
+// CONSOLE_OUTPUT_BUFFER_SIZE staging buffer and given to write() in chunks.
+// flush() (which can be NULL) is called once at the end of each
+// uart_console_putchar() or uart_console_poll() call that produced output
+// and before any registered callback is invoked.  Passing a NULL write
+// returns to the putchar path.
+void uart_console_set_writer(
+  struct ConsoleConfig* cc,
+  void (*write)(const char* data, size_t length),
+  void (*flush)(void));
+
+// Reads input from transport->read() instead of getchar_timeout_us() and,
+// if transport->write is set, sends output there instead of the writer or
+// putchar() given at initialization.  context is kept for the transport
+// and callbacks to use (see uart_console_context()).  Each console has its
+// own state, so several can run at once on different devices with one
+// callbacks table, from one loop or one per core.  Pass NULL to go back to
+// stdio.
+void uart_console_set_transport(
+  struct ConsoleConfig* cc,
+  const struct ConsoleTransport* transport,
+  void* context);
+
+// Returns the context given to uart_console_set_transport()
+void* uart_console_context(const struct ConsoleConfig* cc);
+
+// Sends any staged output to write() and calls flush().  This is done
+// automatically but may be useful when mixing console output with other
+// output.
+void uart_console_flush(struct ConsoleConfig* cc);
+
+// Polls for some characters using getchar_timeout_us() (or the transport's
+// read function, see uart_console_set_transport()).  This function may call
 // any of the callbacks defined in ConsoleConfig before returning.
 // returns the number of characters processed.
+//
+// If CONSOLE_RX_BUFFER_SIZE > 0, characters given to uart_console_rx_push()
+// are processed first.
 uint32_t uart_console_poll(struct ConsoleConfig* cc, const char* prompt);
 
+// Sends data through the console's output path (cc->tx when a drain is set,
+// otherwise write() or putchar()) so that callback output stays in order
+// with the console's own.
+void uart_console_write(
+  struct ConsoleConfig* cc, const char* data, uint16_t length);
+
+// Formats output (see src/format.h for what is supported) and sends it like
+// uart_console_write().  Handlers use this to reply on the console that
+// received the command.
+void uart_console_printf(struct ConsoleConfig* cc, const char* fmt, ...)
+  __attribute__((format(printf, 2, 3)));
+
 // Provides a character for processing.  This can be used for more advanced
-// usecases where one wants to avoid calling getchar_time_us().  An example
-// would be collecting uart character via an interrupt handler. 
+// usecases where one wants to avoid calling getchar_time_us().  This function
+// runs the editor and may call any of the callbacks so it should not be
+// called from an interrupt handler.  See uart_console_rx_push() for that.
 void uart_console_putchar(struct ConsoleConfig* cc, char c);
 
+// Runs a command line without going through the terminal: there is no
+// echo, editing or history and a line that is being typed is left as it
+// was.  The line is split and dispatched like one that was entered
+// (including "help"), and errors are printed the same way.  Can be called
+// from a callback, though with CONSOLE_COMMAND_QUEUE_SLOTS the command is
+// then queued and runs after that callback returns.  Returns a
+// CONSOLE_EXEC_* code.
+//
+// With remote dispatch (see uart_console_set_remote_dispatch) it must only
+// be called on the core that calls uart_console_poll().  A callback runs on
+// the other core while this one may be editing cc->line, and the command
+// queue allows only one core to add to it.  A call made while that core is
+// running callbacks prints nothing and returns CONSOLE_EXEC_REMOTE.
+uint8_t uart_console_exec(struct ConsoleConfig* cc, const char* line);
+
+// Runs each line of script with uart_console_exec(), for example to set
+// the device up at boot from a string in flash.  Lines are separated by
+// "\n" (a "\r" before it is ignored) and blank lines and lines that start
+// with "#" are skipped.  Stops at the first line that fails and returns its
+// line number (counting from 1), or returns 0 if every line succeeded.
+// Has the same restriction on remote dispatch as uart_console_exec(): a
+// call from a callback returns 1 without running anything.
+uint16_t uart_console_run_script(struct ConsoleConfig* cc, const char* script);
+
+#if CONSOLE_WAKEUP
+// Marks input as pending and wakes a core that is sleeping in
+// uart_console_wait().  Call this from the interrupt handler of a
+// transport's device.  Safe to call from an interrupt handler or the other
+// core.  uart_console_rx_push() and uart_console_reply_write() do this
+// themselves.
+void uart_console_notify(struct ConsoleConfig* cc);
+
+// Calls uart_console_notify() whenever stdio (USB or UART) receives
+// characters, using stdio_set_chars_available_callback().  stdio has a
+// single callback so only one console can use this at a time.  Pass NULL
+// to remove it.
+void uart_console_notify_on_stdio(struct ConsoleConfig* cc);
+
+// Sleeps the core with __wfe() until uart_console_notify() is called or
+// timeout_us passes, for use between calls to uart_console_poll():
+//
+//   while (1) {
+//     uart_console_poll(&cc, "> ");
+//     uart_console_wait(&cc, 100000);
+//   }
+//
+// Returns at once if there is already work for uart_console_poll()
+// (notified input, characters in cc->rx, replies or pending resumable
+// commands).  Returns 1 if there is work or 0 on timeout.  Other events
+// can also wake the core, so the timeout is a maximum.
+uint8_t uart_console_wait(struct ConsoleConfig* cc, uint32_t timeout_us);
+#endif
+
+#if CONSOLE_STATS > 0
+// Replaces the clock used to time commands (time_us_64() by default)
+void uart_console_set_stats_clock(
+  struct ConsoleConfig* cc, uint64_t (*clock_us)(void));
+#endif
+
+#if CONSOLE_HISTORY_LINES > 0
+// Copies a command history entry into line (which needs room for
+// CONSOLE_MAX_LINE_CHARS + 1 characters) as a null terminated string.  back
+// is 0 for the newest entry, 1 for the one before that, etc.  Returns the
+// length or -1 if there is no such entry.
+int16_t uart_console_history(
+  const struct ConsoleConfig* cc, uint16_t back, char* line);
+#endif
+
+#if CONSOLE_RX_BUFFER_SIZE > 0
+// Queues a received character for the next uart_console_poll().  This only
+// touches cc->rx so it is safe to call from an interrupt handler (such as a
+// UART RX IRQ) while the main loop is polling.  Returns 1 on success or 0 if
+// the buffer was full, in which case cc->rx.overflows is incremented.
+// cc->rx.high_water tracks the deepest the buffer has been.
+uint8_t uart_console_rx_push(struct ConsoleConfig* cc, char c);
+#endif
+
+#if CONSOLE_TX_BUFFER_SIZE > 0
+// Sends console output through cc->tx instead of putchar() or write() so
+// that the main loop never waits for the device.  drain moves the bytes
+// out, usually from an interrupt handler, and overflow (CONSOLE_TX_BLOCK or
+// CONSOLE_TX_DROP) says what happens when output arrives faster than that.
+// Pass NULL to go back to putchar() or write().
+void uart_console_set_tx_drain(
+  struct ConsoleConfig* cc,
+  const struct ConsoleTxDrain* drain,
+  uint8_t overflow);
+
+// Takes the next byte of output (0-255) or returns -1 if there is none.
+// Safe to call from an interrupt handler.
+int uart_console_tx_pop(struct ConsoleConfig* cc);
+
+// Points *data at the oldest output and returns how many bytes can be read
+// from there in one piece, for starting a DMA transfer.  Safe to call from
+// an interrupt handler.
+uint16_t uart_console_tx_peek(struct ConsoleConfig* cc, const char** data);
+
+// Releases length bytes returned by uart_console_tx_peek() once they are
+// sent.
+void uart_console_tx_consume(struct ConsoleConfig* cc, uint16_t length);
+#endif
+
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+// Splits the work between two cores (or threads).  After this is called,
+// the core that calls uart_console_poll() only edits and parses lines.
+// Commands that parse without error are placed in cc->commands and the
+// callbacks run when the other core calls uart_console_run_commands().  If
+// the queue is full, the command is dropped with an error message and
+// counted in cc->commands.overflows.
+//
+// command_queued (which can be NULL) is called on the polling core after a
+// command is queued.  It can be used to wake up the other core, for
+// example with __sev() or the multicore FIFO.
+//
+// Built-in commands like "help" still run on the polling core.
+void uart_console_set_remote_dispatch(
+  struct ConsoleConfig* cc,
+  void (*command_queued)(void));
+
+// Runs all commands that are waiting in cc->commands and returns the number
+// that were run.  With remote dispatch, call this from the core that should
+// run the callbacks, at a point of its choosing.
+//
+// Without remote dispatch, this is called automatically and each command is
+// run as soon as it is parsed.  If that callback calls uart_console_poll()
+// (to stay responsive during a long operation), lines completed in the
+// nested poll are tokenized into the queue instead of running recursively
+// and then run back-to-back once the callback returns.  This lets a host
+// pipeline commands without waiting for a prompt.  Calling this from
+// within a callback does nothing.
+uint8_t uart_console_run_commands(struct ConsoleConfig* cc);
+
+// Number of commands waiting in cc->commands.  Can be called from either
+// side.
+uint8_t uart_console_command_queue_depth(const struct ConsoleConfig* cc);
+#endif
+
+#if CONSOLE_REPLY_BUFFER_SIZE > 0
+// Queues output to be sent by the next uart_console_poll().  This never
+// blocks and does not touch the output device so callbacks running on
+// another core can use it while the polling core is busy.  Characters that
+// do not fit are dropped and counted in cc->reply.overflows.  Returns the
+// number of characters queued.
+uint16_t uart_console_reply_write(
+  struct ConsoleConfig* cc, const char* data, uint16_t length);
+
+// Formats a string with uart_console_reply_write() (see src/format.h for
+// what is supported).
+void uart_console_reply_printf(struct ConsoleConfig* cc, const char* fmt, ...);
+#endif
+
+#if CONSOLE_MAX_TASKS > 0
+// Calls each pending resumable command once and returns the number that
+// are still pending.  Tasks are cancelled here if ctrl-c was pressed.
+// uart_console_poll() calls this (unless remote dispatch is used, in which
+// case uart_console_run_commands() does) so it is only needed when feeding
+// characters with uart_console_putchar().
+uint8_t uart_console_run_tasks(struct ConsoleConfig* cc);
+#endif
+
+#if CONSOLE_BINARY_MODE
+// Sets a putchar() for CONSOLE_BINARY output that passes every byte through
+// unchanged.  The Pico SDK's putchar() turns "\n" into "\r\n", which would
+// break any frame with a 0x0A byte in it, so uart_console_init() sets this
+// to putchar_raw().  Only the putchar path uses it: output through a writer,
+// transport or cc->tx is already sent as is.
+void uart_console_set_binary_putchar(
+  struct ConsoleConfig* cc, int (*binary_putchar)(int c));
+
+// Sends a CONSOLE_BINARY_DATA response frame for the command that is
+// running.  Callbacks should use this instead of printf() in CONSOLE_BINARY
+// mode.
+void uart_console_binary_reply(
+  struct ConsoleConfig* cc, const char* data, uint16_t length);
+
+// Length of argv[index], where argv is what the running callback was given.
+// In CONSOLE_BINARY mode arguments can contain zeros so strlen() is not
+// reliable.  Otherwise (including resumable commands, which get a copy of
+// their arguments) this is strlen(argv[index]).
+uint16_t uart_console_arg_length(
+  const struct ConsoleConfig* cc, char* argv[], uint8_t index);
+#endif
+
+#if CONSOLE_STREAM_BUFFER_SIZE > 0
+// Claims the next length bytes of input (plus two for the crc with
+// CONSOLE_STREAM_CRC) as a raw payload for stream, typically from a command
+// like "upload 4096".  The payload starts right after the line that ran the
+// command and skips echo, editing and parsing, so any byte value is allowed
+// and ctrl-c does not cancel it.  The command line must end with a lone
+// CR: a sender that ends lines with CR LF delivers the LF as the first
+// payload byte.  Afterwards the line editor takes over again and shows a
+// new prompt.  Returns 0 if a payload is already expected or
+// with remote dispatch, where the command runs too late to claim the input.
+uint8_t uart_console_stream_start(
+  struct ConsoleConfig* cc,
+  const struct ConsoleStream* stream,
+  uint32_t length,
+  uint8_t flags);
+
+// Ends the payload early, for example after a timeout.  Bytes already
+// received are passed to chunk() and done() gets CONSOLE_STREAM_CANCELLED.
+void uart_console_stream_cancel(struct ConsoleConfig* cc);
+#endif
+
 #endif
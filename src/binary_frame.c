@@ -0,0 +1,263 @@
+// Length-prefixed binary frames for program clients (CONSOLE_BINARY)
+#include "binary_frame.h"
+#include "util.h"
+#include "command_task.h"
+#include "command_args.h"
+#include "format.h"
+#include <string.h>
+
+#if CONSOLE_BINARY_MODE || (CONSOLE_STREAM_BUFFER_SIZE > 0)
+// crc of each 4 bit value, which is a good speed/size tradeoff
+static const uint16_t crc_nibble_table[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+static inline uint16_t crc16_byte(uint16_t crc, uint8_t b) {
+  crc = (crc << 4) ^ crc_nibble_table[(crc >> 12) ^ (b >> 4)];
+  crc = (crc << 4) ^ crc_nibble_table[(crc >> 12) ^ (b & 0x0F)];
+  return crc;
+}
+
+uint16_t binary_crc16(uint16_t crc, const char* data, uint16_t length) {
+  for (uint16_t i=0; i<length; ++i) {
+    crc = crc16_byte(crc, data[i]);
+  }
+  return crc;
+}
+#endif
+
+#if CONSOLE_BINARY_MODE
+// position within the frame (cc->binary_state)
+#define FRAME_SYNC        0x00
+#define FRAME_TYPE        0x01
+#define FRAME_SEQ         0x02
+#define FRAME_LENGTH_LOW  0x03
+#define FRAME_LENGTH_HIGH 0x04
+#define FRAME_PAYLOAD     0x05
+#define FRAME_CRC_LOW     0x06
+#define FRAME_CRC_HIGH    0x07
+#define FRAME_SKIP        0x08  // payload and crc of a frame that cannot run
+
+static void send_frame(
+    struct ConsoleConfig* cc,
+    uint8_t type,
+    const char* data,
+    uint16_t length) {
+  const char header[5] = {
+    CONSOLE_BINARY_SYNC,
+    type,
+    cc->binary_seq,
+    length & 0xFF,
+    length >> 8,
+  };
+  uint16_t crc = binary_crc16(0xFFFF, header + 1, sizeof(header) - 1);
+  crc = binary_crc16(crc, data, length);
+  const char trailer[2] = {crc & 0xFF, crc >> 8};
+  console_write(cc, header, sizeof(header));
+  console_write(cc, data, length);
+  console_write(cc, trailer, sizeof(trailer));
+}
+
+static void send_error(struct ConsoleConfig* cc, uint8_t type, const char* msg) {
+#if CONSOLE_STATS > 0
+  if (type == CONSOLE_BINARY_UNKNOWN) {
+    ++cc->stats.unknown_commands;
+  } else if (type == CONSOLE_BINARY_BAD_ARGS) {
+    ++cc->stats.parse_errors;
+  }
+#endif
+  send_frame(cc, type, msg, strlen(msg));
+}
+
+// Converts the payload in cc->line from length-prefixed arguments to null
+// terminated ones that cc->arg[] points at.  Each length byte is replaced
+// by the terminator of the argument before it.  Returns the number of
+// arguments or -1 if the payload is malformed.
+static int unpack_args(struct ConsoleConfig* cc) {
+  char* line = cc->line;
+  const uint16_t length = cc->binary_length;
+  int argc = 0;
+  uint16_t i = 0;
+  while (i < length) {
+    if (argc >= (CONSOLE_MAX_ARGS - 1)) {
+      return -1;
+    }
+    const uint8_t arg_length = line[i];
+    if (i + 1 + arg_length > length) {
+      return -1;
+    }
+    line[i] = '\0';
+    ++argc;
+    cc->arg[argc] = line + i + 1;
+    cc->arg_length[argc] = arg_length;
+    i += 1 + arg_length;
+  }
+  line[length] = '\0';
+  return argc;
+}
+
+// Nonzero if a callback is running, so cc->line may still hold its
+// arguments and a new frame must not be collected into it
+static uint8_t callback_running(const struct ConsoleConfig* cc) {
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  if (cc->running_commands) {
+    return 1;
+  }
+#endif
+  return cc->binary_running;
+}
+
+static void run_frame(struct ConsoleConfig* cc) {
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  if (cc->remote_dispatch) {
+    // Frames are not queued, so the callback would run on this core
+    send_error(
+        cc, CONSOLE_BINARY_UNSUPPORTED, "Not available with remote dispatch");
+    return;
+  }
+#endif
+  if (cc->binary_type >= cc->callback_count) {
+    send_error(cc, CONSOLE_BINARY_UNKNOWN, "Unknown command");
+    return;
+  }
+  const struct ConsoleCallback* cb = cc->callbacks + cc->binary_type;
+  cc->arg[0] = (char*)cb->command;
+  const int argc = unpack_args(cc);
+  if (argc < 0) {
+    send_error(cc, CONSOLE_BINARY_BAD_ARGS, "Malformed arguments");
+    return;
+  }
+  union ConsoleValue values[CONSOLE_MAX_ARGS];
+#if CONSOLE_TYPED_ARGS
+  if (cb->args) {
+    uint8_t bad_arg;
+    const uint8_t result =
+      args_convert(cb, argc, cc->arg + 1, values, &bad_arg);
+    if (result != ARGS_OK) {
+      char msg[32];
+      console_sformat(msg, sizeof(msg), "Bad argument %d", bad_arg);
+      send_error(
+          cc, CONSOLE_BINARY_BAD_ARGS,
+          (result == ARGS_COUNT) ? "Wrong number of arguments" : msg);
+      return;
+    }
+  } else
+#endif
+  if ((cb->num_args >= 0) && (cb->num_args != argc)) {
+    char msg[32];
+    console_sformat(msg, sizeof(msg), "Expected %d arguments", cb->num_args);
+    send_error(cc, CONSOLE_BINARY_BAD_ARGS, msg);
+    return;
+  }
+  // the callback may produce output of its own
+  console_flush(cc);
+  cc->binary_args = 1;
+  cc->binary_running = 1;
+  command_invoke(cc, cb, argc, cc->arg + 1, values);
+  cc->binary_running = 0;
+  cc->binary_args = 0;
+  send_frame(cc, CONSOLE_BINARY_OK, NULL, 0);
+}
+
+void binary_process_char(struct ConsoleConfig* cc, char c) {
+  const uint8_t b = c;
+  switch (cc->binary_state) {
+    case FRAME_SYNC:
+      // anything else is noise, keep looking for the start of a frame
+      if (b == CONSOLE_BINARY_SYNC) {
+        cc->binary_crc = 0xFFFF;
+        cc->binary_state = FRAME_TYPE;
+      }
+      return;
+    case FRAME_TYPE:
+      cc->binary_type = b;
+      break;
+    case FRAME_SEQ:
+      // the running callback's replies keep the seq of its own frame
+      if (callback_running(cc)) {
+        cc->binary_skip_seq = b;
+      } else {
+        cc->binary_seq = b;
+      }
+      break;
+    case FRAME_LENGTH_LOW:
+      cc->binary_length = b;
+      break;
+    case FRAME_LENGTH_HIGH:
+      cc->binary_length |= (uint16_t)b << 8;
+      if (cc->binary_length > CONSOLE_MAX_LINE_CHARS) {
+        send_error(cc, CONSOLE_BINARY_TOO_LONG, "Payload too long");
+        cc->binary_state = FRAME_SYNC;
+        return;
+      }
+      if (callback_running(cc)) {
+        // the payload would overwrite the running callback's arguments
+        cc->binary_length += 2;  // the crc is skipped too
+        cc->binary_state = FRAME_SKIP;
+        return;
+      }
+      cc->line_length = 0;
+      cc->binary_crc = crc16_byte(cc->binary_crc, b);
+      cc->binary_state =
+        cc->binary_length ? FRAME_PAYLOAD : FRAME_CRC_LOW;
+      return;
+    case FRAME_PAYLOAD:
+      cc->line[cc->line_length++] = c;
+      cc->binary_crc = crc16_byte(cc->binary_crc, b);
+      if (cc->line_length >= cc->binary_length) {
+        cc->binary_state = FRAME_CRC_LOW;
+      }
+      return;
+    case FRAME_CRC_LOW:
+      // done with the running crc, the expected value is xored in
+      cc->binary_crc ^= b;
+      cc->binary_state = FRAME_CRC_HIGH;
+      return;
+    case FRAME_CRC_HIGH:
+      cc->binary_crc ^= (uint16_t)b << 8;
+      cc->binary_state = FRAME_SYNC;
+      if (cc->binary_crc) {
+        send_error(cc, CONSOLE_BINARY_BAD_CRC, "Bad CRC");
+      } else {
+        run_frame(cc);
+      }
+      cc->line_length = 0;
+      return;
+    case FRAME_SKIP:
+      if (--cc->binary_length == 0) {
+        const uint8_t seq = cc->binary_seq;
+        cc->binary_seq = cc->binary_skip_seq;
+        cc->binary_state = FRAME_SYNC;
+        send_error(cc, CONSOLE_BINARY_BUSY, "Busy");
+        cc->binary_seq = seq;
+      }
+      return;
+    default:
+      cc->binary_state = FRAME_SYNC;
+      return;
+  }
+  // header bytes
+  cc->binary_crc = crc16_byte(cc->binary_crc, b);
+  ++cc->binary_state;
+}
+
+void uart_console_set_binary_putchar(
+    struct ConsoleConfig* cc, int (*binary_putchar)(int c)) {
+  cc->binary_putchar = binary_putchar;
+}
+
+void uart_console_binary_reply(
+    struct ConsoleConfig* cc, const char* data, uint16_t length) {
+  send_frame(cc, CONSOLE_BINARY_DATA, data, length);
+}
+
+uint16_t uart_console_arg_length(
+    const struct ConsoleConfig* cc, char* argv[], uint8_t index) {
+  // only a command run straight from a frame has argv in cc->arg
+  if (cc->binary_args && (argv == cc->arg + 1)) {
+    return cc->arg_length[index + 1];
+  }
+  return strlen(argv[index]);
+}
+#endif
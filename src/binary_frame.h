@@ -0,0 +1,18 @@
+#ifndef UART_CONSOLE_BINARY_FRAME_H
+#define UART_CONSOLE_BINARY_FRAME_H
+// Handles CONSOLE_BINARY mode.  See console.h for the frame layout.
+#include "uart_console/console.h"
+
+#if CONSOLE_BINARY_MODE
+// Processes one received byte.  When a complete frame with a good crc
+// has arrived, the arguments are unpacked in place in cc->line, the command
+// is run and a final status frame is sent.
+void binary_process_char(struct ConsoleConfig* cc, char c);
+#endif
+
+#if CONSOLE_BINARY_MODE || (CONSOLE_STREAM_BUFFER_SIZE > 0)
+// Updates a CRC-16/CCITT-FALSE (start with 0xFFFF) with length bytes.  Also
+// used to check stream payloads.
+uint16_t binary_crc16(uint16_t crc, const char* data, uint16_t length);
+#endif
+#endif
@@ -0,0 +1,198 @@
+// Checks and converts typed command arguments
+#include "command_args.h"
+#include "util.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CONSOLE_TYPED_ARGS
+static uint8_t is_variadic(const struct ConsoleCallback* cb) {
+  return (cb->num_args > 0) &&
+    (cb->args[cb->num_args - 1].type & CONSOLE_ARG_VARIADIC);
+}
+
+const struct ConsoleArg* args_at(
+    const struct ConsoleCallback* cb, uint8_t position) {
+  if (position < cb->num_args) {
+    return cb->args + position;
+  }
+  if (is_variadic(cb)) {
+    return cb->args + cb->num_args - 1;
+  }
+  return NULL;
+}
+
+static uint8_t check_count(const struct ConsoleCallback* cb, uint8_t argc) {
+  uint8_t required = 0;
+  for (; required < cb->num_args; ++required) {
+    if (cb->args[required].type &
+        (CONSOLE_ARG_OPTIONAL | CONSOLE_ARG_VARIADIC)) {
+      break;
+    }
+  }
+  return (argc >= required) && ((argc <= cb->num_args) || is_variadic(cb));
+}
+
+static uint8_t in_range(const struct ConsoleArg* arg, union ConsoleValue v) {
+  if (arg->min == arg->max) {
+    return 1;
+  }
+  switch (arg->type & CONSOLE_ARG_TYPE_MASK) {
+    case CONSOLE_ARG_INT:
+      return (v.i >= arg->min) && (v.i <= arg->max);
+    case CONSOLE_ARG_UNSIGNED:
+    case CONSOLE_ARG_HEX:
+      return (v.u >= (uint32_t)arg->min) && (v.u <= (uint32_t)arg->max);
+    case CONSOLE_ARG_FLOAT:
+      return (v.f >= arg->min) && (v.f <= arg->max);
+  }
+  return 1;
+}
+
+static uint8_t convert(
+    const struct ConsoleArg* arg, const char* s, union ConsoleValue* v) {
+  char* end = NULL;
+  errno = 0;
+  switch (arg->type & CONSOLE_ARG_TYPE_MASK) {
+    case CONSOLE_ARG_INT: {
+      const long n = strtol(s, &end, 0);
+      if ((n < INT32_MIN) || (n > INT32_MAX)) {
+        errno = ERANGE;
+      }
+      v->i = n;
+      break;
+    }
+    case CONSOLE_ARG_UNSIGNED:
+    case CONSOLE_ARG_HEX: {
+      if (*s == '-') {
+        return ARGS_BAD_VALUE;  // strtoul() would accept it
+      }
+      const int base =
+        ((arg->type & CONSOLE_ARG_TYPE_MASK) == CONSOLE_ARG_HEX) ? 16 : 0;
+      const unsigned long n = strtoul(s, &end, base);
+      if (n > UINT32_MAX) {
+        errno = ERANGE;
+      }
+      v->u = n;
+      break;
+    }
+    case CONSOLE_ARG_FLOAT:
+      v->f = strtof(s, &end);
+      break;
+    case CONSOLE_ARG_ENUM:
+      for (uint32_t i=0; arg->choices[i]; ++i) {
+        if (!strcmp(s, arg->choices[i])) {
+          v->u = i;
+          return ARGS_OK;
+        }
+      }
+      return ARGS_CHOICE;
+    default:
+      v->s = s;
+      return ARGS_OK;
+  }
+
+  if ((*s == '\0') || (*end != '\0')) {
+    return ARGS_BAD_VALUE;
+  }
+  if ((errno == ERANGE) || !in_range(arg, *v)) {
+    return ARGS_RANGE;
+  }
+  return ARGS_OK;
+}
+
+uint8_t args_convert(
+    const struct ConsoleCallback* cb,
+    uint8_t argc,
+    char* argv[],
+    union ConsoleValue* values,
+    uint8_t* bad_arg) {
+  *bad_arg = 0;
+  if (!check_count(cb, argc)) {
+    return ARGS_COUNT;
+  }
+  if (argc < cb->num_args) {
+    // optional arguments that were left off
+    memset(values + argc, 0, sizeof(union ConsoleValue) * (cb->num_args - argc));
+  }
+  for (uint8_t i=0; i<argc; ++i) {
+    const uint8_t result = convert(args_at(cb, i), argv[i], values + i);
+    if (result != ARGS_OK) {
+      *bad_arg = i;
+      return result;
+    }
+  }
+  return ARGS_OK;
+}
+
+void args_print_usage(
+    struct ConsoleConfig* cc, const struct ConsoleCallback* cb) {
+  for (int16_t i=0; i<cb->num_args; ++i) {
+    const struct ConsoleArg* arg = cb->args + i;
+    if (arg->type & CONSOLE_ARG_VARIADIC) {
+      console_printf(cc, " [%s...]", arg->name);
+    } else if (arg->type & CONSOLE_ARG_OPTIONAL) {
+      console_printf(cc, " [%s]", arg->name);
+    } else {
+      console_printf(cc, " <%s>", arg->name);
+    }
+  }
+}
+
+static const char* type_name(uint8_t type) {
+  switch (type & CONSOLE_ARG_TYPE_MASK) {
+    case CONSOLE_ARG_INT:
+      return "an integer";
+    case CONSOLE_ARG_UNSIGNED:
+      return "an unsigned integer";
+    case CONSOLE_ARG_HEX:
+      return "a hex number";
+  }
+  return "a number";
+}
+
+void args_print_error(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* cb,
+    uint8_t result,
+    uint8_t bad_arg,
+    char* argv[]) {
+  if (result == ARGS_COUNT) {
+    console_printf(cc, "%s: Usage: %s", cb->command, cb->command);
+    args_print_usage(cc, cb);
+    console_printf(cc, "\n");
+    return;
+  }
+
+  const struct ConsoleArg* arg = args_at(cb, bad_arg);
+  switch (result) {
+    case ARGS_BAD_VALUE:
+      console_printf(cc, "%s: %s \"%s\" is not %s\n",
+          cb->command, arg->name, argv[bad_arg], type_name(arg->type));
+      break;
+    case ARGS_RANGE:
+      if (arg->min == arg->max) {
+        console_printf(cc, "%s: %s \"%s\" is out of range\n",
+            cb->command, arg->name, argv[bad_arg]);
+      } else if ((arg->type & CONSOLE_ARG_TYPE_MASK) == CONSOLE_ARG_INT ||
+          (arg->type & CONSOLE_ARG_TYPE_MASK) == CONSOLE_ARG_FLOAT) {
+        console_printf(cc, "%s: %s must be %ld to %ld\n",
+            cb->command, arg->name, (long)arg->min, (long)arg->max);
+      } else {
+        console_printf(cc, "%s: %s must be %lu to %lu\n",
+            cb->command, arg->name,
+            (unsigned long)(uint32_t)arg->min,
+            (unsigned long)(uint32_t)arg->max);
+      }
+      break;
+    case ARGS_CHOICE:
+      console_printf(cc, "%s: %s must be one of:", cb->command, arg->name);
+      for (uint32_t i=0; arg->choices[i]; ++i) {
+        console_printf(cc, " %s", arg->choices[i]);
+      }
+      console_printf(cc, "\n");
+      break;
+  }
+}
+#endif
@@ -0,0 +1,39 @@
+#ifndef UART_CONSOLE_COMMAND_ARGS_H
+#define UART_CONSOLE_COMMAND_ARGS_H
+// Checks and converts arguments described by ConsoleCallback.args
+#include "uart_console/console.h"
+
+// Results of args_convert()
+#define ARGS_OK        0
+#define ARGS_COUNT     1  // too few or too many arguments
+#define ARGS_BAD_VALUE 2  // not a number of the expected type
+#define ARGS_RANGE     3  // outside of ConsoleArg.min to max
+#define ARGS_CHOICE    4  // not one of ConsoleArg.choices
+
+// Converts argv[] into values[] (which must have CONSOLE_MAX_ARGS entries)
+// and zeros the values of optional arguments that were left off.
+// On failure, *bad_arg is set to the index of the offending argument.
+uint8_t args_convert(
+  const struct ConsoleCallback* cb,
+  uint8_t argc,
+  char* argv[],
+  union ConsoleValue* values,
+  uint8_t* bad_arg);
+
+// Prints a message for a failed args_convert()
+void args_print_error(
+  struct ConsoleConfig* cc,
+  const struct ConsoleCallback* cb,
+  uint8_t result,
+  uint8_t bad_arg,
+  char* argv[]);
+
+// Prints the argument names as " <a> [b] [c...]"
+void args_print_usage(
+  struct ConsoleConfig* cc, const struct ConsoleCallback* cb);
+
+// Returns the description of argument position (0 is the first argument
+// after the command) or NULL if there isn't one
+const struct ConsoleArg* args_at(
+  const struct ConsoleCallback* cb, uint8_t position);
+#endif
@@ -0,0 +1,151 @@
+// Runs command lines given by the program rather than typed
+#include "uart_console/console.h"
+#include "parse_line.h"
+#include "tokenize.h"
+#include "util.h"
+#include <string.h>
+
+// The parts of ConsoleConfig that running a line changes.  They are put
+// back afterwards so that a line being typed, or the arguments of the
+// callback that called uart_console_exec(), are left as they were.
+struct SavedLine {
+  char line[CONSOLE_MAX_LINE_CHARS + 1];
+  uint16_t line_length;
+  uint16_t cursor_index;
+  char* arg[CONSOLE_MAX_ARGS];
+  struct ConsoleTokenizer tokenizer;
+#if CONSOLE_INCREMENTAL_TOKENIZER
+  char tokens[CONSOLE_MAX_LINE_CHARS + 1];
+#endif
+  uint8_t prompt_displayed;
+  uint8_t tab_count;
+#if CONSOLE_BINARY_MODE
+  uint8_t binary_state;
+  uint8_t binary_args;
+#endif
+#if CONSOLE_HISTORY_LINES > 0
+  int16_t history_marker_index;
+  uint8_t history_search;
+  uint16_t history_search_shown;
+#endif
+};
+
+static void save_line(const struct ConsoleConfig* cc, struct SavedLine* s) {
+  memcpy(s->line, cc->line, sizeof(s->line));
+  s->line_length = cc->line_length;
+  s->cursor_index = cc->cursor_index;
+  memcpy(s->arg, cc->arg, sizeof(s->arg));
+  s->tokenizer = cc->tokenizer;
+#if CONSOLE_INCREMENTAL_TOKENIZER
+  memcpy(s->tokens, cc->tokens, sizeof(s->tokens));
+#endif
+  s->prompt_displayed = cc->prompt_displayed;
+  s->tab_count = cc->tab_count;
+#if CONSOLE_BINARY_MODE
+  s->binary_state = cc->binary_state;
+  s->binary_args = cc->binary_args;
+#endif
+#if CONSOLE_HISTORY_LINES > 0
+  s->history_marker_index = cc->history_marker_index;
+  s->history_search = cc->history_search;
+  s->history_search_shown = cc->history_search_shown;
+#endif
+}
+
+static void restore_line(struct ConsoleConfig* cc, const struct SavedLine* s) {
+  memcpy(cc->line, s->line, sizeof(s->line));
+  cc->line_length = s->line_length;
+  cc->cursor_index = s->cursor_index;
+  memcpy(cc->arg, s->arg, sizeof(s->arg));
+  cc->tokenizer = s->tokenizer;
+#if CONSOLE_INCREMENTAL_TOKENIZER
+  memcpy(cc->tokens, s->tokens, sizeof(s->tokens));
+#endif
+  cc->prompt_displayed = s->prompt_displayed;
+  cc->tab_count = s->tab_count;
+#if CONSOLE_BINARY_MODE
+  cc->binary_state = s->binary_state;
+  cc->binary_args = s->binary_args;
+#endif
+#if CONSOLE_HISTORY_LINES > 0
+  cc->history_marker_index = s->history_marker_index;
+  cc->history_search = s->history_search;
+  cc->history_search_shown = s->history_search_shown;
+#endif
+}
+
+// Nonzero when called from a callback that is running on the other core.
+// That core must not touch cc->line or add to the command queue.
+static uint8_t called_remotely(const struct ConsoleConfig* cc) {
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  return cc->remote_dispatch &&
+    __atomic_load_n(&cc->running_commands, __ATOMIC_ACQUIRE);
+#else
+  return 0;
+#endif
+}
+
+// Runs the first length characters of line
+static uint8_t exec_line(
+    struct ConsoleConfig* cc, const char* line, size_t length) {
+  if (length > CONSOLE_MAX_LINE_CHARS) {
+    console_printf(
+        cc, "Line too long (>%d characters)\n", CONSOLE_MAX_LINE_CHARS);
+    return CONSOLE_EXEC_TOO_LONG;
+  }
+  struct SavedLine saved;
+  save_line(cc, &saved);
+  memcpy(cc->line, line, length);
+  cc->line[length] = '\0';
+  cc->line_length = length;
+  cc->cursor_index = length;
+#if CONSOLE_BINARY_MODE
+  cc->binary_args = 0;  // the arguments are text, even in CONSOLE_BINARY mode
+#endif
+  tokenize_reset(cc);
+  const uint8_t result = parse_line_dispatch(cc);
+  restore_line(cc, &saved);
+  return result;
+}
+
+uint8_t uart_console_exec(struct ConsoleConfig* cc, const char* line) {
+  if (called_remotely(cc)) {
+    return CONSOLE_EXEC_REMOTE;
+  }
+  const uint8_t result = exec_line(cc, line, strlen(line));
+  console_flush(cc);
+  return result;
+}
+
+uint16_t uart_console_run_script(struct ConsoleConfig* cc, const char* script) {
+  if (called_remotely(cc)) {
+    return 1;
+  }
+  uint16_t line_number = 0;
+  while (*script) {
+    ++line_number;
+    const char* end = strchr(script, '\n');
+    const char* next = end ? end + 1 : script + strlen(script);
+    if (!end) {
+      end = next;
+    }
+    if ((end > script) && (end[-1] == '\r')) {
+      --end;
+    }
+    const char* first = script;
+    while ((first < end) && (*first == ' ')) {
+      ++first;
+    }
+    if ((first < end) && (*first != '#')) {
+      const uint8_t result = exec_line(cc, script, end - script);
+      if (result != CONSOLE_EXEC_OK) {
+        console_printf(cc, "Script stopped at line %d\n", line_number);
+        console_flush(cc);
+        return line_number;
+      }
+    }
+    script = next;
+  }
+  console_flush(cc);
+  return 0;
+}
@@ -1,9 +1,134 @@
 // Handles logic for command history
+//
+// Entries are packed into cc->history, a circular byte arena, as
+//   length, characters, length
+// where length is one byte, or two (low byte first) when lines can be over
+// 255 characters.  The leading length steps forward to the next entry and
+// the trailing one steps back to the previous entry, so both arrow keys
+// are O(1).  When a new entry does not fit, the oldest ones are dropped.
 #include "command_history.h"
+#include "tokenize.h"
 #include "vt102_util.h"
 #include <string.h>
 
 #if CONSOLE_HISTORY_LINES > 0
+#if CONSOLE_MAX_LINE_CHARS > 255
+  #define LENGTH_BYTES 2
+#else
+  #define LENGTH_BYTES 1
+#endif
+#define ENTRY_OVERHEAD (2 * LENGTH_BYTES)
+
+_Static_assert(
+    CONSOLE_HISTORY_BYTES >= (CONSOLE_MAX_LINE_CHARS + ENTRY_OVERHEAD),
+    "CONSOLE_HISTORY_BYTES must fit at least one full line");
+_Static_assert(
+    CONSOLE_HISTORY_BYTES <= 32768,
+    "CONSOLE_HISTORY_BYTES must fit uint16_t arithmetic");
+
+// position + offset within the arena, where position + offset can be up to
+// twice the arena size
+static inline uint16_t wrap(uint32_t position) {
+  return (position >= CONSOLE_HISTORY_BYTES) ?
+    position - CONSOLE_HISTORY_BYTES : position;
+}
+
+static inline uint16_t wrap_back(uint16_t position, uint16_t offset) {
+  return wrap((uint32_t)position + CONSOLE_HISTORY_BYTES - offset);
+}
+
+static uint16_t read_length(const struct ConsoleConfig* cc, uint16_t pos) {
+  uint16_t length = (uint8_t)cc->history[pos];
+#if LENGTH_BYTES > 1
+  length |= (uint16_t)(uint8_t)cc->history[wrap(pos + 1)] << 8;
+#endif
+  return length;
+}
+
+static void write_length(
+    struct ConsoleConfig* cc, uint16_t pos, uint16_t length) {
+  cc->history[pos] = length & 0xFF;
+#if LENGTH_BYTES > 1
+  cc->history[wrap(pos + 1)] = length >> 8;
+#endif
+}
+
+// Copies out of the arena, which may wrap around at the end
+static void copy_out(
+    const struct ConsoleConfig* cc, uint16_t pos, char* dest, uint16_t n) {
+  const uint16_t first = CONSOLE_HISTORY_BYTES - pos;
+  if (n <= first) {
+    memcpy(dest, cc->history + pos, n);
+  } else {
+    memcpy(dest, cc->history + pos, first);
+    memcpy(dest + first, cc->history, n - first);
+  }
+}
+
+static void copy_in(
+    struct ConsoleConfig* cc, uint16_t pos, const char* src, uint16_t n) {
+  const uint16_t first = CONSOLE_HISTORY_BYTES - pos;
+  if (n <= first) {
+    memcpy(cc->history + pos, src, n);
+  } else {
+    memcpy(cc->history + pos, src, first);
+    memcpy(cc->history, src + first, n - first);
+  }
+}
+
+// start of the entry that ends at end
+static uint16_t entry_before(const struct ConsoleConfig* cc, uint16_t end) {
+  const uint16_t length = read_length(cc, wrap_back(end, LENGTH_BYTES));
+  return wrap_back(end, length + ENTRY_OVERHEAD);
+}
+
+// start of the entry after the one that starts at start
+static uint16_t entry_after(const struct ConsoleConfig* cc, uint16_t start) {
+  return wrap((uint32_t)start + read_length(cc, start) + ENTRY_OVERHEAD);
+}
+
+// Compares n characters of the arena at pos with s
+static uint8_t text_equals(
+    const struct ConsoleConfig* cc, uint16_t pos, const char* s, uint16_t n) {
+  const uint16_t first = CONSOLE_HISTORY_BYTES - pos;
+  if (n <= first) {
+    return !memcmp(cc->history + pos, s, n);
+  }
+  return !memcmp(cc->history + pos, s, first) &&
+    !memcmp(cc->history, s + first, n - first);
+}
+
+// Returns the characters of the entry at start, which are copied into
+// scratch if they wrap around the end of the arena
+static const char* entry_text(
+    const struct ConsoleConfig* cc,
+    uint16_t start,
+    uint16_t length,
+    char* scratch) {
+  const uint16_t pos = wrap(start + LENGTH_BYTES);
+  if (length <= CONSOLE_HISTORY_BYTES - pos) {
+    return cc->history + pos;
+  }
+  copy_out(cc, pos, scratch, length);
+  return scratch;
+}
+
+static uint8_t newest_equals_line(const struct ConsoleConfig* cc) {
+  if (cc->history_count == 0) {
+    return 0;
+  }
+  const uint16_t start = entry_before(cc, cc->history_tail);
+  return (read_length(cc, start) == cc->line_length) &&
+    text_equals(cc, wrap(start + LENGTH_BYTES), cc->line, cc->line_length);
+}
+
+static void drop_oldest(struct ConsoleConfig* cc) {
+  const uint16_t next = entry_after(cc, cc->history_head);
+  cc->history_used -= read_length(cc, cc->history_head) + ENTRY_OVERHEAD;
+  cc->history_head = next;
+  --cc->history_count;
+}
+
 uint8_t maybe_push_line_to_history(struct ConsoleConfig* cc) {
   // first make sure the line is not empty
   uint8_t is_empty = 1;
@@ -18,44 +143,121 @@ uint8_t maybe_push_line_to_history(struct ConsoleConfig* cc) {
     return 0;
   }
 
-  const char* last_entry =
-      cc->history + (cc->history_tail_index * (CONSOLE_MAX_LINE_CHARS + 1));
-  if (!strcmp(cc->line, last_entry)) {
+  if (newest_equals_line(cc)) {
     // repeated command
     return 0;
   }
 
-  cc->history_tail_index = (cc->history_tail_index + 1) % CONSOLE_HISTORY_LINES;
-  char* new_entry =
-      cc->history + (cc->history_tail_index * (CONSOLE_MAX_LINE_CHARS + 1));
-  memcpy(new_entry, cc->line, cc->line_length);
-  new_entry[cc->line_length] = '\0';
+  const uint16_t size = cc->line_length + ENTRY_OVERHEAD;
+  while ((CONSOLE_HISTORY_BYTES - cc->history_used) < size) {
+    drop_oldest(cc);
+  }
+  uint16_t pos = cc->history_tail;
+  write_length(cc, pos, cc->line_length);
+  pos = wrap(pos + LENGTH_BYTES);
+  copy_in(cc, pos, cc->line, cc->line_length);
+  pos = wrap(pos + cc->line_length);
+  write_length(cc, pos, cc->line_length);
+  cc->history_tail = wrap(pos + LENGTH_BYTES);
+  cc->history_used += size;
+  ++cc->history_count;
+  return 1;
+}
+
+// true if the entry at start begins with the first
+// cc->history_prefix_length characters of the line
+static uint8_t starts_with_prefix(
+    const struct ConsoleConfig* cc, uint16_t start) {
+  return (read_length(cc, start) >= cc->history_prefix_length) &&
+    text_equals(
+        cc,
+        wrap(start + LENGTH_BYTES),
+        cc->line,
+        cc->history_prefix_length);
+}
+
+// true if the entry at start contains the ctrl-r query
+static uint8_t contains_query(const struct ConsoleConfig* cc, uint16_t start) {
+  const uint16_t length = read_length(cc, start);
+  const uint8_t n = cc->history_query_length;
+  if ((n == 0) || (n > length)) {
+    return 0;
+  }
+  char scratch[CONSOLE_MAX_LINE_CHARS];
+  const char* text = entry_text(cc, start, length, scratch);
+  const char* end = text + length - n + 1;
+  for (const char* p = text;
+       (p = memchr(p, cc->history_query[0], end - p)) != NULL;
+       ++p) {
+    if (!memcmp(p, cc->history_query, n)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Walks from the entry at start (which is index entries back) towards the
+// oldest, looking for one that matches.  On success, the match becomes
+// cc->history_marker.  Nothing is drawn so that only the final match costs
+// any output.
+static uint8_t find_older(
+    struct ConsoleConfig* cc,
+    uint16_t start,
+    int16_t index,
+    uint8_t (*matches)(const struct ConsoleConfig*, uint16_t)) {
+  while (!matches(cc, start)) {
+    if (start == cc->history_head) {
+      return 0;
+    }
+    start = entry_before(cc, start);
+    ++index;
+  }
+  cc->history_marker = start;
+  cc->history_marker_index = index;
   return 1;
 }
 
+// Replaces the line being edited with the entry that starts at start
+static void show_entry(struct ConsoleConfig* cc, uint16_t start) {
+  cc->history_marker = start;
+  const uint16_t length = read_length(cc, start);
+  char scratch[CONSOLE_MAX_LINE_CHARS];
+  vt102_replace_current_line(
+      cc, entry_text(cc, start, length, scratch), length);
+}
+
 void vt102_history_previous(struct ConsoleConfig* cc) {
-  if (cc->history_marker_index >= (CONSOLE_HISTORY_LINES - 1)) {
-    // history is exhausted
+  if (cc->history_marker_index >= 0) {
+    if ((cc->history_marker != cc->history_head) &&
+        find_older(
+            cc,
+            entry_before(cc, cc->history_marker),
+            cc->history_marker_index + 1,
+            starts_with_prefix)) {
+      show_entry(cc, cc->history_marker);
+    }
     return;
   }
-  ++cc->history_marker_index;
-  const uint16_t slot =
-      (cc->history_tail_index + 
-       CONSOLE_HISTORY_LINES - 
-       cc->history_marker_index) % CONSOLE_HISTORY_LINES;
-  const char* entry = cc->history + (slot * (CONSOLE_MAX_LINE_CHARS + 1));
-  if (!entry[0]) {
-    // this slot has no data
-    --cc->history_marker_index;
+
+  // Save the line being edited so that down arrow can come back to it
+  maybe_push_line_to_history(cc);
+  if (cc->history_count == 0) {
     return;
   }
-
-  if (cc->history_marker_index == 0) {
-    if (maybe_push_line_to_history(cc)) {
-      cc->history_marker_index = 1;
+  cc->history_prefix_length = cc->cursor_index;
+  uint16_t start = entry_before(cc, cc->history_tail);
+  int16_t index = 0;
+  if (newest_equals_line(cc)) {
+    // no need to recall what is already shown
+    if (start == cc->history_head) {
+      return;
     }
+    start = entry_before(cc, start);
+    index = 1;
+  }
+  if (find_older(cc, start, index, starts_with_prefix)) {
+    show_entry(cc, cc->history_marker);
   }
-  vt102_replace_current_line(cc, entry);
 }
 
 void vt102_history_next(struct ConsoleConfig* cc) {
@@ -64,16 +266,128 @@ void vt102_history_next(struct ConsoleConfig* cc) {
     return;
   }
 
-  --cc->history_marker_index;
-  if (cc->history_marker_index == -1) {
-    vt102_erase_current_line(cc);
-    return;
+  uint16_t start = cc->history_marker;
+  for (int16_t index = cc->history_marker_index - 1; index >= 0; --index) {
+    start = entry_after(cc, start);
+    if (starts_with_prefix(cc, start)) {
+      cc->history_marker_index = index;
+      show_entry(cc, start);
+      return;
+    }
+  }
+  cc->history_marker_index = -1;
+  vt102_erase_current_line(cc);
+}
+
+#define SEARCH_LABEL "(reverse-i-search)`"
+#define SEARCH_SEPARATOR "': "
+
+// Replaces whatever the search is showing with the query and line
+static void search_redraw(struct ConsoleConfig* cc) {
+  const uint16_t shown = cc->history_search_shown;
+  if (shown) {
+    vt102_escape_sequence(cc, shown, 'D');  // cursor left
+    vt102_escape_sequence(cc, shown, 'P');  // delete character
+  }
+  vt102_write(cc, SEARCH_LABEL, sizeof(SEARCH_LABEL) - 1);
+  vt102_write(cc, cc->history_query, cc->history_query_length);
+  vt102_write(cc, SEARCH_SEPARATOR, sizeof(SEARCH_SEPARATOR) - 1);
+  vt102_write(cc, cc->line, cc->line_length);
+  cc->history_search_shown =
+    sizeof(SEARCH_LABEL) - 1 + cc->history_query_length +
+    sizeof(SEARCH_SEPARATOR) - 1 + cc->line_length;
+}
+
+// Copies the match into the line without drawing it
+static void search_take_match(struct ConsoleConfig* cc) {
+  const uint16_t length = read_length(cc, cc->history_marker);
+  tokenize_line_changed(cc, 0);
+  copy_out(cc, wrap(cc->history_marker + LENGTH_BYTES), cc->line, length);
+  cc->line[length] = '\0';
+  cc->line_length = length;
+  cc->cursor_index = length;
+}
+
+void vt102_history_search_start(struct ConsoleConfig* cc) {
+  vt102_end_of_line(cc);
+  cc->history_search = 1;
+  cc->history_query_length = 0;
+  cc->history_search_shown = cc->line_length;
+  cc->history_marker_index = -1;
+  cc->history_prefix_length = 0;
+  search_redraw(cc);
+}
+
+uint8_t vt102_history_search(struct ConsoleConfig* cc, char c) {
+  // DEL is above the printable range so it has to be checked first
+  if ((c == 0x08) || (c == 0x7f)) {
+    if (cc->history_query_length == 0) {
+      return 1;
+    }
+    --cc->history_query_length;
+    // the newest match for a shorter query can be newer than the current one
+    cc->history_marker_index = -1;
+    if (cc->history_query_length > 0) {
+      find_older(cc, entry_before(cc, cc->history_tail), 0, contains_query);
+    }
+  } else if ((uint8_t)c >= 32) {
+    if (cc->history_query_length >= CONSOLE_HISTORY_QUERY_CHARS) {
+      return 1;
+    }
+    cc->history_query[cc->history_query_length++] = c;
+    // a longer query can only match the current match or older ones
+    const uint8_t found = (cc->history_marker_index >= 0) ?
+      find_older(
+          cc, cc->history_marker, cc->history_marker_index, contains_query) :
+      ((cc->history_count > 0) &&
+       find_older(
+           cc, entry_before(cc, cc->history_tail), 0, contains_query));
+    if (!found) {
+      --cc->history_query_length;
+      vt102_write(cc, "\a", 1);  // bell
+      return 1;
+    }
+  } else if (c == 0x12) {
+    if ((cc->history_marker_index < 0) ||
+        (cc->history_marker == cc->history_head) ||
+        !find_older(
+            cc,
+            entry_before(cc, cc->history_marker),
+            cc->history_marker_index + 1,
+            contains_query)) {
+      vt102_write(cc, "\a", 1);  // bell
+      return 1;
+    }
+  } else {
+    // done, show the line as it will be edited
+    const uint16_t shown = cc->history_search_shown;
+    vt102_escape_sequence(cc, shown, 'D');  // cursor left
+    vt102_escape_sequence(cc, shown, 'P');  // delete character
+    vt102_write(cc, cc->line, cc->line_length);
+    cc->history_search = 0;
+    cc->history_search_shown = 0;
+    return 0;
+  }
+
+  if (cc->history_marker_index >= 0) {
+    search_take_match(cc);
+  }
+  search_redraw(cc);
+  return 1;
+}
+
+int16_t uart_console_history(
+    const struct ConsoleConfig* cc, uint16_t back, char* line) {
+  if (back >= cc->history_count) {
+    return -1;
+  }
+  uint16_t start = entry_before(cc, cc->history_tail);
+  for (; back > 0; --back) {
+    start = entry_before(cc, start);
   }
-  const uint16_t slot =
-      (cc->history_tail_index +
-       CONSOLE_HISTORY_LINES -
-       cc->history_marker_index) % CONSOLE_HISTORY_LINES;
-  const char* entry = cc->history + (slot * (CONSOLE_MAX_LINE_CHARS + 1));
-  vt102_replace_current_line(cc, entry);
+  const uint16_t length = read_length(cc, start);
+  copy_out(cc, wrap(start + LENGTH_BYTES), line, length);
+  line[length] = '\0';
+  return length;
 }
 #endif
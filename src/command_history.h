@@ -6,9 +6,21 @@
 // to the last-entered line.
 uint8_t maybe_push_line_to_history(struct ConsoleConfig* cc);
 
-// looks at previous history (up arrow)
+// looks at previous history (up arrow).  Only entries that start with the
+// characters before the cursor are recalled.
 void vt102_history_previous(struct ConsoleConfig* cc);
 
-// looks and next history (down arrow)
+// looks and next history (down arrow), with the same filter as
+// vt102_history_previous()
 void vt102_history_next(struct ConsoleConfig* cc);
+
+// Starts an incremental reverse search (ctrl-r)
+void vt102_history_search_start(struct ConsoleConfig* cc);
+
+// Handles a character while cc->history_search is set.  Printable
+// characters extend the query, backspace shortens it and ctrl-r looks for an
+// older match.  Anything else ends the search, leaving the match in the line,
+// and returns 0 so that the character is processed normally.  Returns 1 if
+// the character was consumed.
+uint8_t vt102_history_search(struct ConsoleConfig* cc, char c);
 #endif
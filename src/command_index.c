@@ -0,0 +1,165 @@
+// Sorted command lookup index
+#include "command_index.h"
+#include <string.h>
+
+static const struct ConsoleCallback* linear_find(
+    const struct ConsoleConfig* cc, const char* command) {
+  for (uint16_t i=0; i < cc->callback_count; ++i) {
+    const struct ConsoleCallback* cb = cc->callbacks + i;
+    if (!strcmp(command, cb->command)) {
+      return cb;
+    }
+  }
+  return NULL;
+}
+
+static void linear_for_each_prefix(
+    struct ConsoleConfig* cc,
+    const char* prefix,
+    uint16_t length,
+    void (*visit)(struct ConsoleConfig* cc, const char* command, void* ctx),
+    void* ctx) {
+  for (uint16_t i=0; i < cc->callback_count; ++i) {
+    const char* command = cc->callbacks[i].command;
+    if (!strncmp(command, prefix, length)) {
+      visit(cc, command, ctx);
+    }
+  }
+}
+
+#if CONSOLE_COMMAND_INDEX_SIZE > 0
+// name of the callback at sorted position i
+static inline const char* indexed_command(
+    const struct ConsoleConfig* cc, uint16_t i) {
+  return cc->callbacks[cc->command_index[i]].command;
+}
+
+void command_index_build(struct ConsoleConfig* cc) {
+  cc->command_index_count = 0;
+  if (cc->callback_count > CONSOLE_COMMAND_INDEX_SIZE) {
+    return;
+  }
+  // Binary insertion sort.  This is done once, so avoiding a larger and
+  // more complex sort is worth it, but registered tables (see
+  // CONSOLE_COMMAND) can be big enough that the comparisons matter.
+  // Inserting after equal entries keeps duplicates in table order.
+  for (uint16_t i=0; i < cc->callback_count; ++i) {
+    const char* command = cc->callbacks[i].command;
+    uint16_t low = 0;
+    uint16_t high = i;
+    while (low < high) {
+      const uint16_t mid = low + (high - low) / 2;
+      if (strcmp(indexed_command(cc, mid), command) <= 0) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    memmove(
+        cc->command_index + low + 1,
+        cc->command_index + low,
+        (i - low) * sizeof(cc->command_index[0]));
+    cc->command_index[low] = i;
+  }
+  cc->command_index_count = cc->callback_count;
+}
+
+const struct ConsoleCallback* command_index_find(
+    const struct ConsoleConfig* cc, const char* command) {
+  if (cc->command_index_count != cc->callback_count) {
+    // index was not built
+    return linear_find(cc, command);
+  }
+  // lower bound search so that the first duplicate is found
+  uint16_t low = 0;
+  uint16_t high = cc->command_index_count;
+  while (low < high) {
+    const uint16_t mid = low + (high - low) / 2;
+    if (strcmp(indexed_command(cc, mid), command) < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if ((low < cc->command_index_count) &&
+      !strcmp(indexed_command(cc, low), command)) {
+    return cc->callbacks + cc->command_index[low];
+  }
+  return NULL;
+}
+
+void command_index_for_each_prefix(
+    struct ConsoleConfig* cc,
+    const char* prefix,
+    uint16_t length,
+    void (*visit)(struct ConsoleConfig* cc, const char* command, void* ctx),
+    void* ctx) {
+  if (cc->command_index_count != cc->callback_count) {
+    // index was not built
+    linear_for_each_prefix(cc, prefix, length, visit, ctx);
+    return;
+  }
+  // all commands that start with prefix are adjacent in the index so
+  // find the first and walk forward from there.
+  uint16_t low = 0;
+  uint16_t high = cc->command_index_count;
+  while (low < high) {
+    const uint16_t mid = low + (high - low) / 2;
+    if (strncmp(indexed_command(cc, mid), prefix, length) < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  for (; low < cc->command_index_count; ++low) {
+    const char* command = indexed_command(cc, low);
+    if (strncmp(command, prefix, length)) {
+      break;
+    }
+    visit(cc, command, ctx);
+  }
+}
+#else
+void command_index_build(struct ConsoleConfig* cc) {
+}
+
+void command_index_for_each_prefix(
+    struct ConsoleConfig* cc,
+    const char* prefix,
+    uint16_t length,
+    void (*visit)(struct ConsoleConfig* cc, const char* command, void* ctx),
+    void* ctx) {
+  linear_for_each_prefix(cc, prefix, length, visit, ctx);
+}
+
+const struct ConsoleCallback* command_index_find(
+    const struct ConsoleConfig* cc, const char* command) {
+  return linear_find(cc, command);
+}
+#endif
+
+const struct ConsoleCallback* command_index_find_subcommand(
+    const struct ConsoleCallback* group, const char* command, uint16_t length) {
+  for (uint16_t i=0; i < group->subcommand_count; ++i) {
+    const struct ConsoleCallback* cb = group->subcommands + i;
+    if (!strncmp(command, cb->command, length) && !cb->command[length]) {
+      return cb;
+    }
+  }
+  return NULL;
+}
+
+void command_index_for_each_subcommand(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* group,
+    const char* prefix,
+    uint16_t length,
+    void (*visit)(struct ConsoleConfig* cc, const char* command, void* ctx),
+    void* ctx) {
+  for (uint16_t i=0; i < group->subcommand_count; ++i) {
+    const char* command = group->subcommands[i].command;
+    if (!strncmp(command, prefix, length)) {
+      visit(cc, command, ctx);
+    }
+  }
+}
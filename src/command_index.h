@@ -0,0 +1,44 @@
+#ifndef UART_CONSOLE_COMMAND_INDEX_H
+#define UART_CONSOLE_COMMAND_INDEX_H
+#include "uart_console/console.h"
+
+// Builds cc->command_index, a list of callback indexes sorted by command name,
+// so that lookups can use a binary search.  The sort is stable so that,
+// like the linear search, the first of any duplicate names wins.
+//
+// Does nothing if CONSOLE_COMMAND_INDEX_SIZE is zero or if
+// cc->callback_count is larger than CONSOLE_COMMAND_INDEX_SIZE.
+void command_index_build(struct ConsoleConfig* cc);
+
+// Calls visit() for each command that starts with the first length
+// characters of prefix.  When the index is available, the matching range
+// is found with a binary search and commands are visited in sorted order.
+void command_index_for_each_prefix(
+  struct ConsoleConfig* cc,
+  const char* prefix,
+  uint16_t length,
+  void (*visit)(struct ConsoleConfig* cc, const char* command, void* ctx),
+  void* ctx);
+
+// Returns the callback that matches command or NULL if there is none.
+// Uses the index when available, otherwise searches linearly.
+const struct ConsoleCallback* command_index_find(
+  const struct ConsoleConfig* cc, const char* command);
+
+// Returns the subcommand of group named by the first length characters of
+// command, or NULL if there is none.  Each level of a command tree is
+// searched linearly, so the cost depends on the path and not on the total
+// number of commands.
+const struct ConsoleCallback* command_index_find_subcommand(
+  const struct ConsoleCallback* group, const char* command, uint16_t length);
+
+// Calls visit() for each subcommand of group that starts with the first
+// length characters of prefix, in table order
+void command_index_for_each_subcommand(
+  struct ConsoleConfig* cc,
+  const struct ConsoleCallback* group,
+  const char* prefix,
+  uint16_t length,
+  void (*visit)(struct ConsoleConfig* cc, const char* command, void* ctx),
+  void* ctx);
+#endif
@@ -0,0 +1,122 @@
+// Handles the queue of parsed commands
+#include "command_queue.h"
+#include "command_task.h"
+#include "tokenize.h"
+#include "util.h"
+#include <string.h>
+
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+_Static_assert(
+  (CONSOLE_COMMAND_QUEUE_SLOTS & (CONSOLE_COMMAND_QUEUE_SLOTS - 1)) == 0,
+  "CONSOLE_COMMAND_QUEUE_SLOTS must be a power of two");
+_Static_assert(
+  CONSOLE_COMMAND_QUEUE_SLOTS <= 128,
+  "CONSOLE_COMMAND_QUEUE_SLOTS must be 128 or less");
+
+#define SLOT_MASK (CONSOLE_COMMAND_QUEUE_SLOTS - 1)
+
+uint8_t command_queue_push(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* cb,
+    uint8_t argc,
+    char* argv[]) {
+  struct ConsoleCommandQueue* q = &cc->commands;
+  const uint8_t head = q->head;
+  const uint8_t depth =
+    head - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+  if (depth >= CONSOLE_COMMAND_QUEUE_SLOTS) {
+    ++q->overflows;
+    return 0;
+  }
+
+  struct ConsoleCommand* cmd = q->slots + (head & SLOT_MASK);
+  cmd->callback = cb;
+  cmd->argc = argc;
+  const char* tokens = tokenize_output(cc);
+  for (uint8_t i=0; i<argc; ++i) {
+    cmd->arg_offset[i] = argv[i] - tokens;
+  }
+  memcpy(cmd->line, tokens, cc->tokenizer.write);
+
+  __atomic_store_n(&q->head, (uint8_t)(head + 1), __ATOMIC_RELEASE);
+  if (depth >= q->high_water) {
+    q->high_water = depth + 1;
+  }
+  if (cc->command_queued) {
+    cc->command_queued();
+  }
+  return 1;
+}
+
+uint8_t command_queue_dispatch(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* cb,
+    uint8_t argc,
+    char* argv[]) {
+  if (!command_queue_push(cc, cb, argc, argv)) {
+    console_printf(
+        cc,
+        "%s: Command queue full (%lu dropped)\n",
+        cb->command,
+        (unsigned long)cc->commands.overflows);
+    return 0;
+  }
+  // The line is safely in the queue.  Clearing it now means that a
+  // callback which calls uart_console_poll() starts with an empty line.
+  console_reset_line(cc);
+  if (!cc->remote_dispatch) {
+    uart_console_run_commands(cc);
+  }
+  return 1;
+}
+
+void uart_console_set_remote_dispatch(
+    struct ConsoleConfig* cc,
+    void (*command_queued)(void)) {
+  cc->command_queued = command_queued;
+  cc->remote_dispatch = 1;
+}
+
+uint8_t uart_console_run_commands(struct ConsoleConfig* cc) {
+  if (cc->running_commands) {
+    // called from a callback, the outer call will get to the rest
+    return 0;
+  }
+  cc->running_commands = 1;
+  struct ConsoleCommandQueue* q = &cc->commands;
+  uint8_t num_run = 0;
+  while (1) {
+    const uint8_t tail = q->tail;
+    if (__atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == tail) {
+      break;
+    }
+    struct ConsoleCommand* cmd = q->slots + (tail & SLOT_MASK);
+    char* argv[CONSOLE_MAX_ARGS];
+    for (uint8_t i=0; i<cmd->argc; ++i) {
+      argv[i] = cmd->line + cmd->arg_offset[i];
+    }
+    if (!cc->remote_dispatch) {
+      // the callback may produce output of its own.  With remote dispatch,
+      // the output state belongs to the other core.
+      console_flush(cc);
+    }
+    command_invoke(cc, cmd->callback, cmd->argc, argv, NULL);
+    // the slot is only released after the callback is done with argv
+    __atomic_store_n(&q->tail, (uint8_t)(tail + 1), __ATOMIC_RELEASE);
+    ++num_run;
+  }
+  cc->running_commands = 0;
+#if CONSOLE_MAX_TASKS > 0
+  if (cc->remote_dispatch) {
+    // resumable commands also belong to this core
+    uart_console_run_tasks(cc);
+  }
+#endif
+  return num_run;
+}
+
+uint8_t uart_console_command_queue_depth(const struct ConsoleConfig* cc) {
+  return __atomic_load_n(&cc->commands.head, __ATOMIC_ACQUIRE) -
+         __atomic_load_n(&cc->commands.tail, __ATOMIC_ACQUIRE);
+}
+#endif
@@ -0,0 +1,27 @@
+#ifndef UART_CONSOLE_COMMAND_QUEUE_H
+#define UART_CONSOLE_COMMAND_QUEUE_H
+// Queue of parsed commands (cc->commands) that allows callbacks to run on a
+// different core than the one that edits and parses lines.
+#include "uart_console/console.h"
+
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+// Copies a parsed cc->line (arguments separated by null characters with
+// cc->arg[] pointing into it) and the matching callback into the next free
+// slot.  argv points into cc->arg at the callback's first argument.
+// Returns 0 if the queue is full.
+uint8_t command_queue_push(
+  struct ConsoleConfig* cc,
+  const struct ConsoleCallback* cb,
+  uint8_t argc,
+  char* argv[]);
+
+// Queues a parsed command (see command_queue_push), reporting an error and
+// returning 0 if the queue is full.  Without remote dispatch, queued
+// commands are then run unless a callback is already running.
+uint8_t command_queue_dispatch(
+  struct ConsoleConfig* cc,
+  const struct ConsoleCallback* cb,
+  uint8_t argc,
+  char* argv[]);
+#endif
+#endif
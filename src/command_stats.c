@@ -0,0 +1,103 @@
+// Call counts and timings for commands
+#include "command_stats.h"
+#include "util.h"
+#include <string.h>
+
+#if CONSOLE_STATS > 0
+void command_stats_reset(struct ConsoleConfig* cc) {
+  uint64_t (*clock_us)(void) = cc->stats.clock_us;
+  memset(&cc->stats, 0, sizeof(cc->stats));
+  cc->stats.clock_us = clock_us;
+}
+
+// log2 bucket for a duration
+static uint8_t bucket(uint64_t us) {
+  uint8_t b = 0;
+  for (; us && (b < CONSOLE_STATS_BUCKETS - 1); us >>= 1) {
+    ++b;
+  }
+  return b;
+}
+
+void command_stats_record(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* cb,
+    uint64_t elapsed_us) {
+  // subcommands are not in cc->callbacks and are not tracked
+  if (((uintptr_t)cb < (uintptr_t)cc->callbacks) ||
+      ((uintptr_t)cb >= (uintptr_t)(cc->callbacks + cc->callback_count))) {
+    return;
+  }
+  const uint16_t index = cb - cc->callbacks;
+  if (index >= CONSOLE_STATS) {
+    return;
+  }
+  struct ConsoleCommandStats* s = cc->stats.commands + index;
+  const uint32_t us = (elapsed_us > 0xFFFFFFFF) ? 0xFFFFFFFF : elapsed_us;
+  if ((s->calls == 0) || (us < s->min_us)) {
+    s->min_us = us;
+  }
+  if (us > s->max_us) {
+    s->max_us = us;
+  }
+  ++s->calls;
+  s->total_us += elapsed_us;
+  uint16_t* count = s->histogram + bucket(elapsed_us);
+  if (*count < 0xFFFF) {
+    ++*count;
+  }
+}
+
+static void print_command(
+    struct ConsoleConfig* cc,
+    const char* command,
+    const struct ConsoleCommandStats* s) {
+  console_printf(
+      cc,
+      "%s: calls=%lu min=%luus mean=%luus max=%luus\n ",
+      command,
+      (unsigned long)s->calls,
+      (unsigned long)s->min_us,
+      (unsigned long)(s->total_us / s->calls),
+      (unsigned long)s->max_us);
+  // only the buckets that were used, labeled by their lower bound
+  for (uint8_t b=0; b<CONSOLE_STATS_BUCKETS; ++b) {
+    if (s->histogram[b]) {
+      console_printf(
+          cc,
+          " %lu%s:%u",
+          b ? (1UL << (b - 1)) : 0UL,
+          (b == CONSOLE_STATS_BUCKETS - 1) ? "+" : "",
+          s->histogram[b]);
+    }
+  }
+  console_printf(cc, "\n");
+}
+
+void command_stats_command(
+    struct ConsoleConfig* cc, uint8_t argc, char* argv[]) {
+  if ((argc == 1) && !strcmp(argv[0], "reset")) {
+    command_stats_reset(cc);
+    return;
+  }
+  if (argc > 0) {
+    console_printf(cc, "stats: Usage: stats [reset]\n");
+    ++cc->stats.parse_errors;
+    return;
+  }
+  console_printf(
+      cc,
+      "chars=%lu unknown=%lu errors=%lu\n",
+      (unsigned long)cc->stats.chars,
+      (unsigned long)cc->stats.unknown_commands,
+      (unsigned long)cc->stats.parse_errors);
+  const uint16_t count =
+    (cc->callback_count < CONSOLE_STATS) ? cc->callback_count : CONSOLE_STATS;
+  for (uint16_t i=0; i<count; ++i) {
+    const struct ConsoleCommandStats* s = cc->stats.commands + i;
+    if (s->calls) {
+      print_command(cc, cc->callbacks[i].command, s);
+    }
+  }
+}
+#endif
@@ -0,0 +1,21 @@
+#ifndef UART_CONSOLE_COMMAND_STATS_H
+#define UART_CONSOLE_COMMAND_STATS_H
+// Call counts and timings for commands (see CONSOLE_STATS)
+#include "uart_console/console.h"
+
+#if CONSOLE_STATS > 0
+// Clears everything but the clock
+void command_stats_reset(struct ConsoleConfig* cc);
+
+// Adds a call to cb that took elapsed_us.  Commands past the first
+// CONSOLE_STATS in the table are not recorded.
+void command_stats_record(
+  struct ConsoleConfig* cc,
+  const struct ConsoleCallback* cb,
+  uint64_t elapsed_us);
+
+// The built-in "stats" command.  "stats reset" clears the counts.
+void command_stats_command(
+  struct ConsoleConfig* cc, uint8_t argc, char* argv[]);
+#endif
+#endif
@@ -0,0 +1,132 @@
+// Handles resumable commands
+#include "command_task.h"
+#include "command_args.h"
+#include "command_stats.h"
+#include "util.h"
+#include <string.h>
+
+#if CONSOLE_MAX_TASKS > 0
+static void resume_task(struct ConsoleTask* task) {
+  const uint8_t status = task->callback->task(task);
+  ++task->calls;
+  if (status != CONSOLE_TASK_PENDING) {
+    task->callback = NULL;  // free the slot
+  }
+}
+
+static void start_task(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* cb,
+    uint8_t argc,
+    char* argv[]) {
+  struct ConsoleTask* task = NULL;
+  for (uint8_t i=0; i<CONSOLE_MAX_TASKS; ++i) {
+    if (!cc->tasks[i].callback) {
+      task = cc->tasks + i;
+      break;
+    }
+  }
+  if (!task) {
+    console_printf(
+        cc, "%s: Too many tasks (>%d)\n", cb->command, CONSOLE_MAX_TASKS);
+    return;
+  }
+
+  // The arguments came from a line of the same size so they will fit
+  uint16_t pos = 0;
+  for (uint8_t i=0; i<argc; ++i) {
+#if CONSOLE_BINARY_MODE
+    // arguments from a frame can contain zeros
+    const uint16_t length = uart_console_arg_length(cc, argv, i);
+#else
+    const uint16_t length = strlen(argv[i]);
+#endif
+    task->argv[i] = task->line + pos;
+    memcpy(task->line + pos, argv[i], length);
+    pos += length;
+    task->line[pos++] = '\0';
+  }
+  task->console = cc;
+  task->argc = argc;
+  task->calls = 0;
+  task->cancelled = 0;
+  memset(task->state, 0, sizeof(task->state));
+  task->callback = cb;
+  resume_task(task);
+}
+
+uint8_t uart_console_run_tasks(struct ConsoleConfig* cc) {
+  const uint8_t cancel = cc->cancel_tasks;
+  cc->cancel_tasks = 0;
+  uint8_t pending = 0;
+  for (uint8_t i=0; i<CONSOLE_MAX_TASKS; ++i) {
+    struct ConsoleTask* task = cc->tasks + i;
+    if (!task->callback) {
+      continue;
+    }
+    if (cancel) {
+      // one last call to allow cleanup
+      task->cancelled = 1;
+      task->callback->task(task);
+      task->callback = NULL;
+      continue;
+    }
+    resume_task(task);
+    if (task->callback) {
+      ++pending;
+    }
+  }
+  return pending;
+}
+#endif
+
+static void invoke(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* cb,
+    uint8_t argc,
+    char* argv[],
+    const union ConsoleValue* values) {
+  if (cb->callback) {
+    cb->callback(argc, argv);
+    return;
+  }
+  if (cb->handler) {
+    cb->handler(cc, argc, argv);
+    return;
+  }
+#if CONSOLE_MAX_TASKS > 0
+  if (cb->task) {
+    start_task(cc, cb, argc, argv);
+    return;
+  }
+#endif
+#if CONSOLE_TYPED_ARGS
+  if (cb->typed && cb->args) {
+    if (values) {
+      cb->typed(argc, values);
+      return;
+    }
+    // queued commands are converted again from their own copy of the line
+    union ConsoleValue converted[CONSOLE_MAX_ARGS];
+    uint8_t bad_arg;
+    if (args_convert(cb, argc, argv, converted, &bad_arg) == ARGS_OK) {
+      cb->typed(argc, converted);
+    }
+  }
+#endif
+}
+
+void command_invoke(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* cb,
+    uint8_t argc,
+    char* argv[],
+    const union ConsoleValue* values) {
+#if CONSOLE_STATS > 0
+  const uint64_t start = cc->stats.clock_us();
+  invoke(cc, cb, argc, argv, values);
+  command_stats_record(cc, cb, cc->stats.clock_us() - start);
+#else
+  invoke(cc, cb, argc, argv, values);
+#endif
+}
@@ -0,0 +1,17 @@
+#ifndef UART_CONSOLE_COMMAND_TASK_H
+#define UART_CONSOLE_COMMAND_TASK_H
+// Runs command callbacks, including resumable ones (ConsoleCallback.task)
+#include "uart_console/console.h"
+
+// Calls cb->callback.  If the command is resumable, the arguments are copied
+// into a free task slot and the first call is made from there.  An error is
+// printed if all CONSOLE_MAX_TASKS slots are in use.  Typed commands (see
+// ConsoleCallback.args) get values, or if that is NULL, argv converted
+// again.  Either way the caller must have already checked the arguments.
+void command_invoke(
+  struct ConsoleConfig* cc,
+  const struct ConsoleCallback* cb,
+  uint8_t argc,
+  char* argv[],
+  const union ConsoleValue* values);
+#endif
@@ -0,0 +1,371 @@
+// Compact printf style formatting
+#include "format.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Largest conversion: a 64 bit long in decimal with a sign, or %f
+#define FIELD_CHARS 32
+
+// A conversion specification, such as %-8s
+struct FormatSpec {
+  uint8_t left;  // '-' flag
+  uint8_t zero;  // '0' flag
+  uint8_t plus;  // '+' flag
+  uint8_t is_long;  // 'l' length modifier
+  // an unsupported length modifier: 'L', 'j', 'z', 't' or "ll"
+  char wide;
+  uint16_t width;
+  int16_t precision;  // -1 if not given
+};
+
+struct FormatOutput {
+  void (*write)(void* ctx, const char* data, uint16_t length);
+  void* ctx;
+};
+
+static void pad(const struct FormatOutput* out, char c, uint16_t count) {
+  static const char spaces[] = "                ";
+  static const char zeros[] = "0000000000000000";
+  const char* fill = (c == '0') ? zeros : spaces;
+  while (count > 0) {
+    const uint16_t n = (count < sizeof(spaces) - 1) ? count : sizeof(spaces) - 1;
+    out->write(out->ctx, fill, n);
+    count -= n;
+  }
+}
+
+// Writes a field with its padding.  sign (which can be empty) goes before
+// any zero padding.
+static void emit_field(
+    const struct FormatOutput* out,
+    const struct FormatSpec* spec,
+    const char* sign,
+    uint8_t sign_length,
+    const char* data,
+    uint16_t length) {
+  const uint16_t total = sign_length + length;
+  const uint16_t padding = (spec->width > total) ? spec->width - total : 0;
+  if (!spec->left && !spec->zero) {
+    pad(out, ' ', padding);
+  }
+  if (sign_length) {
+    out->write(out->ctx, sign, sign_length);
+  }
+  if (!spec->left && spec->zero) {
+    pad(out, '0', padding);
+  }
+  out->write(out->ctx, data, length);
+  if (spec->left) {
+    pad(out, ' ', padding);
+  }
+}
+
+// Writes n as digits ending just before end.  Returns the first digit.
+static char* format_digits(char* end, unsigned long n, uint8_t base, char a) {
+  do {
+    const uint8_t digit = (base == 16) ? (n & 0xF) : (n % 10);
+    *--end = (digit < 10) ? ('0' + digit) : (a + digit - 10);
+    n = (base == 16) ? (n >> 4) : (n / 10);
+  } while (n);
+  return end;
+}
+
+static void emit_number(
+    const struct FormatOutput* out,
+    const struct FormatSpec* spec,
+    unsigned long magnitude,
+    uint8_t negative,
+    uint8_t base,
+    char a) {
+  char buffer[FIELD_CHARS];
+  char* end = buffer + sizeof(buffer);
+  char* start = format_digits(end, magnitude, base, a);
+  const char* sign = negative ? "-" : (spec->plus ? "+" : "");
+  emit_field(out, spec, sign, strlen(sign), start, end - start);
+}
+
+#if CONSOLE_FORMAT_FLOAT
+// Writes n as decimal digits ending just before end, nine at a time so
+// that the digits only need 32 bit arithmetic.  Returns the first digit.
+static char* format_u64(char* end, uint64_t n) {
+  while (n >= 1000000000) {
+    char* piece = format_digits(end, (uint32_t)(n % 1000000000), 10, 'a');
+    while ((end - piece) < 9) {
+      *--piece = '0';
+    }
+    end = piece;
+    n /= 1000000000;
+  }
+  return format_digits(end, (unsigned long)n, 10, 'a');
+}
+
+static void emit_float(
+    const struct FormatOutput* out, const struct FormatSpec* spec, double v) {
+  const char* sign = "";
+  if (v < 0) {
+    sign = "-";
+    v = -v;
+  } else if (spec->plus) {
+    sign = "+";
+  }
+  if (v != v) {
+    emit_field(out, spec, "", 0, "nan", 3);
+    return;
+  }
+  if (v >= 18446744073709551616.0) {
+    // beyond the integer part that fits in 64 bits (see format.h)
+    emit_field(out, spec, sign, strlen(sign), "inf", 3);
+    return;
+  }
+  uint8_t precision = (spec->precision < 0) ? 6 : spec->precision;
+  if (precision > 9) {
+    precision = 9;
+  }
+  uint32_t scale = 1;
+  for (uint8_t i=0; i<precision; ++i) {
+    scale *= 10;
+  }
+  uint64_t whole = (uint64_t)v;
+  uint32_t fraction = (uint32_t)(((v - whole) * scale) + 0.5);
+  if (fraction >= scale) {
+    // rounded up into the integer part
+    ++whole;
+    fraction -= scale;
+  }
+
+  char buffer[FIELD_CHARS];
+  char* end = buffer + sizeof(buffer);
+  char* start = end;
+  if (precision > 0) {
+    start = format_digits(end, fraction, 10, 'a');
+    while ((end - start) < precision) {
+      *--start = '0';
+    }
+    *--start = '.';
+  }
+  start = format_u64(start, whole);
+  emit_field(out, spec, sign, strlen(sign), start, end - start);
+}
+#endif
+
+// Parses the specification after a '%'.  Returns a pointer to the
+// conversion character.
+static const char* parse_spec(
+    const char* fmt, struct FormatSpec* spec, va_list* args) {
+  memset(spec, 0, sizeof(*spec));
+  spec->precision = -1;
+  for (;; ++fmt) {
+    if (*fmt == '-') {
+      spec->left = 1;
+    } else if (*fmt == '0') {
+      spec->zero = 1;
+    } else if (*fmt == '+') {
+      spec->plus = 1;
+    } else {
+      break;
+    }
+  }
+  if (*fmt == '*') {
+    const int width = va_arg(*args, int);
+    if (width < 0) {
+      spec->left = 1;
+      spec->width = -width;
+    } else {
+      spec->width = width;
+    }
+    ++fmt;
+  }
+  for (; (*fmt >= '0') && (*fmt <= '9'); ++fmt) {
+    spec->width = (spec->width * 10) + (*fmt - '0');
+  }
+  if (*fmt == '.') {
+    ++fmt;
+    spec->precision = 0;
+    if (*fmt == '*') {
+      spec->precision = va_arg(*args, int);
+      ++fmt;
+    }
+    for (; (*fmt >= '0') && (*fmt <= '9'); ++fmt) {
+      spec->precision = (spec->precision * 10) + (*fmt - '0');
+    }
+  }
+  for (; *fmt == 'h'; ++fmt);
+  if (*fmt == 'l') {
+    spec->is_long = 1;
+    ++fmt;
+  }
+  if (spec->is_long ? (*fmt == 'l') : (strchr("Ljzt", *fmt) && *fmt)) {
+    spec->wide = *fmt++;
+  }
+  return fmt;
+}
+
+// Takes the argument of an unsupported conversion off args so that the
+// ones after it are still read from the right place.  Returns zero if the
+// conversion itself is unknown, so the size of its argument is too.
+static uint8_t skip_arg(
+    const struct FormatSpec* spec, char conversion, va_list* args) {
+  if (strchr("fFeEgGaA", conversion)) {
+    if (spec->wide == 'L') {
+      (void)va_arg(*args, long double);
+    } else {
+      (void)va_arg(*args, double);
+    }
+    return 1;
+  }
+  if ((conversion == 'p') || (conversion == 'n')) {
+    (void)va_arg(*args, void*);
+    return 1;
+  }
+  if (!strchr("diouxXc", conversion)) {
+    return 0;
+  }
+  switch (spec->wide) {
+    case 'l':  // "ll"
+      (void)va_arg(*args, long long);
+      break;
+    case 'j':
+      (void)va_arg(*args, intmax_t);
+      break;
+    case 'z':
+      (void)va_arg(*args, size_t);
+      break;
+    case 't':
+      (void)va_arg(*args, ptrdiff_t);
+      break;
+    default:
+      if (spec->is_long) {
+        (void)va_arg(*args, long);
+      } else {
+        (void)va_arg(*args, int);
+      }
+      break;
+  }
+  return 1;
+}
+
+void console_vformat(
+    void (*write)(void* ctx, const char* data, uint16_t length),
+    void* ctx,
+    const char* fmt,
+    va_list args) {
+  const struct FormatOutput out = {write, ctx};
+  va_list ap;
+  va_copy(ap, args);
+  while (*fmt) {
+    // literal text goes out directly from fmt
+    const char* percent = strchr(fmt, '%');
+    if (!percent) {
+      write(ctx, fmt, strlen(fmt));
+      break;
+    }
+    if (percent > fmt) {
+      write(ctx, fmt, percent - fmt);
+    }
+
+    struct FormatSpec spec;
+    const char* conversion = parse_spec(percent + 1, &spec, &ap);
+    // only the supported conversions without a wide length modifier
+    // reach the switch
+    const char c = (spec.wide && *conversion) ? 'w' : *conversion;
+    switch (c) {
+      case 'd':
+      case 'i': {
+        const long n = spec.is_long ? va_arg(ap, long) : va_arg(ap, int);
+        const unsigned long magnitude = (n < 0) ? -(unsigned long)n : n;
+        emit_number(&out, &spec, magnitude, n < 0, 10, 'a');
+        break;
+      }
+      case 'u':
+      case 'x':
+      case 'X': {
+        const unsigned long n =
+          spec.is_long ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+        spec.plus = 0;
+        emit_number(
+            &out, &spec, n,
+            0,
+            (*conversion == 'u') ? 10 : 16,
+            (*conversion == 'X') ? 'A' : 'a');
+        break;
+      }
+      case 'c': {
+        const char c = va_arg(ap, int);
+        spec.zero = 0;
+        emit_field(&out, &spec, "", 0, &c, 1);
+        break;
+      }
+      case 's': {
+        const char* s = va_arg(ap, const char*);
+        if (!s) {
+          s = "(null)";
+        }
+        uint16_t length;
+        if (spec.precision < 0) {
+          length = strlen(s);
+        } else {
+          const char* end = memchr(s, '\0', spec.precision);
+          length = end ? (uint16_t)(end - s) : spec.precision;
+        }
+        spec.zero = 0;
+        emit_field(&out, &spec, "", 0, s, length);
+        break;
+      }
+#if CONSOLE_FORMAT_FLOAT
+      case 'f':
+        emit_float(&out, &spec, va_arg(ap, double));
+        break;
+#endif
+      case '%':
+        write(ctx, "%", 1);
+        break;
+      case '\0':
+        // format ended in the middle of a specification
+        write(ctx, percent, conversion - percent);
+        va_end(ap);
+        return;
+      default:
+        // unsupported, copy it as is
+        if (!skip_arg(&spec, *conversion, &ap)) {
+          // the arguments can no longer be matched up with the rest
+          write(ctx, percent, strlen(percent));
+          va_end(ap);
+          return;
+        }
+        write(ctx, percent, conversion + 1 - percent);
+        break;
+    }
+    fmt = conversion + 1;
+  }
+  va_end(ap);
+}
+
+struct FormatBuffer {
+  char* data;
+  uint16_t size;
+  uint16_t length;
+};
+
+static void write_buffer(void* ctx, const char* data, uint16_t length) {
+  struct FormatBuffer* buffer = ctx;
+  const uint16_t space = buffer->size - 1 - buffer->length;
+  if (length > space) {
+    length = space;  // truncated
+  }
+  memcpy(buffer->data + buffer->length, data, length);
+  buffer->length += length;
+}
+
+uint16_t console_sformat(char* data, uint16_t size, const char* fmt, ...) {
+  if (size == 0) {
+    return 0;
+  }
+  struct FormatBuffer buffer = {data, size, 0};
+  va_list args;
+  va_start(args, fmt);
+  console_vformat(write_buffer, &buffer, fmt, args);
+  va_end(args);
+  data[buffer.length] = '\0';
+  return buffer.length;
+}
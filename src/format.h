@@ -0,0 +1,31 @@
+#ifndef UART_CONSOLE_FORMAT_H
+#define UART_CONSOLE_FORMAT_H
+// A compact printf style formatter that sends its output to a callback in
+// pieces (runs of literal text, each converted field and its padding)
+// instead of building the whole string in a buffer.  There is no length
+// limit and no static state, so it is safe to use from either core.
+//
+// Supported: %d %i %u %x %X %c %s %% with the flags '-', '0' and '+', a
+// field width, a precision for %s (maximum characters), the 'l' length
+// modifier and 'h'/'hh' (which are accepted and ignored).  %f is available
+// when CONSOLE_FORMAT_FLOAT is set, with two limits: a precision above 9 is
+// treated as 9, and values of 2^64 (about 1.8e19) or more print as "inf"
+// (or "-inf").  Other standard conversions, and those with the 'll', 'j',
+// 'z', 't' or 'L' length modifiers, are copied to the output as is and
+// their argument is skipped.  An unknown conversion letter is copied along
+// with the rest of the format, since its argument cannot be skipped.
+#include "uart_console/console.h"
+#include <stdarg.h>
+
+// Formats fmt, calling write(ctx, ...) with each piece of the output
+void console_vformat(
+  void (*write)(void* ctx, const char* data, uint16_t length),
+  void* ctx,
+  const char* fmt,
+  va_list args);
+
+// Formats into buffer, truncating to size - 1 characters.  Returns the
+// length of the string written.
+uint16_t console_sformat(char* buffer, uint16_t size, const char* fmt, ...)
+  __attribute__((format(printf, 3, 4)));
+#endif
@@ -0,0 +1,64 @@
+// Cache of split and matched lines
+#include "line_cache.h"
+#include "tokenize.h"
+#include <string.h>
+
+#if CONSOLE_LINE_CACHE > 0
+_Static_assert(
+  CONSOLE_LINE_CACHE <= 255, "CONSOLE_LINE_CACHE must be 255 or less");
+
+const struct ConsoleCallback* line_cache_find(
+    struct ConsoleConfig* cc, uint8_t* num_args, uint8_t* first) {
+  const uint16_t length = cc->line_length;
+  for (uint8_t i=0; i<CONSOLE_LINE_CACHE; ++i) {
+    const struct ConsoleLineCacheEntry* e = cc->line_cache + i;
+    if (!e->callback || (e->line_length != length) ||
+        memcmp(e->line, cc->line, length)) {
+      continue;
+    }
+    char* out = tokenize_output(cc);
+    memcpy(out, e->tokens, e->tokens_length);
+    for (uint8_t j=0; j<e->num_args; ++j) {
+      cc->arg[j] = out + e->arg_offset[j];
+    }
+    // as tokenize_finish() leaves it, queued commands copy tokenizer.write
+    tokenize_reset(cc);
+    cc->tokenizer.read = length;
+    cc->tokenizer.write = e->tokens_length;
+    cc->tokenizer.argc = e->num_args;
+    *num_args = e->num_args;
+    *first = e->first;
+    ++cc->line_cache_hits;
+    return e->callback;
+  }
+  ++cc->line_cache_misses;
+  return NULL;
+}
+
+void line_cache_start(struct ConsoleConfig* cc) {
+  cc->line_cache_key_length = cc->line_length;
+  memcpy(cc->line_cache_key, cc->line, cc->line_length);
+}
+
+void line_cache_store(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* cb,
+    uint8_t num_args,
+    uint8_t first) {
+  struct ConsoleLineCacheEntry* e = cc->line_cache + cc->line_cache_next;
+  const char* out = tokenize_output(cc);
+  e->line_length = cc->line_cache_key_length;
+  memcpy(e->line, cc->line_cache_key, e->line_length);
+  e->tokens_length = cc->tokenizer.write;
+  memcpy(e->tokens, out, e->tokens_length);
+  for (uint8_t i=0; i<num_args; ++i) {
+    e->arg_offset[i] = cc->arg[i] - out;
+  }
+  e->num_args = num_args;
+  e->first = first;
+  e->callback = cb;
+  if (++cc->line_cache_next >= CONSOLE_LINE_CACHE) {
+    cc->line_cache_next = 0;
+  }
+}
+#endif
@@ -0,0 +1,41 @@
+#ifndef UART_CONSOLE_LINE_CACHE_H
+#define UART_CONSOLE_LINE_CACHE_H
+// Remembers how recent lines were split and which command they matched
+// (see CONSOLE_LINE_CACHE) so that a repeated line goes straight to
+// checking its arguments.
+#include "uart_console/console.h"
+
+#if CONSOLE_LINE_CACHE > 0
+// Looks up cc->line.  On a hit, the split arguments are copied to where
+// tokenize_finish() would put them, cc->arg[] and cc->tokenizer are set as
+// it would set them, and the command is returned with *num_args and *first
+// (the index in cc->arg of its first argument).  Returns NULL on a miss.
+const struct ConsoleCallback* line_cache_find(
+  struct ConsoleConfig* cc, uint8_t* num_args, uint8_t* first);
+
+// Keeps a copy of cc->line to use as the key of a new entry.  Call on a
+// miss, before the line is split in place.  No entry is replaced yet, so
+// lines such as "help" or an unknown command leave the cache alone.
+void line_cache_start(struct ConsoleConfig* cc);
+
+// Replaces the next entry with the line kept by line_cache_start(), once
+// it has been split and matched to cb.  Must be called before cb runs
+// since the callback may run other lines.
+void line_cache_store(
+  struct ConsoleConfig* cc,
+  const struct ConsoleCallback* cb,
+  uint8_t num_args,
+  uint8_t first);
+#else
+static inline const struct ConsoleCallback* line_cache_find(
+    struct ConsoleConfig* cc, uint8_t* num_args, uint8_t* first) {
+  return NULL;
+}
+static inline void line_cache_start(struct ConsoleConfig* cc) {}
+static inline void line_cache_store(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* cb,
+    uint8_t num_args,
+    uint8_t first) {}
+#endif
+#endif
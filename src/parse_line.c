@@ -3,24 +3,109 @@
 // as well as invoking the callback function
 #include "parse_line.h"
 #include "util.h"
+#include "command_args.h"
 #include "command_history.h"
+#include "command_index.h"
+#include "command_queue.h"
+#include "command_stats.h"
+#include "command_task.h"
+#include "line_cache.h"
+#include "tokenize.h"
+#include "pico/stdlib.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-// Dumps command help to the screen
-static void dump_help(const struct ConsoleConfig* cc) {
-  for (uint8_t i=0; i < cc->callback_count; ++i) {
-    const struct ConsoleCallback* cb = cc->callbacks + i;
-    console_printf(cc, "%s: %s\n", cb->command, cb->description);
+// prints count words separated by spaces
+static void print_path(struct ConsoleConfig* cc, char* words[], uint8_t count) {
+  for (uint8_t i=0; i<count; ++i) {
+    console_printf(cc, i ? " %s" : "%s", words[i]);
   }
 }
 
+// Prints the help line for cb, which is under the groups named in path
+static void help_line(
+    struct ConsoleConfig* cc,
+    char* path[],
+    uint8_t depth,
+    const struct ConsoleCallback* cb) {
+  print_path(cc, path, depth);
+  console_printf(cc, depth ? " %s" : "%s", cb->command);
+  if (cb->subcommands) {
+    console_printf(cc, " ...");
+  }
+#if CONSOLE_TYPED_ARGS
+  else if (cb->args) {
+    args_print_usage(cc, cb);
+  }
+#endif
+  console_printf(cc, ": %s\n", cb->description);
+}
+
+// Dumps command help to the screen.  With arguments, only the named
+// command or the subcommands of the named group are shown.
+static void dump_help(struct ConsoleConfig* cc, uint8_t argc, char* argv[]) {
+  if (argc == 0) {
+    for (uint16_t i=0; i < cc->callback_count; ++i) {
+      help_line(cc, NULL, 0, cc->callbacks + i);
+    }
+#if CONSOLE_STATS > 0
+    console_printf(cc, "stats: Command call counts and timings\n");
+#endif
+#if CONSOLE_REPEAT
+    console_printf(cc, "repeat n command...: Runs a command n times\n");
+#endif
+    return;
+  }
+
+  const struct ConsoleCallback* cb = command_index_find(cc, argv[0]);
+  for (uint8_t i=1; cb && (i < argc); ++i) {
+    cb = cb->subcommands ?
+      command_index_find_subcommand(cb, argv[i], strlen(argv[i])) : NULL;
+  }
+  if (!cb) {
+    console_printf(cc, "help: Unknown command \"");
+    print_path(cc, argv, argc);
+    console_printf(cc, "\"\n");
+    return;
+  }
+  if (!cb->subcommands) {
+    help_line(cc, argv, argc - 1, cb);
+    return;
+  }
+  for (uint16_t i=0; i < cb->subcommand_count; ++i) {
+    help_line(cc, argv, argc, cb->subcommands + i);
+  }
+}
+
+// counts and rejects a command with bad arguments
+static uint8_t bad_args(struct ConsoleConfig* cc) {
+#if CONSOLE_STATS > 0
+  ++cc->stats.parse_errors;
+#endif
+  return 0;
+}
+
 // Makes sure the number of provided arguments is what the command
-// is expecting.
-static uint8_t check_arg_count(
-  const struct ConsoleConfig* cc,
+// is expecting.  When cb->args describes them, they are also converted
+// into values.
+static uint8_t check_args(
+  struct ConsoleConfig* cc,
   const struct ConsoleCallback* cb,
-  uint8_t argc) {
+  uint8_t argc,
+  char* argv[],
+  union ConsoleValue* values) {
+#if CONSOLE_TYPED_ARGS
+  if (cb->args) {
+    uint8_t bad_arg;
+    const uint8_t result = args_convert(cb, argc, argv, values, &bad_arg);
+    if (result != ARGS_OK) {
+      args_print_error(cc, cb, result, bad_arg, argv);
+      return bad_args(cc);
+    }
+    return 1;
+  }
+#endif
   if ((cb->num_args >= 0) && (cb->num_args != argc)) {
     if (cb->num_args == 0) {
       console_printf(cc, "%s: Unexpected argument(s)\n", cb->command);
@@ -29,154 +114,266 @@ static uint8_t check_arg_count(
     } else {
       console_printf(cc, "%s: Expected %d arguments\n", cb->command, cb->num_args);
     }
-    return 0;
+    return bad_args(cc);
   }
   return 1;
 }
 
-// Converts spaces in cc->line to null characters.
-// There is some additional complication that stems from supporting
-// quotes "" and backslash characters.
-static int convert_spaces_to_nulls(
-  const struct ConsoleConfig* cc,
-  char* line,
-  uint16_t line_length) {
-  int16_t quote_start = -1;
-  uint8_t backslash = 0;
-  uint8_t last_was_whitespace = 1;
-  for (uint16_t i=0; i<line_length; ++i) {
-    const char c = line[i];
-    if (backslash) {
-      last_was_whitespace = 0;
-      backslash = 0;
-    } else if (c == '\\') {
-      last_was_whitespace = 0;
-      backslash = 1;
-    } else if (quote_start >= 0) {
-      last_was_whitespace = 0;
-      if (c == '"') {
-        if ((i - quote_start) == 1) {
-          // special case empty string
-          line[i] = 0xFF;
-        } else {
-          line[i] = 0;
-        }
-        line[quote_start] = 0;
-        quote_start = -1;
-      }
-    } else if ((c == '"') && last_was_whitespace) {
-      line[i] = 0;
-      quote_start = i;
-      last_was_whitespace = 0;
-    } else if (c == ' ') {
-      last_was_whitespace = 1;
-      line[i] = 0;
-    } else {
-      last_was_whitespace = 0;
+// Follows subcommands from cb for as long as the next word names one.
+// *first is advanced to the index in words of the returned command's
+// first argument.
+static const struct ConsoleCallback* descend(
+    const struct ConsoleCallback* cb,
+    char* words[],
+    uint8_t num_words,
+    uint8_t* first) {
+  while (cb->subcommands && (*first < num_words)) {
+    const char* name = words[*first];
+    const struct ConsoleCallback* sub =
+      command_index_find_subcommand(cb, name, strlen(name));
+    if (!sub) {
+      break;
     }
+    cb = sub;
+    ++*first;
   }
+  return cb;
+}
 
-  if (quote_start >= 0) {
-    console_printf(cc, "Unclosed quote\n");
-    return 0;
+// Reports a group that was not given one of its subcommands and has no
+// handler of its own.  Returns zero in that case.
+static uint8_t check_group(
+    struct ConsoleConfig* cc,
+    const struct ConsoleCallback* cb,
+    char* words[],
+    uint8_t num_words,
+    uint8_t first) {
+  if (!cb->subcommands ||
+      cb->callback || cb->handler || cb->task || cb->typed) {
+    return 1;
   }
-  if (backslash) {
-    console_printf(cc, "Line ended with backslash\n");
-    return 0;
+  print_path(cc, words, first);
+  if (first < num_words) {
+    console_printf(cc, ": Unknown subcommand \"%s\"", words[first]);
+  } else {
+    console_printf(cc, ": Expected a subcommand");
   }
-  return 1;
+  console_printf(cc, ", try \"help ");
+  print_path(cc, words, first);
+  console_printf(cc, "\"\n");
+  return bad_args(cc);
 }
 
-
-// At this point, backslashes have protected special characters,
-// such as spaces and quotes, from being interpreted in their
-// usual way.  This post steps removes the backslashes from
-// the string.
-static uint16_t remove_backslashes(char* line, uint16_t line_length) {
-  uint16_t head = 0;
-  uint16_t tail = 0;
-  uint8_t just_removed = 0;
-  for (; head < line_length; ++head) {
-    if (just_removed || (line[head] != '\\')) {
-      line[tail] = line[head];
-      ++tail;
-      just_removed = 0;
-    } else {
-      just_removed = 1;
-    }
-  }
-  line[tail] = '\0';
-  return tail;
+// Clears cc->line once it has been dealt with and passes result on
+static uint8_t line_done(struct ConsoleConfig* cc, uint8_t result) {
+  console_reset_line(cc);
+  return result;
 }
 
-// Sets up cc->args by replacing whitespace
-// with nulls and setting appropriate args[] pointers
-// to point within cc->line.
-//
-// Returns the number of arguments found, including the
-// command itself (this zero represents an error condition).
-static int split_args(struct ConsoleConfig* cc) {
-  int num_args = 0;
-  if (!convert_spaces_to_nulls(cc, cc->line, cc->line_length)) {
-    return 0;
-  }
-  cc->line_length = remove_backslashes(cc->line, cc->line_length);
-  if (cc->line_length == 0) {
-    return 0;  // nothing to do
-  }
-
-  if (cc->line[0] != 0) {
-    cc->arg[0] = cc->line;
-    ++num_args;
-  }
-
-  for (uint16_t i=1; i<cc->line_length; ++i) {
-    if ((cc->line[i] != 0) && (cc->line[i-1] == 0)) {
-      if (num_args >= CONSOLE_MAX_ARGS) {
-        console_printf(cc, "Too many arguments (>%d)\n", CONSOLE_MAX_ARGS);
-        return 0;
-      }
-      cc->arg[num_args] = cc->line + i;
-      if (cc->arg[num_args][0] == 0xFF) {
-        // special case empty quoted string
-        cc->arg[num_args][0] = '\0';
-      }
-      ++num_args;
-    }
+#if CONSOLE_REPEAT
+// The built-in "repeat n command...".  The command is looked up and its
+// arguments checked once, then it is called n times in a row and the
+// fastest, mean and slowest call are reported.  Returns a CONSOLE_EXEC_*
+// status.
+static uint8_t repeat_command(
+    struct ConsoleConfig* cc, uint8_t argc, char* argv[]) {
+  // parsed as signed so that "-1" is refused rather than wrapped
+  char* end = NULL;
+  const long parsed = (argc >= 2) ? strtol(argv[0], &end, 0) : 0;
+  if ((parsed <= 0) || (parsed > CONSOLE_REPEAT_MAX) || (end && *end)) {
+    console_printf(
+        cc,
+        "repeat: Expected a count from 1 to %d and a command\n",
+        CONSOLE_REPEAT_MAX);
+    bad_args(cc);
+    return line_done(cc, CONSOLE_EXEC_BAD_ARGS);
   }
-  
-  return num_args;  // ok
-}
+  const unsigned long count = parsed;
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  if (cc->remote_dispatch) {
+    console_printf(cc, "repeat: Not available with remote dispatch\n");
+    return line_done(cc, CONSOLE_EXEC_UNSUPPORTED);
+  }
+#endif
+  // The words are copied off the line so that the callback may change
+  // them or call uart_console_poll().  Each call gets a fresh copy.
+  const char* tokens = tokenize_output(cc);
+  const uint16_t length = cc->tokenizer.write;
+  char saved[CONSOLE_MAX_LINE_CHARS + 1];
+  char copy[CONSOLE_MAX_LINE_CHARS + 1];
+  char* words[CONSOLE_MAX_ARGS];
+  const uint8_t num_words = argc - 1;
+  memcpy(saved, tokens, length);
+  for (uint8_t i=0; i<num_words; ++i) {
+    words[i] = copy + (argv[i + 1] - tokens);
+  }
+  memcpy(copy, saved, length);
+  console_reset_line(cc);
 
-void uart_console_parse_line(struct ConsoleConfig* cc) {
-  cc->line[cc->line_length] = 0;  // null terminate the end
-#if CONSOLE_HISTORY_LINES > 0
-  maybe_push_line_to_history(cc);
+  const struct ConsoleCallback* cb = command_index_find(cc, words[0]);
+  if (!cb) {
+#if CONSOLE_STATS > 0
+    ++cc->stats.unknown_commands;
 #endif
-  const int num_args = split_args(cc);
-  if (num_args == 0) {
-    return;
+    console_printf(cc, "repeat: Unknown command \"%s\"\n", words[0]);
+    return CONSOLE_EXEC_UNKNOWN;
+  }
+  uint8_t first = 1;
+  cb = descend(cb, words, num_words, &first);
+  if (!check_group(cc, cb, words, num_words, first)) {
+    return CONSOLE_EXEC_BAD_ARGS;
+  }
+  if (!cb->callback && !cb->handler && cb->task) {
+    console_printf(cc, "repeat: %s is a background task\n", cb->command);
+    return CONSOLE_EXEC_UNSUPPORTED;
   }
-  // At this point, there should be a null termination after
-  // the command.
-  const char* command = cc->line;
-  for (uint8_t i=0; i < cc->callback_count; ++i) {
-    struct ConsoleCallback* cb = cc->callbacks + i;
-    if (!strcmp(command, cb->command)) {
-      if (check_arg_count(cc, cb, num_args - 1)) {
-        cb->callback(num_args - 1, cc->arg + 1);
-      }
-      return;
+  const uint8_t cmd_argc = num_words - first;
+  char** cmd_argv = words + first;
+  union ConsoleValue values[CONSOLE_MAX_ARGS];
+  if (!check_args(cc, cb, cmd_argc, cmd_argv, values)) {
+    return CONSOLE_EXEC_BAD_ARGS;
+  }
+
+  console_flush(cc);
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  // Like uart_console_run_commands(), so that lines which arrive while the
+  // command runs are queued rather than run inside it
+  const uint8_t was_running = cc->running_commands;
+  cc->running_commands = 1;
+#endif
+  uint64_t min_us = UINT64_MAX;
+  uint64_t max_us = 0;
+  uint64_t total_us = 0;
+  for (unsigned long i=0; i<count; ++i) {
+    memcpy(copy, saved, length);
+#if CONSOLE_STATS > 0
+    const uint64_t start = cc->stats.clock_us();
+    command_invoke(cc, cb, cmd_argc, cmd_argv, values);
+    const uint64_t elapsed = cc->stats.clock_us() - start;
+#else
+    const uint64_t start = time_us_64();
+    command_invoke(cc, cb, cmd_argc, cmd_argv, values);
+    const uint64_t elapsed = time_us_64() - start;
+#endif
+    total_us += elapsed;
+    if (elapsed < min_us) {
+      min_us = elapsed;
+    }
+    if (elapsed > max_us) {
+      max_us = elapsed;
     }
   }
+  console_printf(
+      cc,
+      "repeat: %lu runs, min %lu us, mean %lu us, max %lu us\n",
+      count,
+      (unsigned long)min_us,
+      (unsigned long)(total_us / count),
+      (unsigned long)max_us);
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  cc->running_commands = was_running;
+  if (!was_running) {
+    uart_console_run_commands(cc);
+  }
+#endif
+  return CONSOLE_EXEC_OK;
+}
+#endif
 
-  // nothing was found,  look for "?", or "help"
+// Runs the commands that are not in the callback table, then clears the
+// line
+static uint8_t builtin_command(struct ConsoleConfig* cc, uint8_t num_args) {
+  const char* command = cc->arg[0];
   if (!strcmp(command, "?") || !strcmp(command, "help")) {
-    dump_help(cc);
-    return;
+    dump_help(cc, num_args - 1, cc->arg + 1);
+    return line_done(cc, CONSOLE_EXEC_OK);
+  }
+#if CONSOLE_STATS > 0
+  if (!strcmp(command, "stats")) {
+    command_stats_command(cc, num_args - 1, cc->arg + 1);
+    return line_done(cc, CONSOLE_EXEC_OK);
   }
+#endif
+#if CONSOLE_REPEAT
+  if (!strcmp(command, "repeat")) {
+    // clears the line itself once the words are copied
+    return repeat_command(cc, num_args - 1, cc->arg + 1);
+  }
+#endif
+#if CONSOLE_STATS > 0
+  ++cc->stats.unknown_commands;
+#endif
 
   console_printf(
     cc,
     "Unknown Command \"%s\".  Try ? or \"help\".\n", command);
+  return line_done(cc, CONSOLE_EXEC_UNKNOWN);
+}
+
+uint8_t parse_line_dispatch(struct ConsoleConfig* cc) {
+  uint8_t num_args;
+  uint8_t first;  // index in cc->arg of the first argument
+  const struct ConsoleCallback* cb = line_cache_find(cc, &num_args, &first);
+  if (!cb) {
+    line_cache_start(cc);
+    num_args = tokenize_finish(cc);
+    if (num_args == 0) {
+      // an empty line, or the tokenizer found arguments but printed an error
+      return line_done(
+          cc, cc->tokenizer.argc ? CONSOLE_EXEC_BAD_ARGS : CONSOLE_EXEC_OK);
+    }
+    cb = command_index_find(cc, cc->arg[0]);
+    if (!cb) {
+      // nothing was found,  look for "?", "help" and the like
+      return builtin_command(cc, num_args);
+    }
+    first = 1;
+    cb = descend(cb, cc->arg, num_args, &first);
+    if (!check_group(cc, cb, cc->arg, num_args, first)) {
+      return line_done(cc, CONSOLE_EXEC_BAD_ARGS);
+    }
+    line_cache_store(cc, cb, num_args, first);
+  }
+  const uint8_t argc = num_args - first;
+  char** argv = cc->arg + first;
+#if CONSOLE_COMMAND_QUEUE_SLOTS == 0
+  // The callback gets a copy of the words, made before any are converted
+  // to values, so that input from a nested uart_console_poll() can start
+  // the next line without overwriting them.
+  char copy[CONSOLE_MAX_LINE_CHARS + 1];
+  char* copy_argv[CONSOLE_MAX_ARGS];
+  const char* tokens = tokenize_output(cc);
+  memcpy(copy, tokens, cc->tokenizer.write);
+  for (uint8_t i=0; i<argc; ++i) {
+    copy_argv[i] = copy + (argv[i] - tokens);
+  }
+  argv = copy_argv;
+#endif
+  union ConsoleValue values[CONSOLE_MAX_ARGS];
+  if (!check_args(cc, cb, argc, argv, values)) {
+    return line_done(cc, CONSOLE_EXEC_BAD_ARGS);
+  }
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  // the command runs from its queue slot so that the callback can
+  // call uart_console_poll() without its arguments being overwritten.
+  // The line is cleared before the callback runs, so it is not touched
+  // afterwards: a nested poll may have started the next one.
+  if (!command_queue_dispatch(cc, cb, argc, argv)) {
+    return line_done(cc, CONSOLE_EXEC_QUEUE_FULL);
+  }
+#else
+  // the callback may produce output of its own
+  console_flush(cc);
+  console_reset_line(cc);
+  command_invoke(cc, cb, argc, argv, values);
+#endif
+  return CONSOLE_EXEC_OK;
+}
+
+void uart_console_parse_line(struct ConsoleConfig* cc) {
+  cc->line[cc->line_length] = 0;  // null terminate the end
+#if CONSOLE_HISTORY_LINES > 0
+  maybe_push_line_to_history(cc);
+#endif
+  parse_line_dispatch(cc);
 }
@@ -9,14 +9,25 @@
 //  1. Adds the command to command history if CONSOLE_HISTORY_LINES > 0.  This
 //     is done even if there is an error so that the user can easily hit
 //     up arrow to make corrections.
-//  2. Breakup cc->line into arguments by replacing whitespace with null
-//     characters
-//  3. populates cc->arg[] with string pointers into cc->line
+//  2. Breaks up cc->line into null terminated arguments (see tokenize.h)
+//  3. populates cc->arg[] with string pointers to the arguments
 //  4. Looks at the command name to see if there is a matching entry in
-//     cc->callbacks
+//     cc->callbacks (using cc->command_index when it is enabled)
 //    a. If not, then print an error with a tip for getting help
 //    b. If yes, then validate that the argument count is correct and return an
 //       error if not.
 //    c. If the arg count is correct, then call the matching cc->callback
+//       (through cc->commands when CONSOLE_COMMAND_QUEUE_SLOTS > 0, see
+//       uart_console_run_commands)
+//  5. Handles the built-in "help" (or "?") and, when CONSOLE_STATS > 0,
+//     "stats" commands
+//  6. Clears cc->line, before the callback runs when there is one.  The
+//     callback's arguments are copied out of the line first (into a queue
+//     slot, or onto the stack without the queue), so input that it receives
+//     by calling uart_console_poll() starts the next line and is kept.
 void uart_console_parse_line(struct ConsoleConfig* cc);
+
+// Steps 2 to 6 above for a null terminated cc->line, without adding it to
+// history.  Returns a CONSOLE_EXEC_* status.
+uint8_t parse_line_dispatch(struct ConsoleConfig* cc);
 #endif
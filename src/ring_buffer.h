@@ -0,0 +1,100 @@
+#ifndef UART_CONSOLE_RING_BUFFER_H
+#define UART_CONSOLE_RING_BUFFER_H
+// Lock-free single-producer/single-consumer ring buffer (struct ConsoleRing).
+//
+// The producer owns head and the consumer owns tail.  Each side publishes
+// its counter with a release store after touching data and reads the other
+// side's counter with an acquire load, so this is safe between an
+// interrupt handler and the main loop as well as between two cores.
+#include "uart_console/console.h"
+#include <string.h>
+
+// size must be a power of two
+static inline void console_ring_init(
+    struct ConsoleRing* ring, char* data, uint16_t size) {
+  ring->data = data;
+  ring->mask = size - 1;
+  ring->head = 0;
+  ring->tail = 0;
+  ring->overflows = 0;
+  ring->high_water = 0;
+}
+
+// Number of bytes waiting.  Can be called from either side.
+static inline uint16_t console_ring_depth(const struct ConsoleRing* ring) {
+  return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) -
+         __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+// Producer side.  Returns 0 (and counts an overflow) if the ring is full.
+static inline uint8_t console_ring_push(struct ConsoleRing* ring, char c) {
+  const uint16_t head = ring->head;
+  const uint16_t depth =
+    head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  if (depth > ring->mask) {
+    ++ring->overflows;
+    return 0;
+  }
+  ring->data[head & ring->mask] = c;
+  __atomic_store_n(&ring->head, (uint16_t)(head + 1), __ATOMIC_RELEASE);
+  if (depth >= ring->high_water) {
+    ring->high_water = depth + 1;
+  }
+  return 1;
+}
+
+// Consumer side.  Returns the next byte (0-255) or -1 if the ring is empty.
+static inline int console_ring_pop(struct ConsoleRing* ring) {
+  const uint16_t tail = ring->tail;
+  if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+    return -1;
+  }
+  const uint8_t c = ring->data[tail & ring->mask];
+  __atomic_store_n(&ring->tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+  return c;
+}
+// Producer side.  Copies as much of data as fits and returns the number of
+// bytes copied.  Nothing is counted as an overflow.
+static inline uint16_t console_ring_write(
+    struct ConsoleRing* ring, const char* data, uint16_t length) {
+  const uint16_t head = ring->head;
+  const uint16_t depth =
+    head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  const uint16_t space = ring->mask + 1 - depth;
+  if (length > space) {
+    length = space;
+  }
+  const uint16_t start = head & ring->mask;
+  const uint16_t first = ring->mask + 1 - start;
+  if (length <= first) {
+    memcpy(ring->data + start, data, length);
+  } else {
+    memcpy(ring->data + start, data, first);
+    memcpy(ring->data, data + first, length - first);
+  }
+  __atomic_store_n(&ring->head, (uint16_t)(head + length), __ATOMIC_RELEASE);
+  if (depth + length > ring->high_water) {
+    ring->high_water = depth + length;
+  }
+  return length;
+}
+
+// Consumer side.  Points *data at the oldest byte and returns how many
+// bytes are waiting there without wrapping.
+static inline uint16_t console_ring_peek(
+    const struct ConsoleRing* ring, const char** data) {
+  const uint16_t tail = ring->tail;
+  const uint16_t depth = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+  const uint16_t start = tail & ring->mask;
+  const uint16_t first = ring->mask + 1 - start;
+  *data = ring->data + start;
+  return (depth < first) ? depth : first;
+}
+
+// Consumer side.  Releases bytes returned by console_ring_peek().
+static inline void console_ring_consume(
+    struct ConsoleRing* ring, uint16_t length) {
+  __atomic_store_n(
+      &ring->tail, (uint16_t)(ring->tail + length), __ATOMIC_RELEASE);
+}
+#endif
@@ -0,0 +1,96 @@
+// Raw payloads that bypass the line editor
+#include "stream.h"
+#include "binary_frame.h"
+
+#if CONSOLE_STREAM_BUFFER_SIZE > 0
+// Hands stream_data to the chunk callback
+static void deliver(struct ConsoleConfig* cc) {
+  const uint16_t length = cc->stream_fill;
+  if (length == 0) {
+    return;
+  }
+  cc->stream_fill = 0;
+  if (cc->stream_flags & CONSOLE_STREAM_CRC) {
+    cc->stream_crc = binary_crc16(cc->stream_crc, cc->stream_data, length);
+  }
+  cc->stream->chunk(cc, cc->stream_data, length);
+}
+
+// Returns input to the line editor and reports result
+static void finish(struct ConsoleConfig* cc, uint8_t result) {
+  const struct ConsoleStream* stream = cc->stream;
+  cc->stream = NULL;
+  // the prompt was skipped while the payload arrived
+  cc->prompt_displayed = 0;
+  if (stream->done) {
+    stream->done(cc, result);
+  }
+}
+
+void stream_process_char(struct ConsoleConfig* cc, char c) {
+  if (cc->stream_remaining) {
+    cc->stream_data[cc->stream_fill++] = c;
+    if ((--cc->stream_remaining == 0) ||
+        (cc->stream_fill >= CONSOLE_STREAM_BUFFER_SIZE)) {
+      deliver(cc);
+    }
+    if (cc->stream && !cc->stream_remaining && !cc->stream_crc_bytes) {
+      finish(cc, CONSOLE_STREAM_OK);
+    }
+    return;
+  }
+  // the crc, low byte first
+  if (cc->stream_crc_bytes == 2) {
+    cc->stream_received_crc = (uint8_t)c;
+  } else {
+    cc->stream_received_crc |= (uint16_t)(uint8_t)c << 8;
+  }
+  if (--cc->stream_crc_bytes == 0) {
+    finish(
+        cc,
+        (cc->stream_received_crc == cc->stream_crc) ?
+          CONSOLE_STREAM_OK : CONSOLE_STREAM_BAD_CRC);
+  }
+}
+
+void stream_flush(struct ConsoleConfig* cc) {
+  if (cc->stream) {
+    deliver(cc);
+  }
+}
+
+uint8_t uart_console_stream_start(
+    struct ConsoleConfig* cc,
+    const struct ConsoleStream* stream,
+    uint32_t length,
+    uint8_t flags) {
+  if (cc->stream) {
+    return 0;
+  }
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  if (cc->remote_dispatch) {
+    return 0;
+  }
+#endif
+  cc->stream = stream;
+  cc->stream_remaining = length;
+  cc->stream_fill = 0;
+  cc->stream_crc = 0xFFFF;
+  cc->stream_flags = flags;
+  cc->stream_crc_bytes = (flags & CONSOLE_STREAM_CRC) ? 2 : 0;
+  if (!length && !cc->stream_crc_bytes) {
+    finish(cc, CONSOLE_STREAM_OK);
+  }
+  return 1;
+}
+
+void uart_console_stream_cancel(struct ConsoleConfig* cc) {
+  if (!cc->stream) {
+    return;
+  }
+  deliver(cc);
+  if (cc->stream) {
+    finish(cc, CONSOLE_STREAM_CANCELLED);
+  }
+}
+#endif
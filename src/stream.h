@@ -0,0 +1,18 @@
+#ifndef UART_CONSOLE_STREAM_H
+#define UART_CONSOLE_STREAM_H
+// Raw payloads claimed by a command (see uart_console_stream_start)
+#include "uart_console/console.h"
+
+#if CONSOLE_STREAM_BUFFER_SIZE > 0
+// Nonzero while input is going to a stream instead of the line editor
+static inline uint8_t stream_active(const struct ConsoleConfig* cc) {
+  return cc->stream != NULL;
+}
+
+// Takes one received byte of the payload or its crc
+void stream_process_char(struct ConsoleConfig* cc, char c);
+
+// Passes on a partial batch.  Called at the end of uart_console_poll().
+void stream_flush(struct ConsoleConfig* cc);
+#endif
+#endif
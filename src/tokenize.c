@@ -0,0 +1,164 @@
+// Single pass tokenizer for cc->line
+#include "tokenize.h"
+#include "util.h"
+#include <string.h>
+
+#define TOKEN_SPACE       0  // between arguments, a quote opens a quote
+#define TOKEN_AFTER_QUOTE 1  // just after a closing quote
+#define TOKEN_WORD        2  // in an unquoted argument
+#define TOKEN_QUOTED      3  // in a quoted argument, "" is an empty one
+
+// nonzero if any byte of w is zero
+#define WORD_HAS_ZERO(w) (((w) - 0x01010101u) & ~(w) & 0x80808080u)
+// nonzero if any byte of w is c
+#define WORD_HAS_BYTE(w, c) WORD_HAS_ZERO((w) ^ (0x01010101u * (uint8_t)(c)))
+
+void tokenize_reset(struct ConsoleConfig* cc) {
+  memset(&cc->tokenizer, 0, sizeof(cc->tokenizer));
+}
+
+static void start_arg(
+    struct ConsoleConfig* cc, struct ConsoleTokenizer* tok, char* out) {
+  if (tok->argc >= CONSOLE_MAX_ARGS) {
+    // reported by tokenize_finish() so that quote errors take priority
+    tok->too_many = 1;
+    return;
+  }
+  cc->arg[tok->argc++] = out + tok->write;
+}
+
+// Consumes cc->line up to end.  When out is cc->line, nothing is written
+// past what has been read so the split can happen in place.
+static void scan(struct ConsoleConfig* cc, char* out, uint16_t end) {
+  struct ConsoleTokenizer* tok = &cc->tokenizer;
+  const char* in = cc->line;
+  uint16_t read = tok->read;
+  uint8_t state = tok->state;
+  uint8_t escape = tok->escape;
+
+  while (read < end) {
+    if (!escape && ((state == TOKEN_WORD) || (state == TOKEN_QUOTED))) {
+      // Copy a word at a time until something other than an ordinary
+      // character shows up.  Loads are done with memcpy because the
+      // Cortex-M0+ faults on unaligned access.
+      const char stop = (state == TOKEN_WORD) ? ' ' : '"';
+      uint16_t write = tok->write;
+      while ((read + 4) <= end) {
+        uint32_t w;
+        memcpy(&w, in + read, 4);
+        if (WORD_HAS_BYTE(w, stop) || WORD_HAS_BYTE(w, '\\')) {
+          break;
+        }
+        memcpy(out + write, &w, 4);
+        read += 4;
+        write += 4;
+      }
+      tok->write = write;
+      if (read >= end) {
+        break;
+      }
+    }
+
+    const char c = in[read++];
+    if (escape) {
+      escape = 0;
+      out[tok->write++] = c;
+      continue;
+    }
+
+    switch (state) {
+      case TOKEN_SPACE:
+        if (c == ' ') {
+          break;
+        }
+        start_arg(cc, tok, out);
+        if (c == '"') {
+          state = TOKEN_QUOTED;
+          break;
+        }
+        state = TOKEN_WORD;
+        if (c == '\\') {
+          escape = 1;
+        } else {
+          out[tok->write++] = c;
+        }
+        break;
+      case TOKEN_AFTER_QUOTE:
+        if (c == ' ') {
+          state = TOKEN_SPACE;
+          break;
+        }
+        // the closing quote ended the last argument, a quote here is literal
+        start_arg(cc, tok, out);
+        state = TOKEN_WORD;
+        if (c == '\\') {
+          escape = 1;
+        } else {
+          out[tok->write++] = c;
+        }
+        break;
+      case TOKEN_WORD:
+        if (c == ' ') {
+          out[tok->write++] = '\0';
+          state = TOKEN_SPACE;
+        } else if (c == '\\') {
+          escape = 1;
+        } else {
+          out[tok->write++] = c;
+        }
+        break;
+      case TOKEN_QUOTED:
+        if (c == '"') {
+          out[tok->write++] = '\0';
+          state = TOKEN_AFTER_QUOTE;
+        } else if (c == '\\') {
+          escape = 1;
+        } else {
+          out[tok->write++] = c;
+        }
+        break;
+    }
+  }
+
+  tok->read = read;
+  tok->state = state;
+  tok->escape = escape;
+}
+
+#if CONSOLE_INCREMENTAL_TOKENIZER
+void tokenize_feed(struct ConsoleConfig* cc) {
+  scan(cc, cc->tokens, cc->line_length);
+}
+#endif
+
+// counts a line that could not be split
+static uint8_t syntax_error(struct ConsoleConfig* cc) {
+#if CONSOLE_STATS > 0
+  ++cc->stats.parse_errors;
+#endif
+  return 0;
+}
+
+uint8_t tokenize_finish(struct ConsoleConfig* cc) {
+  struct ConsoleTokenizer* tok = &cc->tokenizer;
+  char* out = tokenize_output(cc);
+  scan(cc, out, cc->line_length);
+
+  if (tok->state == TOKEN_QUOTED) {
+    console_printf(cc, "Unclosed quote\n");
+    return syntax_error(cc);
+  }
+  if (tok->escape) {
+    console_printf(cc, "Line ended with backslash\n");
+    return syntax_error(cc);
+  }
+  if (tok->too_many) {
+    console_printf(cc, "Too many arguments (>%d)\n", CONSOLE_MAX_ARGS);
+    return syntax_error(cc);
+  }
+  if (tok->state == TOKEN_WORD) {
+    out[tok->write++] = '\0';
+    tok->state = TOKEN_SPACE;
+  }
+  return tok->argc;
+}
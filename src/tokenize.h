@@ -0,0 +1,48 @@
+#ifndef UART_CONSOLE_TOKENIZE_H
+#define UART_CONSOLE_TOKENIZE_H
+// Splits cc->line into null terminated arguments in a single forward pass.
+//
+// Arguments are separated by spaces.  A quote at the start of an argument
+// keeps spaces until the closing quote ("" is an empty argument) and a
+// backslash makes the following character literal.  A quote inside an
+// argument is an ordinary character.
+//
+// The split is resumable: tokenize_feed() consumes whatever has been added
+// to the end of cc->line since the last call and tokenize_finish() completes
+// the line.  With CONSOLE_INCREMENTAL_TOKENIZER set, the output goes to
+// cc->tokens and process_char() feeds each character as it arrives, leaving
+// very little to do when enter is pressed.  Otherwise the output overwrites
+// cc->line at enter.
+#include "uart_console/console.h"
+
+// Starts over at the beginning of cc->line
+void tokenize_reset(struct ConsoleConfig* cc);
+
+#if CONSOLE_INCREMENTAL_TOKENIZER
+// Consumes cc->line up to cc->line_length
+void tokenize_feed(struct ConsoleConfig* cc);
+#endif
+
+// Consumes the rest of cc->line and sets cc->arg[].  Returns the number of
+// arguments, including the command.  Zero is returned for an empty line or
+// after printing an error.
+uint8_t tokenize_finish(struct ConsoleConfig* cc);
+
+// Where cc->arg[] points after tokenize_finish()
+static inline char* tokenize_output(struct ConsoleConfig* cc) {
+#if CONSOLE_INCREMENTAL_TOKENIZER
+  return cc->tokens;
+#else
+  return cc->line;
+#endif
+}
+
+// Call when cc->line is changed at position from or later, other than by
+// appending characters
+static inline void tokenize_line_changed(
+    struct ConsoleConfig* cc, uint16_t from) {
+  if (from < cc->tokenizer.read) {
+    tokenize_reset(cc);
+  }
+}
+#endif
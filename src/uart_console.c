@@ -1,42 +1,142 @@
 #include "uart_console/console.h"
+#include <stdarg.h>
 #include <string.h>
 #include <stdio.h>
 #include "pico/stdlib.h"
+#if CONSOLE_WAKEUP
+#include "hardware/sync.h"
+#endif
 
 #include "util.h"
+#include "binary_frame.h"
+#include "command_index.h"
+#include "format.h"
 #include "parse_line.h"
+#include "ring_buffer.h"
+#include "stream.h"
+#include "tokenize.h"
 #include "vt102_process_char.h"
 #include "vt102_util.h"
 
-static void reset_line(struct ConsoleConfig* cc) {
-  cc->line_length = 0;
-  cc->cursor_index = 0;
-  cc->prompt_displayed = 0;
-  cc->tab_length = 0;
-  cc->tab_callback_index = cc->callback_count - 1;
-#if CONSOLE_HISTORY_LINES > 0
-  cc->history_marker_index = -1;
+#if CONSOLE_RX_BUFFER_SIZE > 0
+_Static_assert(
+  (CONSOLE_RX_BUFFER_SIZE & (CONSOLE_RX_BUFFER_SIZE - 1)) == 0,
+  "CONSOLE_RX_BUFFER_SIZE must be a power of two");
+_Static_assert(
+  CONSOLE_RX_BUFFER_SIZE <= 32768,
+  "CONSOLE_RX_BUFFER_SIZE must be 32768 or less");
 #endif
-}
+
+#if CONSOLE_REPLY_BUFFER_SIZE > 0
+_Static_assert(
+  (CONSOLE_REPLY_BUFFER_SIZE & (CONSOLE_REPLY_BUFFER_SIZE - 1)) == 0,
+  "CONSOLE_REPLY_BUFFER_SIZE must be a power of two");
+_Static_assert(
+  CONSOLE_REPLY_BUFFER_SIZE <= 32768,
+  "CONSOLE_REPLY_BUFFER_SIZE must be 32768 or less");
+#endif
+
+#if CONSOLE_TX_BUFFER_SIZE > 0
+_Static_assert(
+  (CONSOLE_TX_BUFFER_SIZE & (CONSOLE_TX_BUFFER_SIZE - 1)) == 0,
+  "CONSOLE_TX_BUFFER_SIZE must be a power of two");
+_Static_assert(
+  CONSOLE_TX_BUFFER_SIZE <= 32768,
+  "CONSOLE_TX_BUFFER_SIZE must be 32768 or less");
+#endif
+
+// Bounds of the console_commands section, provided by the linker for
+// CONSOLE_COMMAND entries.  Weak so that programs without any are fine.
+extern const struct ConsoleCallback __start_console_commands[]
+  __attribute__((weak));
+extern const struct ConsoleCallback __stop_console_commands[]
+  __attribute__((weak));
 
 void uart_console_init_lowlevel(
   struct ConsoleConfig* cc,
-  struct ConsoleCallback* callbacks,
-  uint8_t callback_count,
+  const struct ConsoleCallback* callbacks,
+  uint16_t callback_count,
   uint8_t terminal,
   int (*putchar)(int c)) {
   memset(cc, 0, sizeof(struct ConsoleConfig));
+  if (!callbacks) {
+    callbacks = __start_console_commands;
+    callback_count = __start_console_commands ?
+      __stop_console_commands - __start_console_commands : 0;
+  }
   cc->callbacks = callbacks;
   cc->callback_count = callback_count;
   cc->terminal = terminal;
   cc->putchar = putchar;
-  reset_line(cc);
+  command_index_build(cc);
+#if CONSOLE_RX_BUFFER_SIZE > 0
+  console_ring_init(&cc->rx, cc->rx_data, CONSOLE_RX_BUFFER_SIZE);
+#endif
+#if CONSOLE_REPLY_BUFFER_SIZE > 0
+  console_ring_init(&cc->reply, cc->reply_data, CONSOLE_REPLY_BUFFER_SIZE);
+#endif
+#if CONSOLE_TX_BUFFER_SIZE > 0
+  console_ring_init(&cc->tx, cc->tx_data, CONSOLE_TX_BUFFER_SIZE);
+#endif
+#if CONSOLE_STATS > 0
+  cc->stats.clock_us = time_us_64;
+#endif
+  console_reset_line(cc);
+}
+
+void uart_console_set_writer(
+  struct ConsoleConfig* cc,
+  void (*write)(const char* data, size_t length),
+  void (*flush)(void)) {
+  console_flush(cc);
+  cc->write = write;
+  cc->flush = flush;
+}
+
+void uart_console_set_transport(
+  struct ConsoleConfig* cc,
+  const struct ConsoleTransport* transport,
+  void* context) {
+  console_flush(cc);
+  cc->transport = transport;
+  cc->context = context;
+}
+
+void* uart_console_context(const struct ConsoleConfig* cc) {
+  return cc->context;
+}
+
+void uart_console_write(
+  struct ConsoleConfig* cc, const char* data, uint16_t length) {
+  console_write(cc, data, length);
+}
+
+static void write_output(void* ctx, const char* data, uint16_t length) {
+  console_write(ctx, data, length);
+}
+
+void uart_console_printf(struct ConsoleConfig* cc, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  console_vformat(write_output, cc, fmt, args);
+  va_end(args);
+}
+
+#if CONSOLE_STATS > 0
+void uart_console_set_stats_clock(
+  struct ConsoleConfig* cc, uint64_t (*clock_us)(void)) {
+  cc->stats.clock_us = clock_us;
+}
+#endif
+
+void uart_console_flush(struct ConsoleConfig* cc) {
+  console_flush(cc);
 }
 
 void uart_console_init(
   struct ConsoleConfig* cc,
-  struct ConsoleCallback* callbacks,
-  uint8_t callback_count,
+  const struct ConsoleCallback* callbacks,
+  uint16_t callback_count,
   uint8_t terminal) {
   stdio_init_all();
   uart_console_init_lowlevel(
@@ -45,6 +145,10 @@ void uart_console_init(
     callback_count,
     terminal,
     putchar);
+#if CONSOLE_BINARY_MODE
+  // frames must not have "\n" turned into "\r\n"
+  uart_console_set_binary_putchar(cc, putchar_raw);
+#endif
 }
 
 
@@ -74,6 +178,7 @@ static void insert_character(struct ConsoleConfig* cc, char c) {
   if (cc->line_length > cc->cursor_index) {
     // need to insert a character into line 
     // make a spot for it
+    tokenize_line_changed(cc, cc->cursor_index);
     memmove(
       cc->line + cc->cursor_index + 1,
       cc->line + cc->cursor_index,
@@ -86,27 +191,47 @@ static void insert_character(struct ConsoleConfig* cc, char c) {
   // update indexes
   ++cc->line_length;
   ++cc->cursor_index;
-  cc->tab_length = cc->line_length;
 } 
 
 // Process a received character from the UART
-void uart_console_putchar(struct ConsoleConfig* cc, char c) { 
+static void process_char(struct ConsoleConfig* cc, char c) {
+#if CONSOLE_STATS > 0
+  ++cc->stats.chars;
+#endif
+#if CONSOLE_STREAM_BUFFER_SIZE > 0
+  if (stream_active(cc)) {
+    stream_process_char(cc, c);
+    return;
+  }
+#endif
+#if CONSOLE_BINARY_MODE
+  if (cc->terminal == CONSOLE_BINARY) {
+    binary_process_char(cc, c);
+    return;
+  }
+#endif
   c = process_mode(cc, c);
   if (c == '\r') {
+    // clears the line itself
     uart_console_parse_line(cc);
-    reset_line(cc);
   } else if (c == 0x03) {
     // ctrl-c
     console_puts(cc, "\rCancelled\r");
-    reset_line(cc);  
-  } else if (c < 32) {
+#if CONSOLE_MAX_TASKS > 0
+    cc->cancel_tasks = 1;
+#endif
+    console_reset_line(cc);  
+  } else if ((uint8_t)c < 32) {
     // ignore this code
   } else if (cc->line_length >= CONSOLE_MAX_LINE_CHARS) {
     console_printf(
         cc, "\nLine too long (>%d characters)\n", CONSOLE_MAX_LINE_CHARS);
-    reset_line(cc);
+    console_reset_line(cc);
   } else {
     insert_character(cc, c);
+#if CONSOLE_INCREMENTAL_TOKENIZER
+    tokenize_feed(cc);
+#endif
   }
 
   if (cc->terminal == CONSOLE_DEBUG_VT102) {
@@ -114,8 +239,14 @@ void uart_console_putchar(struct ConsoleConfig* cc, char c) {
   }
 }
 
+void uart_console_putchar(struct ConsoleConfig* cc, char c) {
+  process_char(cc, c);
+  console_flush(cc);
+}
+
 // Displays prompt for data
 static void show_prompt(struct ConsoleConfig* cc, const char* prompt) {
+  cc->prompt = prompt;
   console_printf(cc, prompt);
   if (cc->terminal == CONSOLE_VT102) {
     vt102_insert_mode(cc);
@@ -123,21 +254,198 @@ static void show_prompt(struct ConsoleConfig* cc, const char* prompt) {
   cc->prompt_displayed = 1;
 }
 
+#if CONSOLE_REPLY_BUFFER_SIZE > 0
+// Sends output queued by uart_console_reply_write()
+static void send_replies(struct ConsoleConfig* cc) {
+  for (int cint = console_ring_pop(&cc->reply);
+       cint >= 0;
+       cint = console_ring_pop(&cc->reply)) {
+    console_raw_putchar(cc, (char)cint);
+  }
+}
+#endif
+
+// Takes the next character from the console's input, or -1 if there is none
+static int read_char(struct ConsoleConfig* cc) {
+  if (cc->transport && cc->transport->read) {
+    return cc->transport->read(cc);
+  }
+  return getchar_timeout_us(0);
+}
+
 uint32_t uart_console_poll(struct ConsoleConfig* cc, const char* prompt) {
-  if ((cc->prompt_displayed == 0) && (cc->terminal != CONSOLE_MINIMAL)) {
+#if CONSOLE_WAKEUP
+  // cleared before reading so that input arriving from here on wakes the
+  // next uart_console_wait()
+  cc->input_pending = 0;
+#endif
+  uint8_t need_prompt =
+    (cc->prompt_displayed == 0) &&
+    (cc->terminal != CONSOLE_MINIMAL) &&
+    (cc->terminal != CONSOLE_BINARY);
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  if (cc->remote_dispatch && uart_console_command_queue_depth(cc)) {
+    // hold the prompt until the other core has run the command so that
+    // its replies come first
+    need_prompt = 0;
+  }
+#endif
+#if CONSOLE_STREAM_BUFFER_SIZE > 0
+  if (stream_active(cc)) {
+    // a payload is arriving, the prompt comes after it
+    need_prompt = 0;
+  }
+#endif
+#if CONSOLE_REPLY_BUFFER_SIZE > 0
+  send_replies(cc);
+#endif
+  if (need_prompt) {
     show_prompt(cc, prompt);
   }
 
   uint32_t num_processed = 0;
+#if CONSOLE_RX_BUFFER_SIZE > 0
+  for (int cint = console_ring_pop(&cc->rx);
+       cint >= 0;
+       cint = console_ring_pop(&cc->rx)) {
+    process_char(cc, (char)cint);
+    ++num_processed;
+  }
+#endif
   while (1) {
-    const int cint = getchar_timeout_us(0);
-    if ((cint < 0) || (cint > 254)) {
+    const int cint = read_char(cc);
+    if (cint < 0) {
       // didn't get anything
       break;
     }
-    uart_console_putchar(cc, (char)cint);
+    process_char(cc, (char)cint);
     ++num_processed;
   }
+#if CONSOLE_STREAM_BUFFER_SIZE > 0
+  stream_flush(cc);
+#endif
+#if CONSOLE_MAX_TASKS > 0
+  if (!console_remote_dispatch(cc)) {
+    uart_console_run_tasks(cc);
+  }
+#endif
+  console_flush(cc);
 
   return num_processed;
 }
+
+#if CONSOLE_RX_BUFFER_SIZE > 0
+uint8_t uart_console_rx_push(struct ConsoleConfig* cc, char c) {
+  const uint8_t pushed = console_ring_push(&cc->rx, c);
+#if CONSOLE_WAKEUP
+  uart_console_notify(cc);
+#endif
+  return pushed;
+}
+#endif
+
+#if CONSOLE_WAKEUP
+void uart_console_notify(struct ConsoleConfig* cc) {
+  cc->input_pending = 1;
+  // sets the event register of both cores, so a __wfe() that has not
+  // started yet returns at once
+  __sev();
+}
+
+static void on_chars_available(void* ctx) {
+  uart_console_notify(ctx);
+}
+
+void uart_console_notify_on_stdio(struct ConsoleConfig* cc) {
+  stdio_set_chars_available_callback(cc ? on_chars_available : NULL, cc);
+}
+
+// true if uart_console_poll() has something to do
+static uint8_t has_work(struct ConsoleConfig* cc) {
+  if (cc->input_pending) {
+    return 1;
+  }
+#if CONSOLE_RX_BUFFER_SIZE > 0
+  if (console_ring_depth(&cc->rx)) {
+    return 1;
+  }
+#endif
+#if CONSOLE_REPLY_BUFFER_SIZE > 0
+  if (console_ring_depth(&cc->reply)) {
+    return 1;
+  }
+#endif
+#if CONSOLE_MAX_TASKS > 0
+  if (!console_remote_dispatch(cc)) {
+    for (uint8_t i=0; i<CONSOLE_MAX_TASKS; ++i) {
+      if (cc->tasks[i].callback) {
+        return 1;
+      }
+    }
+  }
+#endif
+  return 0;
+}
+
+uint8_t uart_console_wait(struct ConsoleConfig* cc, uint32_t timeout_us) {
+  const absolute_time_t until = make_timeout_time_us(timeout_us);
+  while (!has_work(cc)) {
+    if (best_effort_wfe_or_timeout(until)) {
+      return has_work(cc);
+    }
+  }
+  return 1;
+}
+#endif
+
+#if CONSOLE_TX_BUFFER_SIZE > 0
+void uart_console_set_tx_drain(
+  struct ConsoleConfig* cc,
+  const struct ConsoleTxDrain* drain,
+  uint8_t overflow) {
+  console_flush(cc);
+  cc->tx_drain = drain;
+  cc->tx_overflow = overflow;
+}
+
+int uart_console_tx_pop(struct ConsoleConfig* cc) {
+  return console_ring_pop(&cc->tx);
+}
+
+uint16_t uart_console_tx_peek(struct ConsoleConfig* cc, const char** data) {
+  return console_ring_peek(&cc->tx, data);
+}
+
+void uart_console_tx_consume(struct ConsoleConfig* cc, uint16_t length) {
+  console_ring_consume(&cc->tx, length);
+}
+#endif
+
+#if CONSOLE_REPLY_BUFFER_SIZE > 0
+uint16_t uart_console_reply_write(
+    struct ConsoleConfig* cc, const char* data, uint16_t length) {
+  uint16_t i=0;
+  for (; i<length; ++i) {
+    if (!console_ring_push(&cc->reply, data[i])) {
+      cc->reply.overflows += length - i - 1;  // count the rest too
+      break;
+    }
+  }
+#if CONSOLE_WAKEUP
+  uart_console_notify(cc);
+#endif
+  return i;
+}
+
+static void write_reply(void* ctx, const char* data, uint16_t length) {
+  uart_console_reply_write(ctx, data, length);
+}
+
+void uart_console_reply_printf(struct ConsoleConfig* cc, const char* fmt, ...) {
+  // no shared buffer so that this can be called from any core
+  va_list args;
+  va_start(args, fmt);
+  console_vformat(write_reply, cc, fmt, args);
+  va_end(args);
+}
+#endif
@@ -1,40 +1,196 @@
 #include "uart_console/console.h"
 #include "util.h"
+#include "tokenize.h"
+#include "format.h"
+#include "ring_buffer.h"
 #include <stdarg.h>
-#include <stdio.h>
+#include <string.h>
 
-void console_putchar(const struct ConsoleConfig* cc, char c) {
+// true when output goes to a block write function instead of putchar()
+static inline uint8_t has_writer(const struct ConsoleConfig* cc) {
+  return cc->write || (cc->transport && cc->transport->write);
+}
+
+// passes a block of output to the transport or the registered writer
+static void device_write(
+    struct ConsoleConfig* cc, const char* data, size_t length) {
+  if (cc->transport && cc->transport->write) {
+    cc->transport->write(cc, data, length);
+  } else {
+    cc->write(data, length);
+  }
+}
+
+// the putchar() for the current mode
+static inline int (*output_putchar(const struct ConsoleConfig* cc))(int) {
+#if CONSOLE_BINARY_MODE
+  if ((cc->terminal == CONSOLE_BINARY) && cc->binary_putchar) {
+    return cc->binary_putchar;
+  }
+#endif
+  return cc->putchar;
+}
+
+#if CONSOLE_OUTPUT_BUFFER_SIZE > 0
+// passes staged output to the device
+static void drain_output_buffer(struct ConsoleConfig* cc) {
+  if (cc->output_length > 0) {
+    device_write(cc, cc->output_buffer, cc->output_length);
+    cc->output_length = 0;
+  }
+}
+#endif
+
+#if CONSOLE_TX_BUFFER_SIZE > 0
+// places output in cc->tx, waiting for room or dropping what does not fit
+static void tx_write(struct ConsoleConfig* cc, const char* data, uint16_t length) {
+  cc->output_pending = 1;
+  while (1) {
+    const uint16_t n = console_ring_write(&cc->tx, data, length);
+    cc->tx_queued += n;
+    data += n;
+    length -= n;
+    if (length == 0) {
+      return;
+    }
+    if (cc->tx_overflow == CONSOLE_TX_DROP) {
+      cc->tx.overflows += length;
+      return;
+    }
+    // make sure the drain is running, then give it time
+    cc->tx_drain->start(cc);
+    if (cc->tx_drain->wait) {
+      cc->tx_drain->wait(cc);
+    }
+  }
+}
+#endif
+
+void console_raw_putchar(struct ConsoleConfig* cc, char c) {
+#if CONSOLE_TX_BUFFER_SIZE > 0
+  if (cc->tx_drain) {
+    tx_write(cc, &c, 1);
+    return;
+  }
+#endif
+  if (!has_writer(cc)) {
+    output_putchar(cc)(c);
+    return;
+  }
+  cc->output_pending = 1;
+#if CONSOLE_OUTPUT_BUFFER_SIZE > 0
+  if (cc->output_length >= CONSOLE_OUTPUT_BUFFER_SIZE) {
+    drain_output_buffer(cc);
+  }
+  cc->output_buffer[cc->output_length++] = c;
+#else
+  device_write(cc, &c, 1);
+#endif
+}
+
+void console_write(struct ConsoleConfig* cc, const char* data, uint16_t length) {
+#if CONSOLE_TX_BUFFER_SIZE > 0
+  if (cc->tx_drain) {
+    tx_write(cc, data, length);
+    return;
+  }
+#endif
+  if (!has_writer(cc)) {
+    int (*put)(int) = output_putchar(cc);
+    for (uint16_t i=0; i<length; ++i) {
+      put(data[i]);
+    }
+    return;
+  }
+  if (length == 0) {
+    return;
+  }
+  cc->output_pending = 1;
+#if CONSOLE_OUTPUT_BUFFER_SIZE > 0
+  if (cc->output_length + length > CONSOLE_OUTPUT_BUFFER_SIZE) {
+    drain_output_buffer(cc);
+    if (length >= CONSOLE_OUTPUT_BUFFER_SIZE) {
+      // too big to stage, no reason to copy it
+      device_write(cc, data, length);
+      return;
+    }
+  }
+  memcpy(cc->output_buffer + cc->output_length, data, length);
+  cc->output_length += length;
+#else
+  device_write(cc, data, length);
+#endif
+}
+
+void console_flush(struct ConsoleConfig* cc) {
+  if (!cc->output_pending) {
+    return;
+  }
+#if CONSOLE_TX_BUFFER_SIZE > 0
+  if (cc->tx_drain) {
+    cc->output_pending = 0;
+    cc->tx_drain->start(cc);
+    return;
+  }
+#endif
+#if CONSOLE_OUTPUT_BUFFER_SIZE > 0
+  drain_output_buffer(cc);
+#endif
+  cc->output_pending = 0;
+  if (cc->transport && cc->transport->write) {
+    if (cc->transport->flush) {
+      cc->transport->flush(cc);
+    }
+  } else if (cc->flush) {
+    cc->flush();
+  }
+}
+
+void console_reset_line(struct ConsoleConfig* cc) {
+  cc->line_length = 0;
+  cc->cursor_index = 0;
+  tokenize_reset(cc);
+  cc->prompt_displayed = 0;
+  cc->tab_count = 0;
+#if CONSOLE_BINARY_MODE
+  cc->binary_state = 0;
+#endif
+#if CONSOLE_HISTORY_LINES > 0
+  cc->history_marker_index = -1;
+  cc->history_search = 0;
+  cc->history_search_shown = 0;
+#endif
+}
+
+void console_putchar(struct ConsoleConfig* cc, char c) {
   if (c == '\r') {
-    cc->putchar('\r');
-    cc->putchar('\n');  // also one of these
+    console_write(cc, "\r\n", 2);  // also one of these
   } else if (c >= 32) {
-    cc->putchar(c);
+    console_raw_putchar(cc, c);
   }
 }
 
-void console_puts(const struct ConsoleConfig* cc, const char* s) {
+void console_puts(struct ConsoleConfig* cc, const char* s) {
   for (; *s; ++s) {
     console_putchar(cc, *s);
   }
 }
 
-void console_debug_putchar(const struct ConsoleConfig* cc, char c) {
+void console_debug_putchar(struct ConsoleConfig* cc, char c) {
   console_printf(cc, "%03d %02x ", c, c);
   if ((c >= 32) && (c <= 254)) {
-    cc->putchar(c);
+    console_raw_putchar(cc, c);
   }
   console_printf(cc, "\n");
 }
 
-#define MAX_PRINTF_LENGTH 255
-void console_printf(const struct ConsoleConfig* cc, const char* fmt, ...) {
-  static char printf_buffer[MAX_PRINTF_LENGTH + 1];
+static void write_to_console(void* ctx, const char* data, uint16_t length) {
+  console_write(ctx, data, length);
+}
+
+void console_printf(struct ConsoleConfig* cc, const char* fmt, ...) {
   va_list args;
   va_start(args, fmt);
-  vsnprintf(printf_buffer, MAX_PRINTF_LENGTH, fmt, args);
+  console_vformat(write_to_console, cc, fmt, args);
   va_end(args);
-  for (const char* c=printf_buffer; *c; ++c) {
-    cc->putchar(*c);
-  }
 }
-
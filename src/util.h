@@ -1,14 +1,38 @@
 #ifndef UART_CONSOLE_UTIL_H
 #define UART_CONSOLE_UTIL_H
+#include "uart_console/console.h"
+
+// true when commands run on another core (see uart_console_set_remote_dispatch)
+static inline uint8_t console_remote_dispatch(const struct ConsoleConfig* cc) {
+#if CONSOLE_COMMAND_QUEUE_SLOTS > 0
+  return cc->remote_dispatch;
+#else
+  return 0;
+#endif
+}
+
+// clears the line being edited and prepares for a new prompt
+void console_reset_line(struct ConsoleConfig* cc);
+
+// outputs a single character with no translation
+void console_raw_putchar(struct ConsoleConfig* cc, char c);
+
+// outputs a block of characters with no translation
+void console_write(struct ConsoleConfig* cc, const char* data, uint16_t length);
+
+// sends staged output to cc->write() and calls cc->flush()
+void console_flush(struct ConsoleConfig* cc);
+
 // echos a single character
-void console_putchar(const struct ConsoleConfig* cc, char c);
+void console_putchar(struct ConsoleConfig* cc, char c);
 
 // output a string
-void console_puts(const struct ConsoleConfig* cc, const char* s);
+void console_puts(struct ConsoleConfig* cc, const char* s);
 
 // prints hex and decimal forms of a character for debugging
-void console_debug_putchar(const struct ConsoleConfig* cc, char c);
+void console_debug_putchar(struct ConsoleConfig* cc, char c);
 
-// prints a formatted string (of limited size)
-void console_printf(const struct ConsoleConfig* cc, const char* fmt, ...);
+// prints a formatted string (see format.h for what is supported)
+void console_printf(struct ConsoleConfig* cc, const char* fmt, ...)
+  __attribute__((format(printf, 2, 3)));
 #endif
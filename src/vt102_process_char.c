@@ -1,6 +1,7 @@
 #include "vt102_process_char.h"
 #include "vt102_util.h"
 #include "command_history.h"
+#include "tokenize.h"
 #include <string.h>
 
 static void vt102_backspace(struct ConsoleConfig* cc) {
@@ -9,6 +10,7 @@ static void vt102_backspace(struct ConsoleConfig* cc) {
     return;
   }
 
+  tokenize_line_changed(cc, cc->cursor_index - 1);
   if (cc->cursor_index < cc->line_length) {
     // need to delete a character in the middle of the buffer
     memmove(
@@ -19,16 +21,12 @@ static void vt102_backspace(struct ConsoleConfig* cc) {
 
   --cc->cursor_index;
   --cc->line_length;
-  cc->tab_length = cc->line_length;
-  vt102_putchar(cc, 0x08); // backspace
-  vt102_putchar(cc, 0x1b); // escape
-  vt102_putchar(cc, '['); // escape
-  vt102_putchar(cc, '1');  // num chars
-  vt102_putchar(cc, 'P');  // delete character
+  // backspace, then delete 1 character
+  vt102_write(cc, "\x08\x1b[1P", 5);
 }
 
 static char parse_vt102_normal(struct ConsoleConfig* cc, char c) {
-  if (c >= 32) {
+  if ((uint8_t)c >= 32) {
     // just a regular character
     vt102_putchar(cc, c);
     return c;
@@ -36,8 +34,7 @@ static char parse_vt102_normal(struct ConsoleConfig* cc, char c) {
 
   switch (c) {
     case '\r':
-      vt102_putchar(cc, c);
-      vt102_putchar(cc, '\n');
+      vt102_write(cc, "\r\n", 2);
       return c;
     case '\t':
       vt102_tab_pressed(cc);
@@ -56,6 +53,11 @@ static char parse_vt102_normal(struct ConsoleConfig* cc, char c) {
       break;
     case 0x03:
       return c; // ctrl-c
+#if CONSOLE_HISTORY_LINES > 0
+    case 0x12:
+      vt102_history_search_start(cc);
+      break;
+#endif
   }
 
   return 0;
@@ -93,13 +95,19 @@ static char parse_vt102_escape2(struct ConsoleConfig* cc, char c) {
       return 0;
   }
 
-  vt102_putchar(cc, 0x1b);
-  vt102_putchar(cc, '[');
-  vt102_putchar(cc, c);
+  vt102_escape_sequence(cc, 0, c);
   return 0;
 }
 
 char vt102_process_char(struct ConsoleConfig* cc, char c) {
+  if (c != '\t') {
+    cc->tab_count = 0;
+  }
+#if CONSOLE_HISTORY_LINES > 0
+  if (cc->history_search && vt102_history_search(cc, c)) {
+    return 0;
+  }
+#endif
   switch (cc->terminal_state) {
     case VT102_NORMAL:
       return parse_vt102_normal(cc, c);
@@ -10,11 +10,13 @@
 // Support is not comprehensive.  For example, Ctrl-W is not implemented
 // (but could be added as needed). Currently-supported operations:
 //
-// Up Arrow - recall previous history - only available if CONSOLE_HISTORY_LINES > 0
+// Up Arrow - recall previous history that starts with the characters before
+// the cursor - only available if CONSOLE_HISTORY_LINES > 0
 //   027 1b ESC
 //   091 5b [
 //   067 43 A
-// Down Arrow - go forward in history - only available if CONSOLE_HISTORY_LINES > 0
+// Down Arrow - go forward in history, with the same filter as up arrow -
+// only available if CONSOLE_HISTORY_LINES > 0
 //   027 1b ESC
 //   091 5b [
 //   067 43 B
@@ -39,6 +41,9 @@
 //   003 03
 // ctrl a - move cursor to the beginning of the current line
 //   001 01
+// ctrl r - incremental reverse history search - only available if
+// CONSOLE_HISTORY_LINES > 0
+//   018 12
 // ASCII ' ' through '~': Add a character
 // 
 // Assuming this comment is not outdated (check the code), all other control
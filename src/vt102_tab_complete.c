@@ -1,36 +1,211 @@
 #include "uart_console/console.h"
+#include "vt102_tab_complete.h"
 #include "vt102_util.h"
+#include "command_args.h"
+#include "command_index.h"
 #include <inttypes.h>
+#include <string.h>
 // Functions that handle tab completion
 
-static uint8_t vt102_try_tab_complete(
-    struct ConsoleConfig* cc, uint8_t callback_idx) {
-  // synthetically adding "help" at the end of the command list
-  const char* command = callback_idx >= cc->callback_count ?
-    "help" : cc->callbacks[callback_idx].command; 
-  uint8_t i=0;
-  for (; i < cc->tab_length; ++i) {
-    if (cc->line[i] != command[i]) {
-      return 0;
+// What the tab key is completing
+struct TabTarget {
+  uint16_t start;  // index in cc->line of the word being completed
+  // enum argument, or NULL for a command name
+  const struct ConsoleArg* arg;
+  // group whose subcommands are being completed, or NULL for the top level
+  const struct ConsoleCallback* group;
+};
+
+// Summary of the commands (or enum values) that match the current word
+struct TabMatches {
+  const char* first;  // first match
+  uint16_t prefix_length;  // length of the word typed so far
+  uint16_t common_length;  // length of the prefix shared by all matches
+  uint16_t count;  // number of matches
+};
+
+static void add_match(
+    struct ConsoleConfig* cc, const char* command, void* ctx) {
+  struct TabMatches* matches = ctx;
+  if (matches->count == 0) {
+    matches->first = command;
+    matches->common_length = strlen(command);
+  } else {
+    // everything up to prefix_length is already known to match
+    uint16_t i = matches->prefix_length;
+    for (; i < matches->common_length && matches->first[i] == command[i]; ++i);
+    matches->common_length = i;
+  }
+  ++matches->count;
+}
+
+static void list_match(
+    struct ConsoleConfig* cc, const char* command, void* ctx) {
+  uint8_t* is_first = ctx;
+  if (!*is_first) {
+    vt102_write(cc, "  ", 2);
+  }
+  *is_first = 0;
+  vt102_write(cc, command, strlen(command));
+}
+
+// Looks up a complete word of the command path: a top-level command when
+// group is NULL, otherwise one of group's subcommands
+static const struct ConsoleCallback* find_word(
+    const struct ConsoleConfig* cc,
+    const struct ConsoleCallback* group,
+    const char* word,
+    uint16_t length) {
+  if (group) {
+    return group->subcommands ?
+      command_index_find_subcommand(group, word, length) : NULL;
+  }
+  char command[CONSOLE_MAX_LINE_CHARS + 1];
+  memcpy(command, word, length);
+  command[length] = '\0';
+  return command_index_find(cc, command);
+}
+
+// Works out what the word at the end of the line is.  Returns zero if it
+// is not something that can be completed.
+static uint8_t find_target(
+    struct ConsoleConfig* cc, struct TabTarget* target) {
+  target->start = 0;
+  target->arg = NULL;
+  target->group = NULL;
+  // "help" is followed by a command path, with no arguments to complete.
+  // Bytes past line_length are stale so the length is checked first.
+  const uint8_t is_help =
+    (cc->line_length >= 5) && !memcmp(cc->line, "help ", 5);
+  if (is_help) {
+    target->start = 5;
+  }
+
+  // Walk the words before the last one, descending into subcommands and
+  // then counting arguments.  Names and enum values do not contain spaces
+  // so quotes are not considered.
+  const struct ConsoleCallback* cb = NULL;  // deepest command named so far
+  uint8_t position = 0;  // arguments after the command path
+  while (1) {
+    const char* word = cc->line + target->start;
+    const char* space = memchr(word, ' ', cc->line_length - target->start);
+    if (!space) {
+      break;
+    }
+    const uint16_t length = space - word;
+    target->start += length + 1;
+    if (length == 0) {
+      continue;  // repeated space
     }
+    const struct ConsoleCallback* next =
+      (position == 0) ? find_word(cc, cb, word, length) : NULL;
+    if (next) {
+      cb = next;
+    } else if (!cb) {
+      return 0;  // unknown command
+    } else {
+      ++position;
+    }
+  }
+
+  if ((position == 0) && (!cb || cb->subcommands)) {
+    target->group = cb;
+    return 1;  // still typing a command or subcommand name
   }
-  // it's a match
-  if (command[i]) {
-    uint16_t tab_length = cc->tab_length;
-    vt102_replace_current_line(cc, command);
-    cc->tab_length = tab_length;
+#if CONSOLE_TYPED_ARGS
+  if (is_help || !cb->args) {
+    return 0;
+  }
+  target->arg = args_at(cb, position);
+  return target->arg &&
+    ((target->arg->type & CONSOLE_ARG_TYPE_MASK) == CONSOLE_ARG_ENUM);
+#else
+  return 0;
+#endif
+}
+
+// Calls visit() for every command (or enum value) that starts with the
+// word being completed
+static void for_each_match(
+    struct ConsoleConfig* cc,
+    const struct TabTarget* target,
+    void (*visit)(struct ConsoleConfig* cc, const char* command, void* ctx),
+    void* ctx) {
+  const char* word = cc->line + target->start;
+  const uint16_t length = cc->line_length - target->start;
+#if CONSOLE_TYPED_ARGS
+  if (target->arg) {
+    for (const char* const* choice = target->arg->choices; *choice; ++choice) {
+      if (!strncmp(*choice, word, length)) {
+        visit(cc, *choice, ctx);
+      }
+    }
+    return;
+  }
+#endif
+  if (target->group) {
+    command_index_for_each_subcommand(
+        cc, target->group, word, length, visit, ctx);
+    return;
+  }
+  command_index_for_each_prefix(cc, word, length, visit, ctx);
+  // synthetically adding "help" at the end of the command list
+  if ((target->start == 0) && !strncmp("help", word, length)) {
+    visit(cc, "help", ctx);
+  }
+}
+
+// Extends the current line with the characters that all matches share
+static void complete_common_prefix(
+    struct ConsoleConfig* cc,
+    const struct TabTarget* target,
+    const struct TabMatches* matches) {
+  if ((target->start + matches->common_length) > CONSOLE_MAX_LINE_CHARS) {
+    return;
+  }
+  vt102_end_of_line(cc);
+  const uint16_t extra = matches->common_length - matches->prefix_length;
+  const char* suffix = matches->first + matches->prefix_length;
+  memcpy(cc->line + cc->line_length, suffix, extra);
+  vt102_write(cc, suffix, extra);
+  cc->line_length += extra;
+  cc->cursor_index = cc->line_length;
+}
+
+// Lists all matches and then redraws the prompt and current line
+static void list_matches(
+    struct ConsoleConfig* cc, const struct TabTarget* target) {
+  uint8_t is_first = 1;
+  vt102_write(cc, "\r\n", 2);
+  for_each_match(cc, target, list_match, &is_first);
+  vt102_write(cc, "\r\n", 2);
+  if (cc->prompt) {
+    vt102_write(cc, cc->prompt, strlen(cc->prompt));
+  }
+  vt102_write(cc, cc->line, cc->line_length);
+  if (cc->cursor_index < cc->line_length) {
+    vt102_escape_sequence(
+        cc, cc->line_length - cc->cursor_index, 'D');  // cursor left
   }
-  cc->tab_callback_index = callback_idx;
-  return 1;
 }
 
 // Called when the user presses the tab key
 void vt102_tab_pressed(struct ConsoleConfig* cc) {
-  for (uint8_t i=0; i < (cc->callback_count + 1); ++i) {
-    const uint8_t callback_idx =
-        (cc->tab_callback_index + i + 1) % (cc->callback_count + 1);
-    if (vt102_try_tab_complete(cc, callback_idx)) {
-      return;
-    }
-  } 
+  if (cc->tab_count < 0xFF) {
+    ++cc->tab_count;
+  }
+  struct TabTarget target;
+  if (!find_target(cc, &target)) {
+    return;
+  }
+  struct TabMatches matches = {NULL, cc->line_length - target.start, 0, 0};
+  for_each_match(cc, &target, add_match, &matches);
+  if (matches.count == 0) {
+    return;
+  }
+  if (matches.common_length > matches.prefix_length) {
+    complete_common_prefix(cc, &target, &matches);
+  } else if ((matches.count > 1) && (cc->tab_count >= 2)) {
+    list_matches(cc, &target);
+  }
 }
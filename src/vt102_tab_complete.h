@@ -1,26 +1,33 @@
 #ifndef VT102_TAB_COMPLETE_H
 #define VT102_TAB_COMPLETE_H
+#include "uart_console/console.h"
 
-// When called, looks though cc->callbacks for a command that
-// could complete the current cc->line.
+// When called, looks though cc->callbacks (and the built-in "help") for
+// commands that start with the current cc->line.
 //
-// This is one bit of additional complication.  Instead of
-// using cc->line_length, cc->tab_length is used instead.
-// During normal typing, cc->line_length == cc->tab_length but
-// when the user types tab, cc->line_length >= cc->tab_length.
-// This is done to allow the user to "scroll through" various
-// completion options.
+// A single tab extends the line to the longest prefix that all of the
+// matching commands share.  If that does not add anything (because
+// there are multiple matches that differ at the next character), a
+// second consecutive tab lists all of the matches on one line and then
+// redraws the prompt and the current line.
 //
 // For example, if the defined commands are
 //   hello
 //   help
 //   host
 //
-// and the use enters "he" and presses tab, the system will cycle
-// through "hello" and "help".  If the user just typed "h", then
-// the system will cycle through "hello", "help" , and "host".
-// cc->tab_length hold the relevant length (2 in the first example,
-// 1 in the second) that implements this behavior.
+// and the user enters "h" and presses tab, nothing happens because
+// "h" is already the common prefix.  Pressing tab again lists
+// "hello  help  host".  If the user enters "he" and presses tab, the
+// line becomes "hel" and a second tab lists "hello  help".
+//
+// After the command name, tab completes arguments that are described as
+// CONSOLE_ARG_ENUM (see ConsoleCallback.args) from their choices in the same
+// way.
+//
+// When cc->command_index is available, matches are found with a binary
+// search for the range of sorted commands that start with the line,
+// otherwise the callback table is searched linearly.
 void vt102_tab_pressed(struct ConsoleConfig* cc);
 
-#endif
\ No newline at end of file
+#endif
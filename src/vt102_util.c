@@ -1,20 +1,19 @@
 
 #include "vt102_util.h"
+#include "tokenize.h"
 #include <string.h>
 
-static void vt102_put_ascii_number(struct ConsoleConfig* cc, uint16_t delta) {
-  if (delta == 0) {
-    // nothing
-    return;
-  }
-  char digits[8];
-  uint8_t length = 0;
-  for (; delta; ++length, delta /= 10) {
-    digits[length] = '0' + (delta % 10);
-  }
-  for (; length > 0; --length) {
-    vt102_putchar(cc, digits[length - 1]);
+void vt102_escape_sequence(struct ConsoleConfig* cc, uint16_t n, char command) {
+  // the sequence is assembled backwards from the end of the buffer
+  char sequence[8];
+  uint8_t start = sizeof(sequence) - 1;
+  sequence[start] = command;
+  for (; n; n /= 10) {
+    sequence[--start] = '0' + (n % 10);
   }
+  sequence[--start] = '[';
+  sequence[--start] = 0x1b; // escape
+  vt102_write(cc, sequence + start, sizeof(sequence) - start);
 }
 
 void vt102_beginning_of_line(struct ConsoleConfig* cc) {
@@ -22,10 +21,7 @@ void vt102_beginning_of_line(struct ConsoleConfig* cc) {
     // already at beginning
     return;
   }
-  vt102_putchar(cc, 0x1b); // escape
-  vt102_putchar(cc, '['); // escape
-  vt102_put_ascii_number(cc, cc->cursor_index);
-  vt102_putchar(cc, 'D');  // cursor left
+  vt102_escape_sequence(cc, cc->cursor_index, 'D');  // cursor left
   cc->cursor_index = 0;
 }
 
@@ -34,10 +30,8 @@ void vt102_end_of_line(struct ConsoleConfig* cc) {
     // already at eol
     return;
   }
-  vt102_putchar(cc, 0x1b); // escape
-  vt102_putchar(cc, '['); // escape
-  vt102_put_ascii_number(cc, cc->line_length - cc->cursor_index);
-  vt102_putchar(cc, 'C');  // cursor right
+  vt102_escape_sequence(
+      cc, cc->line_length - cc->cursor_index, 'C');  // cursor right
   cc->cursor_index = cc->line_length;
 }
 
@@ -47,30 +41,85 @@ void vt102_erase_current_line(struct ConsoleConfig* cc) {
     return;
   }
   vt102_beginning_of_line(cc);
-  vt102_putchar(cc, 0x1b); // escape
-  vt102_putchar(cc, '['); // escape
-  vt102_put_ascii_number(cc, cc->line_length);
-  vt102_putchar(cc, 'P');  // delete character
+  vt102_escape_sequence(cc, cc->line_length, 'P');  // delete character
 
+  tokenize_line_changed(cc, 0);
   cc->line_length = 0;
   cc->line[0] = 0;
 }
 
-void vt102_replace_current_line(struct ConsoleConfig* cc, const char* line) {
-  vt102_erase_current_line(cc);
-  const uint16_t new_length = strlen(line);
-  memcpy(cc->line, line, new_length);
-  cc->line_length = new_length;
-  cc->cursor_index = new_length;
-  cc->tab_length = cc->line_length;
-  for (uint16_t i=0; i<new_length; ++i) {
-    vt102_putchar(cc, line[i]);
+// bytes in ESC [ <n> <command>, or zero when there is nothing to do
+static uint16_t escape_length(uint16_t n) {
+  if (n == 0) {
+    return 0;
   }
+  uint16_t length = 4;
+  for (; n >= 10; n /= 10) {
+    ++length;
+  }
+  return length;
+}
+
+// moves the cursor to index with backspaces or an escape sequence,
+// whichever is shorter
+static void move_cursor(struct ConsoleConfig* cc, uint16_t index) {
+  if (index > cc->cursor_index) {
+    vt102_escape_sequence(cc, index - cc->cursor_index, 'C');  // cursor right
+  } else if (index < cc->cursor_index) {
+    const uint16_t n = cc->cursor_index - index;
+    if (n < escape_length(n)) {
+      for (uint16_t i=0; i<n; ++i) {
+        vt102_write(cc, "\x08", 1);
+      }
+    } else {
+      vt102_escape_sequence(cc, n, 'D');  // cursor left
+    }
+  }
+  cc->cursor_index = index;
+}
+
+void vt102_replace_current_line(
+    struct ConsoleConfig* cc, const char* line, uint16_t length) {
+  const uint16_t old_length = cc->line_length;
+  const uint16_t shortest = (length < old_length) ? length : old_length;
+  uint16_t prefix = 0;
+  while ((prefix < shortest) && (cc->line[prefix] == line[prefix])) {
+    ++prefix;
+  }
+  uint16_t suffix = 0;
+  while ((suffix < shortest - prefix) &&
+      (cc->line[old_length - 1 - suffix] == line[length - 1 - suffix])) {
+    ++suffix;
+  }
+
+  // The terminal is in insert mode, so the differing middle is deleted and
+  // the new one typed in front of the suffix.  Keeping the suffix means
+  // moving past it afterwards, which can cost more than retyping it.
+  const uint16_t keep_cost =
+    escape_length(old_length - prefix - suffix) + escape_length(suffix);
+  const uint16_t retype_cost = escape_length(old_length - prefix) + suffix;
+  if (keep_cost >= retype_cost) {
+    suffix = 0;
+  }
+
+  move_cursor(cc, prefix);
+  const uint16_t deleted = old_length - prefix - suffix;
+  if (deleted) {
+    vt102_escape_sequence(cc, deleted, 'P');  // delete character
+  }
+  const uint16_t inserted = length - prefix - suffix;
+  vt102_write(cc, line + prefix, inserted);
+  if (suffix) {
+    vt102_escape_sequence(cc, suffix, 'C');  // cursor right
+  }
+
+  tokenize_line_changed(cc, prefix);
+  memcpy(cc->line + prefix, line + prefix, length - prefix);
+  cc->line[length] = 0;
+  cc->line_length = length;
+  cc->cursor_index = length;
 }
 
 void vt102_insert_mode(struct ConsoleConfig* cc) {
-  cc->putchar(0x1b);
-  cc->putchar('[');
-  cc->putchar('4');
-  cc->putchar('h');
+  console_write(cc, "\x1b[4h", 4);
 }
\ No newline at end of file
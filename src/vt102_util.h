@@ -10,10 +10,25 @@ static inline void vt102_putchar(struct ConsoleConfig* cc, char c) {
   if (cc->terminal == CONSOLE_DEBUG_VT102) {
     console_debug_putchar(cc, c);
   } else {
-    cc->putchar(c);
+    console_raw_putchar(cc, c);
   }
 }
 
+// outputs a block of characters
+static inline void vt102_write(
+    struct ConsoleConfig* cc, const char* data, uint16_t length) {
+  if (cc->terminal == CONSOLE_DEBUG_VT102) {
+    for (uint16_t i=0; i<length; ++i) {
+      console_debug_putchar(cc, data[i]);
+    }
+  } else {
+    console_write(cc, data, length);
+  }
+}
+
+// outputs ESC [ <n> <command>, omitting n when it is zero
+void vt102_escape_sequence(struct ConsoleConfig* cc, uint16_t n, char command);
+
 // moves the cursor to the beginning of a line
 void vt102_beginning_of_line(struct ConsoleConfig* cc);
 
@@ -23,8 +38,10 @@ void vt102_end_of_line(struct ConsoleConfig* cc);
 // Completely erases the current line
 void vt102_erase_current_line(struct ConsoleConfig* cc);
 
-// Replaces the current line with the given string
-void vt102_replace_current_line(struct ConsoleConfig* cc, const char* line);
+// Replaces the current line with the given characters, only redrawing the
+// part that differs from what is shown.  line must not point into cc->line.
+void vt102_replace_current_line(
+    struct ConsoleConfig* cc, const char* line, uint16_t length);
 
 // Instructs the terminal to use insert mode
 void vt102_insert_mode(struct ConsoleConfig* cc);